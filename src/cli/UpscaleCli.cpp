@@ -0,0 +1,154 @@
+//UpscaleCli.cpp - консольный пакетный апскейл папки с изображениями без запуска интерфейса;
+//использует тот же тайловый конвейер ncnn, что и приложение, и печатает пропускную способность (заодно служит бенчмарком)
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDir>
+#include <QFileInfo>
+#include <QImageReader>
+#include <QElapsedTimer>
+#include <QThreadPool>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QTextStream>
+#include <atomic>
+
+#include "SettingsManager.h"
+#include "ModelsManager.h"
+#include "UpscalePipeline.h"
+#include "net.h"
+
+namespace {
+struct CliJob {
+    QString inputPath;
+    QString outputPath;
+    ModelInfo model;
+    QSize sourceSize;
+};
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("ImagoRef"); //те же настройки и папка моделей, что у приложения
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Batch upscale of a folder of images");
+    parser.addHelpOption();
+    parser.addPositionalArgument("input", "Folder with source images");
+    parser.addPositionalArgument("output", "Folder for upscaled images");
+
+    QCommandLineOption modelOption("model", "Model id from the manifest (default: chosen by --quality)", "id");
+    QCommandLineOption qualityOption("quality", "auto, fast or quality", "quality", "auto");
+    QCommandLineOption jobsOption({"j", "jobs"}, "Images processed in parallel", "count", "1");
+    QCommandLineOption tileOption("tile", "Tile size in source pixels (default: from settings)", "pixels");
+    parser.addOptions({modelOption, qualityOption, jobsOption, tileOption});
+    parser.process(app);
+
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+
+    const QStringList args = parser.positionalArguments();
+    if (args.size() != 2) {
+        parser.showHelp(1);
+    }
+
+    const QDir inputDir(args.at(0));
+    const QDir outputDir(args.at(1));
+    if (!inputDir.exists()) {
+        err << "Input folder does not exist: " << inputDir.path() << Qt::endl;
+        return 1;
+    }
+    QDir().mkpath(outputDir.path());
+
+    SettingsManager::instance().loadSettings();
+    ModelsManager &models = ModelsManager::instance();
+
+    const int jobs = qMax(1, parser.value(jobsOption).toInt());
+    const int tileSize = parser.isSet(tileOption) ? parser.value(tileOption).toInt() : SettingsManager::instance().getUpscaleTileSize();
+
+    //модель выбирается заранее в главном потоке, как и в приложении — по размеру исходника
+    QStringList nameFilters;
+    for (const QByteArray &format : QImageReader::supportedImageFormats()) {
+        nameFilters << "*." + QString::fromLatin1(format);
+    }
+
+    QVector<CliJob> cliJobs;
+    const QFileInfoList files = inputDir.entryInfoList(nameFilters, QDir::Files, QDir::Name);
+    for (const QFileInfo &file : files) {
+        CliJob job;
+        job.inputPath = file.absoluteFilePath();
+        job.sourceSize = QImageReader(job.inputPath).size();
+        job.model = parser.isSet(modelOption) ? models.getModel(parser.value(modelOption))
+                                              : models.selectModel(parser.value(qualityOption), job.sourceSize);
+        if (!job.model.isValid() || !models.hasModelFiles(job.model)) {
+            err << "No downloaded model for " << file.fileName() << Qt::endl;
+            return 1;
+        }
+        job.outputPath = outputDir.filePath(QString("%1_x%2.png").arg(file.completeBaseName()).arg(job.model.scale));
+        cliJobs.append(job);
+    }
+
+    if (cliJobs.isEmpty()) {
+        err << "No images found in " << inputDir.path() << Qt::endl;
+        return 1;
+    }
+
+    //сеть каждой модели загружается один раз и общая для всех заданий; потоки ncnn делятся между заданиями
+    std::atomic<int> done{0};
+    std::atomic<int> failed{0};
+    std::atomic<qint64> sourcePixels{0};
+    std::atomic<qint64> outputPixels{0};
+    QMutex outputMutex;
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(jobs);
+
+    QElapsedTimer timer;
+    timer.start();
+
+    for (const CliJob &job : std::as_const(cliJobs)) {
+        pool.start([&, job]() {
+            QString error;
+            QImage result;
+
+            std::shared_ptr<ncnn::Net> net = models.acquireNet(job.model, &error);
+            QImage source(job.inputPath);
+            if (net && !source.isNull()) {
+                const int threads = qMax(1, net->opt.num_threads / jobs);
+                result = UpscalePipeline::upscale(*net, job.model, source, tileSize, threads, {}, &error);
+            } else if (source.isNull()) {
+                error = "Cannot read image";
+            }
+
+            if (!result.isNull() && !result.save(job.outputPath, "PNG")) {
+                error = "Cannot write " + job.outputPath;
+                result = QImage();
+            }
+
+            QMutexLocker locker(&outputMutex);
+            if (result.isNull()) {
+                failed++;
+                err << "FAILED " << QFileInfo(job.inputPath).fileName() << ": " << error << Qt::endl;
+                return;
+            }
+
+            done++;
+            sourcePixels += qint64(source.width()) * source.height();
+            outputPixels += qint64(result.width()) * result.height();
+            out << "[" << (done + failed) << "/" << cliJobs.size() << "] " << QFileInfo(job.inputPath).fileName()
+                << " -> " << QFileInfo(job.outputPath).fileName() << " (" << job.model.id << ")" << Qt::endl;
+        });
+    }
+    pool.waitForDone();
+
+    const double seconds = qMax<qint64>(1, timer.elapsed()) / 1000.0;
+    out << Qt::endl
+        << "Images:     " << done.load() << " done, " << failed.load() << " failed in " << QString::number(seconds, 'f', 2) << " s" << Qt::endl
+        << "Throughput: " << QString::number(done / seconds, 'f', 3) << " images/s, "
+        << QString::number(sourcePixels / 1e6 / seconds, 'f', 3) << " source MP/s, "
+        << QString::number(outputPixels / 1e6 / seconds, 'f', 3) << " output MP/s" << Qt::endl
+        << "Jobs: " << jobs << ", tile: " << tileSize << Qt::endl;
+
+    return failed > 0 ? 2 : 0;
+}
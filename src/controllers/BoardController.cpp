@@ -5,6 +5,7 @@
 #include "ModelsManager.h"
 #include "NetworkController.h"
 #include "CacheManager.h"
+#include "LayoutEngine.h"
 
 #include <QPainter>
 #include <QImage>
@@ -14,16 +15,44 @@
 #include <QCryptographicHash>
 #include <QJsonObject>
 #include <QUrl>
+#include <QSqlDatabase>
+#include <cmath>
+
+namespace {
+//размер холста, за который нельзя утащить элементы
+constexpr qreal C_CANVAS_SIZE = 30000.0;
+//на каком расстоянии в экранных пикселях край притягивается к направляющей
+constexpr qreal C_GUIDE_SNAP_PX = 6.0;
+
+//ищет ближайшую направляющую для трех краев (начало, центр, конец); delta — сдвиг до нее
+bool snapEdges(const EdgeIndex &index, qreal start, qreal center, qreal end, qreal maxDistance, qreal *delta, qreal *guide)
+{
+    bool snapped = false;
+    qreal bestDistance = maxDistance;
+    for (qreal edge : {start, center, end}) {
+        qreal found = 0;
+        if (index.findNearest(edge, bestDistance, &found) && (!snapped || std::abs(found - edge) < bestDistance)) {
+            bestDistance = std::abs(found - edge);
+            *delta = found - edge;
+            *guide = found;
+            snapped = true;
+        }
+    }
+    return snapped;
+}
+}
 
 BoardController::BoardController(QObject *parent) : QObject(parent)
     , m_model(new ImagoImageModel(this))
-    , m_undoStack(new QUndoStack(this))
+    , m_undoStack(new UndoHistory(this))
     , m_storageController(new StorageController(m_model, m_undoStack, this))
     , m_selectionController(new SelectionController(m_model, this))
     , m_clipboardController(new ClipboardController(m_model, m_undoStack, this))
     , m_toolController(new ToolController(m_model, m_undoStack, this))
     , m_upscaleController(new UpscaleController(m_model, &ModelsManager::instance(), m_undoStack, this))
     , m_networkController(new NetworkController(m_storageController, this))
+    , m_liveTransforms(new LiveTransformController(m_model, m_networkController, this))
+    , m_paletteController(new PaletteController(m_model, this))
     , m_gridSize(SettingsManager::instance().getGridSize())
     , m_cameraX(-1)
     , m_cameraY(-1)
@@ -42,7 +71,7 @@ BoardController::BoardController(QObject *parent) : QObject(parent)
 }
 
 BoardController::~BoardController() {
-    if (!m_model->getAllItems().isEmpty()) {
+    if (m_model->getCount() > 0) {
         generateBoardPreview();
     }
 
@@ -54,8 +83,8 @@ BoardController::~BoardController() {
 //метод связывания сигналов
 void BoardController::connectSignals()
 {
-    connect(m_undoStack, &QUndoStack::canUndoChanged, this, &BoardController::undoStateChanged);
-    connect(m_undoStack, &QUndoStack::canRedoChanged, this, &BoardController::redoStateChanged);
+    connect(m_undoStack, &UndoHistory::canUndoChanged, this, &BoardController::undoStateChanged);
+    connect(m_undoStack, &UndoHistory::canRedoChanged, this, &BoardController::redoStateChanged);
     
     connect(&SettingsManager::instance(), &SettingsManager::gridSizeChanged, this, [this]() {
         m_gridSize = SettingsManager::instance().getGridSize();
@@ -108,10 +137,26 @@ void BoardController::connectSignals()
 
     // Отслеживание изменения существующих элементов (метки, вращение, апскейл, кроп, прозрачность)
     connect(m_model, &QAbstractItemModel::dataChanged, this, [this](const QModelIndex& topLeft, const QModelIndex& bottomRight, const QVector<int>& roles) {
-        if (m_storageController->isLoading()) return;
+        // Чужие промежуточные положения только отображаются и не сохраняются
+        if (m_storageController->isLoading() || m_liveTransforms->isApplying()) return;
+
+        // Изменения, не влияющие на синхронизируемые поля (например, выделение), в БД не пишем
+        int fields = StorageController::fieldsForRoles(roles);
+        if (fields == 0) return;
+
+        bool rotated = roles.contains(ImagoImageModel::RotationRole);
+
+        //пакетные изменения приходят диапазоном строк — пишем их в БД одной транзакцией
+        bool batch = bottomRight.row() > topLeft.row();
+        if (batch) QSqlDatabase::database().transaction();
 
         for (int row = topLeft.row(); row <= bottomRight.row(); ++row) {
             ImagoImageData item = m_model->getItem(row);
+
+            // Поворот сразу показываем соавторам, как и перетаскивание
+            if (rotated) {
+                m_liveTransforms->publish(row);
+            }
             
             // Если картинки с таким хэшем еще нет в локальном кэше (например, после апскейла 
             // сгенерировался новый хэш), мы обязаны сохранить её физически на диск.
@@ -125,19 +170,16 @@ void BoardController::connectSignals()
                 }
             }
             
-            // Перезаписываем элемент в БД (он пометится как is_dirty = 1)
-            m_storageController->upsertItem(item);
+            // Перезаписываем элемент в БД (он пометится как is_dirty = 1, в dirty_fields добавятся измененные поля)
+            m_storageController->upsertItem(item, fields);
         }
+
+        if (batch) QSqlDatabase::database().commit();
     });
 
-    // Обработка входящих обновлений по сети (оставим пока как есть, адаптируем в шаге 2)
+    // Обработка входящих обновлений по сети (например, докачалась картинка из S3)
     connect(m_networkController, &NetworkController::itemUpdatedFromNetwork, this, [this](const QString& itemId) {
-        ImagoImageData data = m_storageController->getItemFromDb(itemId);
-        if (!data.id.isEmpty()) {
-            m_model->updateItemData(itemId, data);
-        } else {
-            m_model->removeImageById(itemId);
-        }
+        m_storageController->applyNetworkChanges({itemId}, {});
     });
 }
 
@@ -149,6 +191,7 @@ ClipboardController* BoardController::getClipboardController() const { return m_
 ToolController* BoardController::getToolController() const { return m_toolController; }
 UpscaleController* BoardController::getUpscaleController() const { return m_upscaleController; }
 NetworkController* BoardController::getNetworkController() const { return m_networkController; }
+PaletteController* BoardController::getPaletteController() const { return m_paletteController; }
 
 bool BoardController::getCanUndo() const { return m_undoStack->canUndo(); }
 bool BoardController::getCanRedo() const { return m_undoStack->canRedo(); }
@@ -229,7 +272,7 @@ void BoardController::endMove(int index, qreal newX, qreal newY)
         ));
         
         ImagoImageData item = m_model->getItem(index);
-        m_storageController->upsertItem(item); // Просто сохраняем локально, никаких очередей
+        m_storageController->upsertItem(item, SyncPosition); // Просто сохраняем локально, никаких очередей
     }
 }
 
@@ -239,6 +282,14 @@ void BoardController::beginResize(int index)
     ImagoImageData item = m_model->getItem(index);
     m_resizeStartRect = QRectF(0, 0, item.width, item.height);
     m_resizeStartPos = QPointF(item.x, item.y);
+    m_liveTransforms->beginLocalEdit({item.id});
+}
+
+void BoardController::updateResize(int index, qreal newX, qreal newY, qreal newWidth, qreal newHeight)
+{
+    m_model->setPosition(index, newX, newY);
+    m_model->setSize(index, newWidth, newHeight);
+    m_liveTransforms->publish(index);
 }
 
 void BoardController::endResize(int index, qreal newX, qreal newY, qreal newWidth, qreal newHeight)
@@ -254,83 +305,177 @@ void BoardController::endResize(int index, qreal newX, qreal newY, qreal newWidt
         ));
         
         ImagoImageData item = m_model->getItem(index);
-        m_storageController->upsertItem(item);
+        m_storageController->upsertItem(item, SyncPosition | SyncSize);
     }
+    m_liveTransforms->endLocalEdit();
 }
 
 //отслеживание перемещения выделения
 void BoardController::beginMoveSelection()
 {
-    m_moveSelectionIndices.clear();
-    m_moveSelectionStartPos.clear();
+    m_moveSelection.clear();
+    m_groupDragOffset = QPointF();
+    m_moveSelectionBounds = QRectF();
+
+    //границы смещения считаются один раз: дальше группа двигается как единое целое
+    qreal minDx = 0, maxDx = 0, minDy = 0, maxDy = 0;
+    bool first = true;
 
-    QVariantList selected = m_model->getSelectedIndices();
+    QStringList movedIds;
+    const QVariantList selected = m_model->getSelectedIndices();
+    m_moveSelection.reserve(selected.size());
     for (const QVariant& v : selected) {
         int index = v.toInt();
-        ImagoImageData item = m_model->getItem(index);
-        m_moveSelectionIndices.append(index);
-        m_moveSelectionStartPos.append(QPointF(item.x, item.y));
+        MoveSelectionItem item;
+        item.id = m_model->getItemId(index);
+        item.startRect = m_model->getItemRect(index);
+        item.rotation = m_model->getItemRotation(index);
+        m_moveSelection.append(item);
+        movedIds.append(item.id);
+
+        const QRectF bounds = m_model->getItemBounds(index);
+        m_moveSelectionBounds = m_moveSelectionBounds.isNull() ? bounds : m_moveSelectionBounds.united(bounds);
+
+        qreal itemW = item.startRect.width() > 0 ? item.startRect.width() : 100;
+        qreal itemH = item.startRect.height() > 0 ? item.startRect.height() : 100;
+        qreal lowX = -item.startRect.x();
+        qreal highX = C_CANVAS_SIZE - itemW - item.startRect.x();
+        qreal lowY = -item.startRect.y();
+        qreal highY = C_CANVAS_SIZE - itemH - item.startRect.y();
+        if (first) {
+            minDx = lowX; maxDx = highX; minDy = lowY; maxDy = highY;
+            first = false;
+        } else {
+            minDx = qMax(minDx, lowX); maxDx = qMin(maxDx, highX);
+            minDy = qMax(minDy, lowY); maxDy = qMin(maxDy, highY);
+        }
+    }
+    //элемент уже за границей не должен запрещать движение обратно
+    minDx = qMin(minDx, 0.0); maxDx = qMax(maxDx, 0.0);
+    minDy = qMin(minDy, 0.0); maxDy = qMax(maxDy, 0.0);
+    m_moveSelectionDeltaBounds = QRectF(QPointF(minDx, minDy), QPointF(maxDx, maxDy));
+
+    //направляющие — края и центры всех остальных элементов; дальше поиск по ним бинарный
+    m_guideEdgesX.clear();
+    m_guideEdgesY.clear();
+    if (!m_moveSelection.isEmpty()) {
+        for (int i = 0; i < m_model->getCount(); ++i) {
+            if (m_model->isSelected(i)) continue;
+            const QRectF bounds = m_model->getItemBounds(i);
+            m_guideEdgesX.add(bounds.left());
+            m_guideEdgesX.add(bounds.center().x());
+            m_guideEdgesX.add(bounds.right());
+            m_guideEdgesY.add(bounds.top());
+            m_guideEdgesY.add(bounds.center().y());
+            m_guideEdgesY.add(bounds.bottom());
+        }
     }
+    m_guideEdgesX.build();
+    m_guideEdgesY.build();
+
+    m_liveTransforms->beginLocalEdit(movedIds);
+    emit groupDragOffsetChanged();
+    emit groupDragActiveChanged();
 }
 
 void BoardController::updateMoveSelection(qreal deltaX, qreal deltaY)
 {
-    for (int i = 0; i < m_moveSelectionIndices.size(); ++i) {
-        int index = m_moveSelectionIndices[i];
-        QPointF startPos = m_moveSelectionStartPos[i];
-        
-        qreal newX = startPos.x() + deltaX;
-        qreal newY = startPos.y() + deltaY;
-        
-        ImagoImageData item = m_model->getItem(index);
-        qreal itemW = item.width > 0 ? item.width : 100;
-        qreal itemH = item.height > 0 ? item.height : 100;
-        
-        newX = qMax(0.0, qMin(30000.0 - itemW, newX));
-        newY = qMax(0.0, qMin(30000.0 - itemH, newY));
-        
-        m_model->setPosition(index, newX, newY);
+    if (m_moveSelection.isEmpty())
+        return;
+
+    //модель не трогаем: QML сдвигает выделенные делегаты на общее смещение.
+    //Сначала смещение ограничивается холстом, потом притягивается: так направляющая всегда совпадает с итоговым краем
+    const QRectF &limits = m_moveSelectionDeltaBounds;
+    QPointF offset(qBound(limits.left(), deltaX, limits.right()), qBound(limits.top(), deltaY, limits.bottom()));
+
+    //притягивание краев группы к ближайшим направляющим; если оно вытолкнуло бы группу за холст, не применяется
+    QVariantList guides;
+    const QRectF moved = m_moveSelectionBounds.translated(offset);
+    const qreal snapDistance = C_GUIDE_SNAP_PX / (m_cameraZoom > 0 ? m_cameraZoom : 1.0);
+    qreal delta = 0, guide = 0;
+    if (snapEdges(m_guideEdgesX, moved.left(), moved.center().x(), moved.right(), snapDistance, &delta, &guide)
+        && offset.x() + delta >= limits.left() && offset.x() + delta <= limits.right()) {
+        offset.rx() += delta;
+        guides.append(QVariantMap{{"vertical", true}, {"position", guide}});
+    }
+    if (snapEdges(m_guideEdgesY, moved.top(), moved.center().y(), moved.bottom(), snapDistance, &delta, &guide)
+        && offset.y() + delta >= limits.top() && offset.y() + delta <= limits.bottom()) {
+        offset.ry() += delta;
+        guides.append(QVariantMap{{"vertical", false}, {"position", guide}});
+    }
+    if (guides != m_snapGuides) {
+        m_snapGuides = guides;
+        emit snapGuidesChanged();
+    }
+
+    if (offset == m_groupDragOffset)
+        return;
+
+    m_groupDragOffset = offset;
+    emit groupDragOffsetChanged();
+
+    for (const MoveSelectionItem &item : std::as_const(m_moveSelection)) {
+        m_liveTransforms->publish(item.id, item.startRect.translated(offset), item.rotation);
     }
 }
 
 void BoardController::endMoveSelection()
 {
-    if (m_moveSelectionIndices.isEmpty())
+    if (m_moveSelection.isEmpty())
         return;
-        
-    QVector<QPointF> newPositions;
-    bool hasChanges = false;
-    
-    for (int i = 0; i < m_moveSelectionIndices.size(); ++i) {
-        int index = m_moveSelectionIndices[i];
-        ImagoImageData item = m_model->getItem(index);
-        QPointF newPos(item.x, item.y);
-        newPositions.append(newPos);
-        
-        if (newPos != m_moveSelectionStartPos[i]) {
-            hasChanges = true;
+
+    const QPointF offset = m_groupDragOffset;
+    const QVector<MoveSelectionItem> moved = m_moveSelection;
+    m_moveSelection.clear();
+
+    //одна фиксация в модель: команда сама пишет позиции пакетом, а изменения уходят в БД одной транзакцией
+    if (!offset.isNull()) {
+        QVector<int> indices;
+        QVector<QPointF> oldPositions;
+        QVector<QPointF> newPositions;
+        for (const MoveSelectionItem &item : moved) {
+            int index = m_model->getIndexById(item.id);
+            if (index < 0) continue; //элемент удалили, пока его тащили
+            indices.append(index);
+            oldPositions.append(item.startRect.topLeft());
+            newPositions.append(item.startRect.topLeft() + offset);
         }
-    }
-    
-    if (hasChanges) {
-        m_undoStack->push(new MoveImagesCommand(
-            m_model, m_moveSelectionIndices,
-            m_moveSelectionStartPos, newPositions
-        ));
-        
-        for (int i = 0; i < m_moveSelectionIndices.size(); ++i) {
-            ImagoImageData item = m_model->getItem(m_moveSelectionIndices[i]);
-            m_storageController->upsertItem(item);
+
+        if (!indices.isEmpty()) {
+            m_undoStack->push(new MoveImagesCommand(m_model, indices, oldPositions, newPositions));
         }
     }
-    
-    m_moveSelectionIndices.clear();
-    m_moveSelectionStartPos.clear();
+
+    m_groupDragOffset = QPointF();
+    m_guideEdgesX.clear();
+    m_guideEdgesY.clear();
+    if (!m_snapGuides.isEmpty()) {
+        m_snapGuides.clear();
+        emit snapGuidesChanged();
+    }
+    emit groupDragOffsetChanged();
+    emit groupDragActiveChanged();
+    m_liveTransforms->endLocalEdit();
+}
+
+bool BoardController::isGroupDragActive() const
+{
+    return !m_moveSelection.isEmpty();
+}
+
+QPointF BoardController::getGroupDragOffset() const
+{
+    return m_groupDragOffset;
+}
+
+QVariantList BoardController::getSnapGuides() const
+{
+    return m_snapGuides;
 }
 
 void BoardController::openCloudBoard(const QString &boardId)
 {
-    if (!m_model->getAllItems().isEmpty()) {
+    if (m_model->getCount() > 0) {
         generateBoardPreview();
     }
     setCurrentBoardId(boardId);
@@ -340,7 +485,7 @@ void BoardController::openCloudBoard(const QString &boardId)
 
 void BoardController::openLocalFile(const QUrl &fileUrl)
 {
-    if (!m_model->getAllItems().isEmpty()) {
+    if (m_model->getCount() > 0) {
         generateBoardPreview();
     }
     setCurrentBoardId("");
@@ -350,17 +495,17 @@ void BoardController::openLocalFile(const QUrl &fileUrl)
 
 QString BoardController::generateBoardPreview()
 {
-    if (m_model->getAllItems().isEmpty()) return "";
+    if (m_model->getCount() == 0) return "";
 
     QString identifier = m_currentBoardId.isEmpty() ? m_storageController->getCurrentFilePath() : m_currentBoardId;
     if (identifier.isEmpty()) return "";
     
     QRectF bounds;
     bool first = true;
-    for (const auto& item : m_model->getAllItems()) {
-        if (item.pixmap.isNull()) continue;
+    for (int i = 0; i < m_model->getCount(); ++i) {
+        if (!m_model->hasPixmap(i)) continue;
         
-        QRectF rect(item.x, item.y, item.width, item.height);
+        const QRectF rect = m_model->getItemRect(i);
         if (first) {
             bounds = rect;
             first = false;
@@ -387,8 +532,9 @@ QString BoardController::generateBoardPreview()
     p.scale(512.0 / bounds.width(), 512.0 / bounds.height());
     p.translate(-bounds.x(), -bounds.y());
 
-    for (const auto& item : m_model->getAllItems()) {
-        if (item.pixmap.isNull()) continue;
+    for (int i = 0; i < m_model->getCount(); ++i) {
+        if (!m_model->hasPixmap(i)) continue;
+        const ImagoImageData item = m_model->getItem(i);
         p.save();
         p.translate(item.x + item.width/2.0, item.y + item.height/2.0);
         p.rotate(item.rotation);
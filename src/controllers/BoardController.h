@@ -4,17 +4,20 @@
 
 #include <QObject>
 #include <QUrl>
-#include <QUndoStack>
 #include <QTimer>
 #include <QtQml/qqml.h>
 
 #include "ImageModel.h"
+#include "EdgeIndex.h"
+#include "StackController.h"
 #include "StorageController.h"
 #include "SelectionController.h"
 #include "ClipboardController.h"
 #include "ToolController.h"
 #include "UpscaleController.h"
 #include "NetworkController.h"
+#include "LiveTransformController.h"
+#include "PaletteController.h"
 
 class BoardController : public QObject {
     Q_OBJECT //обязательный макрос для любого класса Qt, который использует сигналы, слоты или свойства (Q_PROPERTY)
@@ -30,6 +33,7 @@ class BoardController : public QObject {
     Q_PROPERTY(ToolController* toolController READ getToolController CONSTANT)
     Q_PROPERTY(UpscaleController* upscaleController READ getUpscaleController CONSTANT)
     Q_PROPERTY(NetworkController* networkController READ getNetworkController CONSTANT)
+    Q_PROPERTY(PaletteController* paletteController READ getPaletteController CONSTANT)
 
     //состояния для кнопок Undo/Redo
     Q_PROPERTY(bool canUndo READ getCanUndo NOTIFY undoStateChanged)
@@ -44,6 +48,12 @@ class BoardController : public QObject {
 
     Q_PROPERTY(QString currentBoardId READ getCurrentBoardId WRITE setCurrentBoardId NOTIFY currentBoardIdChanged)
 
+    //групповое перетаскивание: выделенные элементы рисуются со смещением, модель меняется только в endMoveSelection
+    Q_PROPERTY(bool groupDragActive READ isGroupDragActive NOTIFY groupDragActiveChanged)
+    Q_PROPERTY(QPointF groupDragOffset READ getGroupDragOffset NOTIFY groupDragOffsetChanged)
+    //умные направляющие при перетаскивании: список {vertical, position} в координатах сцены
+    Q_PROPERTY(QVariantList snapGuides READ getSnapGuides NOTIFY snapGuidesChanged)
+
 public:
     //конструктор принимает родительский QObject для автоматического управления памятью
     explicit BoardController(QObject *parent = nullptr);
@@ -57,6 +67,7 @@ public:
     ToolController* getToolController() const;
     UpscaleController* getUpscaleController() const;
     NetworkController* getNetworkController() const;
+    PaletteController* getPaletteController() const;
 
     bool getCanUndo() const;
     bool getCanRedo() const;
@@ -82,12 +93,16 @@ public:
     Q_INVOKABLE void beginMove(int index);
     Q_INVOKABLE void endMove(int index, qreal newX, qreal newY);
     Q_INVOKABLE void beginResize(int index);
+    Q_INVOKABLE void updateResize(int index, qreal newX, qreal newY, qreal newWidth, qreal newHeight);
     Q_INVOKABLE void endResize(int index, qreal newX, qreal newY, qreal newWidth, qreal newHeight);
 
     //отслеживание перемещения нескольких элементов (выделения)
     Q_INVOKABLE void beginMoveSelection();
     Q_INVOKABLE void updateMoveSelection(qreal deltaX, qreal deltaY);
     Q_INVOKABLE void endMoveSelection();
+    bool isGroupDragActive() const;
+    QPointF getGroupDragOffset() const;
+    QVariantList getSnapGuides() const;
 
     Q_INVOKABLE void openCloudBoard(const QString &boardId);
     Q_INVOKABLE void openLocalFile(const QUrl &fileUrl);
@@ -101,6 +116,9 @@ signals:
     void gridSizeChanged();
     void currentBoardIdChanged();
     void cameraChanged();
+    void groupDragActiveChanged();
+    void groupDragOffsetChanged();
+    void snapGuidesChanged();
 
 private:
     //вспомогательный метод для настройки сигналов
@@ -108,7 +126,7 @@ private:
 
     //внутренние переменные класса
     ImagoImageModel *m_model;
-    QUndoStack *m_undoStack;
+    UndoHistory *m_undoStack;
     int m_gridSize;
     qreal m_cameraX;
     qreal m_cameraY;
@@ -121,6 +139,8 @@ private:
     ToolController *m_toolController;
     UpscaleController *m_upscaleController;
     NetworkController *m_networkController;
+    LiveTransformController *m_liveTransforms; //трансляция перетаскивания соавторам
+    PaletteController *m_paletteController;
     QString m_currentBoardId;
 
     //переменные для хранения начального состояния объекта, когда пользователь только начинает его перетаскивать или менять размер
@@ -128,7 +148,19 @@ private:
     QRectF m_resizeStartRect;
     QPointF m_resizeStartPos;
 
-    //переменные для хранения начального состояния группы элементов при перетаскивании выделения
-    QVector<int> m_moveSelectionIndices;
-    QVector<QPointF> m_moveSelectionStartPos;
+    //начальное состояние группы элементов при перетаскивании выделения
+    struct MoveSelectionItem {
+        QString id;
+        QRectF startRect;
+        qreal rotation = 0;
+    };
+    QVector<MoveSelectionItem> m_moveSelection;
+    QRectF m_moveSelectionDeltaBounds; //допустимый диапазон смещения, чтобы группа не вышла за холст
+    QPointF m_groupDragOffset;
+
+    //края невыделенных элементов, отсортированные один раз в начале перетаскивания
+    EdgeIndex m_guideEdgesX;
+    EdgeIndex m_guideEdgesY;
+    QRectF m_moveSelectionBounds; //габариты группы в начале перетаскивания
+    QVariantList m_snapGuides;
 };
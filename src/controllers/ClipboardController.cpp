@@ -13,7 +13,7 @@
 #include <QFile>
 #include "CacheManager.h"
 
-ClipboardController::ClipboardController(ImagoImageModel *model, QUndoStack *undoStack, QObject *parent)
+ClipboardController::ClipboardController(ImagoImageModel *model, UndoHistory *undoStack, QObject *parent)
     : QObject(parent)
     , m_model(model)
     , m_undoStack(undoStack)
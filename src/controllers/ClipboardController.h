@@ -4,17 +4,17 @@
 
 #include <QObject>
 #include <QUrl>
-#include <QUndoStack>
 #include <QtQml/qqml.h>
 
 class ImagoImageModel;
+class UndoHistory;
 
 class ClipboardController : public QObject {
     Q_OBJECT
     QML_UNCREATABLE("ClipboardController is only available via BoardController.clipboardController")
 
 public:
-    explicit ClipboardController(ImagoImageModel *model, QUndoStack *undoStack, QObject *parent = nullptr);
+    explicit ClipboardController(ImagoImageModel *model, UndoHistory *undoStack, QObject *parent = nullptr);
 
     //методы добавления объектов
     Q_INVOKABLE void addImage(const QUrl &imageUrl, qreal x, qreal y);
@@ -23,5 +23,5 @@ public:
 
 private:
     ImagoImageModel *m_model;
-    QUndoStack *m_undoStack;
+    UndoHistory *m_undoStack;
 };
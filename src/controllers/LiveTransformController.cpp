@@ -0,0 +1,182 @@
+#include "LiveTransformController.h"
+#include "ImageModel.h"
+#include "NetworkController.h"
+
+#include <cmath>
+
+namespace {
+//интервал отправки (~30 Гц); за это же время интерполируется переход к новому кадру у получателя
+constexpr int C_SEND_INTERVAL_MS = 33;
+//шаг анимации интерполяции (~60 Гц)
+constexpr int C_ANIMATION_INTERVAL_MS = 16;
+}
+
+LiveTransformController::LiveTransformController(ImagoImageModel *model, NetworkController *network, QObject *parent)
+    : QObject(parent)
+    , m_model(model)
+    , m_network(network)
+{
+    m_sendTimer.setSingleShot(true);
+    m_sendTimer.setInterval(C_SEND_INTERVAL_MS);
+    connect(&m_sendTimer, &QTimer::timeout, this, &LiveTransformController::flushOutgoing);
+
+    m_animationTimer.setInterval(C_ANIMATION_INTERVAL_MS);
+    connect(&m_animationTimer, &QTimer::timeout, this, &LiveTransformController::stepInterpolation);
+
+    connect(m_network, &NetworkController::liveTransformsReceived, this, &LiveTransformController::onFramesReceived);
+    connect(m_network, &NetworkController::remoteChangesApplied, this, &LiveTransformController::onRemoteChangesApplied);
+}
+
+void LiveTransformController::publish(int index)
+{
+    if (m_applying || index < 0 || index >= m_model->getCount()) return;
+
+    publish(m_model->getItemId(index), m_model->getItemRect(index), m_model->getItemRotation(index));
+}
+
+void LiveTransformController::publish(const QString &itemId, const QRectF &rect, qreal rotation)
+{
+    if (m_applying) return;
+
+    //между отправками храним только последний сэмпл, промежуточные отбрасываются
+    SyncProtocol::LiveTransformFrame frame;
+    frame.itemId = itemId;
+    frame.rect = rect;
+    frame.rotation = rotation;
+    m_outgoing.insert(itemId, frame);
+
+    if (!m_sendTimer.isActive()) {
+        m_sendTimer.start();
+    }
+}
+
+void LiveTransformController::beginLocalEdit(const QStringList &itemIds)
+{
+    m_localItems = QSet<QString>(itemIds.begin(), itemIds.end());
+
+    //свое перетаскивание важнее чужой анимации
+    for (const QString &id : itemIds) {
+        m_interpolations.remove(id);
+    }
+}
+
+void LiveTransformController::endLocalEdit()
+{
+    m_localItems.clear();
+
+    //финальное положение уходит сразу, не дожидаясь таймера
+    if (m_sendTimer.isActive()) {
+        m_sendTimer.stop();
+        flushOutgoing();
+    }
+}
+
+bool LiveTransformController::isApplying() const
+{
+    return m_applying;
+}
+
+void LiveTransformController::flushOutgoing()
+{
+    if (m_outgoing.isEmpty()) return;
+
+    QVector<SyncProtocol::LiveTransformFrame> frames;
+    frames.reserve(m_outgoing.size());
+    for (const SyncProtocol::LiveTransformFrame &frame : std::as_const(m_outgoing)) {
+        frames.append(frame);
+    }
+    m_outgoing.clear();
+
+    m_network->sendLiveTransforms(frames);
+}
+
+void LiveTransformController::onFramesReceived(const QVector<SyncProtocol::LiveTransformFrame> &frames)
+{
+    for (const SyncProtocol::LiveTransformFrame &frame : frames) {
+        if (m_localItems.contains(frame.itemId)) continue;
+
+        int index = m_model->getIndexById(frame.itemId);
+        if (index < 0) continue;
+
+        //переход начинается с текущего (возможно, промежуточного) положения
+        ImagoImageData item = m_model->getItem(index);
+        Interpolation &interpolation = m_interpolations[frame.itemId];
+        interpolation.fromRect = QRectF(item.x, item.y, item.width, item.height);
+        interpolation.fromRotation = item.rotation;
+        interpolation.toRect = frame.rect;
+        interpolation.toRotation = frame.rotation;
+        interpolation.clock.start();
+    }
+
+    if (!m_interpolations.isEmpty() && !m_animationTimer.isActive()) {
+        m_animationTimer.start();
+    }
+}
+
+void LiveTransformController::onRemoteChangesApplied(const QStringList &itemIds)
+{
+    //пришло сохраненное состояние — оно окончательное, анимацию к устаревшему кадру прекращаем
+    for (const QString &id : itemIds) {
+        m_interpolations.remove(id);
+    }
+    if (m_interpolations.isEmpty()) {
+        m_animationTimer.stop();
+    }
+}
+
+void LiveTransformController::stepInterpolation()
+{
+    //кадр для всех элементов применяется пакетом; флаг держим до commit, когда и уходят сигналы
+    m_applying = true;
+    m_model->beginTransaction();
+
+    for (auto it = m_interpolations.begin(); it != m_interpolations.end();) {
+        int index = m_model->getIndexById(it.key());
+        if (index < 0) {
+            it = m_interpolations.erase(it);
+            continue;
+        }
+
+        qreal t = qMin<qreal>(1.0, qreal(it->clock.elapsed()) / C_SEND_INTERVAL_MS);
+        const QRectF &from = it->fromRect;
+        const QRectF &to = it->toRect;
+        QRectF rect(from.x() + (to.x() - from.x()) * t,
+                    from.y() + (to.y() - from.y()) * t,
+                    from.width() + (to.width() - from.width()) * t,
+                    from.height() + (to.height() - from.height()) * t);
+
+        //угол интерполируем по кратчайшей дуге
+        qreal deltaRotation = std::remainder(it->toRotation - it->fromRotation, 360.0);
+        qreal rotation = (t >= 1.0) ? it->toRotation : it->fromRotation + deltaRotation * t;
+
+        applyGeometry(index, rect, rotation);
+
+        if (t >= 1.0) {
+            it = m_interpolations.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    m_model->commitTransaction();
+    m_applying = false;
+
+    if (m_interpolations.isEmpty()) {
+        m_animationTimer.stop();
+    }
+}
+
+void LiveTransformController::applyGeometry(int index, const QRectF &rect, qreal rotation)
+{
+    ImagoImageData item = m_model->getItem(index);
+
+    if (item.x != rect.x() || item.y != rect.y()) {
+        m_model->setPosition(index, rect.x(), rect.y());
+    }
+    if (item.width != rect.width() || item.height != rect.height()) {
+        m_model->setSize(index, rect.width(), rect.height());
+    }
+    if (item.rotation != rotation) {
+        m_model->setRotation(index, rotation);
+    }
+}
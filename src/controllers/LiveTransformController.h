@@ -0,0 +1,63 @@
+//LiveTransformController — живая трансляция перетаскивания, ресайза и вращения между соавторами. Отправляет промежуточные положения не чаще ~30 Гц на элемент и плавно интерполирует чужие, не трогая БД и историю отмен
+
+#pragma once
+
+#include <QObject>
+#include <QHash>
+#include <QSet>
+#include <QTimer>
+#include <QElapsedTimer>
+
+#include "SyncProtocol.h"
+
+class ImagoImageModel;
+class NetworkController;
+
+class LiveTransformController : public QObject {
+    Q_OBJECT
+
+public:
+    explicit LiveTransformController(ImagoImageModel *model, NetworkController *network, QObject *parent = nullptr);
+
+    //поставить текущую геометрию элемента в очередь на отправку
+    void publish(int index);
+    //то же для геометрии, которой еще нет в модели (групповое перетаскивание до фиксации)
+    void publish(const QString &itemId, const QRectF &rect, qreal rotation);
+
+    //элементы, которые сейчас двигает локальный пользователь: чужие кадры для них игнорируются
+    void beginLocalEdit(const QStringList &itemIds);
+    void endLocalEdit();
+
+    //true, пока модель меняется из-за чужого кадра — такие изменения не сохраняются
+    bool isApplying() const;
+
+private slots:
+    void flushOutgoing();
+    void onFramesReceived(const QVector<SyncProtocol::LiveTransformFrame> &frames);
+    void onRemoteChangesApplied(const QStringList &itemIds);
+    void stepInterpolation();
+
+private:
+    //Interpolation — переход элемента от положения в момент прихода кадра к положению из кадра
+    struct Interpolation {
+        QRectF fromRect;
+        qreal fromRotation = 0;
+        QRectF toRect;
+        qreal toRotation = 0;
+        QElapsedTimer clock;
+    };
+
+    void applyGeometry(int index, const QRectF &rect, qreal rotation);
+
+    ImagoImageModel *m_model;
+    NetworkController *m_network;
+
+    QHash<QString, SyncProtocol::LiveTransformFrame> m_outgoing; //последний сэмпл каждого элемента до ближайшей отправки
+    QTimer m_sendTimer;
+
+    QHash<QString, Interpolation> m_interpolations;
+    QTimer m_animationTimer;
+
+    QSet<QString> m_localItems;
+    bool m_applying = false;
+};
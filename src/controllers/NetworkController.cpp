@@ -2,6 +2,7 @@
 #include "SettingsManager.h"
 #include "StorageController.h"
 #include "CacheManager.h"
+#include "TransferScheduler.h"
 
 #include <QJsonDocument>
 #include <QJsonObject>
@@ -9,16 +10,37 @@
 #include <QNetworkReply>
 #include <QNetworkRequest>
 #include <QFile>
+#include <QUrlQuery>
+#include <algorithm>
+
+namespace {
+//интервал склейки входящих дельт — примерно один кадр
+constexpr int C_DELTA_COALESCE_MS = 16;
+}
 
 NetworkController::NetworkController(StorageController *storage, QObject *parent)
     : QObject(parent)
     , m_storageController(storage)
     , m_networkManager(new QNetworkAccessManager(this))
     , m_webSocket(new QWebSocket())
+    , m_transfers(new TransferScheduler(m_networkManager, this))
 {
+    m_transfers->setMaxConcurrent(SettingsManager::instance().getMaxParallelTransfers());
+    connect(&SettingsManager::instance(), &SettingsManager::maxParallelTransfersChanged, this, [this]() {
+        m_transfers->setMaxConcurrent(SettingsManager::instance().getMaxParallelTransfers());
+    });
+    connect(m_transfers, &TransferScheduler::uploadFinished, this, &NetworkController::onUploadFinished);
+    connect(m_transfers, &TransferScheduler::downloadFinished, this, &NetworkController::onDownloadFinished);
+    connect(m_transfers, &TransferScheduler::progressChanged, this, &NetworkController::transferProgress);
+
     connect(m_webSocket, &QWebSocket::connected, this, &NetworkController::onConnected);
     connect(m_webSocket, &QWebSocket::disconnected, this, &NetworkController::onDisconnected);
     connect(m_webSocket, &QWebSocket::textMessageReceived, this, &NetworkController::onTextMessageReceived);
+    connect(m_webSocket, &QWebSocket::binaryMessageReceived, this, &NetworkController::onBinaryMessageReceived);
+
+    m_coalesceTimer.setSingleShot(true);
+    m_coalesceTimer.setInterval(C_DELTA_COALESCE_MS);
+    connect(&m_coalesceTimer, &QTimer::timeout, this, &NetworkController::flushIncomingDeltas);
     connect(m_webSocket, QOverload<QAbstractSocket::SocketError>::of(&QWebSocket::error), this, &NetworkController::onError);
 }
 
@@ -36,7 +58,8 @@ void NetworkController::connectToBoard(const QString &boardId)
     
     if (!boardId.isEmpty()) {
         QString token = SettingsManager::instance().getJwtToken();
-        QString urlString = QString("%1/boards/%2?token=%3").arg(WS_URL).arg(boardId).arg(token);
+        // protocol сообщает серверу, что клиент принимает бинарные дельты вместо BOARD_UPDATED
+        QString urlString = QString("%1/boards/%2?token=%3&protocol=%4").arg(WS_URL).arg(boardId).arg(token).arg(SyncProtocol::C_PROTOCOL_VERSION);
                             
         m_webSocket->open(QUrl(urlString));
         fetchMetadataAndMissingImages();
@@ -48,6 +71,12 @@ void NetworkController::disconnectFromBoard()
     if (m_webSocket->isValid()) {
         m_webSocket->close();
     }
+    m_transfers->cancelAll();
+    if (m_metadataReply) {
+        m_metadataReply->abort();
+    }
+    m_coalesceTimer.stop();
+    m_incomingDeltas.clear();
     m_currentBoardId.clear();
     m_pendingUploads = 0;
     m_uploadFailed = false;
@@ -83,6 +112,105 @@ void NetworkController::onTextMessageReceived(const QString &message)
     }
 }
 
+void NetworkController::onBinaryMessageReceived(const QByteArray &message)
+{
+    if (SyncProtocol::messageType(message) == SyncProtocol::LiveTransform) {
+        QString boardId;
+        QVector<SyncProtocol::LiveTransformFrame> frames;
+        if (SyncProtocol::decodeLiveTransform(message, boardId, frames) && boardId == m_currentBoardId) {
+            emit liveTransformsReceived(frames);
+        }
+        return;
+    }
+
+    SyncProtocol::BoardDeltaMessage delta;
+    if (!SyncProtocol::decodeBoardDelta(message, delta)) {
+        qWarning() << "Unknown binary message, type:" << SyncProtocol::messageType(message);
+        return;
+    }
+    if (delta.boardId != m_currentBoardId) return;
+
+    // Не применяем сразу: серия быстрых правок соавтора схлопнется в одно обновление модели
+    m_incomingDeltas.append(delta);
+    if (!m_coalesceTimer.isActive()) {
+        m_coalesceTimer.start();
+    }
+}
+
+void NetworkController::flushIncomingDeltas()
+{
+    if (m_incomingDeltas.isEmpty() || m_currentBoardId.isEmpty()) return;
+
+    QVector<SyncProtocol::BoardDeltaMessage> deltas;
+    deltas.swap(m_incomingDeltas);
+    std::sort(deltas.begin(), deltas.end(), [](const SyncProtocol::BoardDeltaMessage &a, const SyncProtocol::BoardDeltaMessage &b) {
+        return a.version < b.version;
+    });
+
+    // Склеиваем дельты: по каждому элементу остается последнее состояние
+    qint64 cursor = m_storageController->getBoardServerVersion(m_currentBoardId);
+    QHash<QString, QJsonObject> mergedItems;
+    QSet<QString> deletedIds;
+    QJsonObject downloadUrls;
+
+    for (const SyncProtocol::BoardDeltaMessage &delta : std::as_const(deltas)) {
+        if (delta.version <= cursor) continue; //уже получено через /metadata
+
+        // Пропущена дельта — состояние можно восстановить только запросом с курсором
+        if (delta.baseVersion > cursor) {
+            qDebug() << "Delta gap detected:" << cursor << "->" << delta.baseVersion << ". Fetching changes...";
+            fetchMetadataAndMissingImages();
+            return;
+        }
+
+        for (const QJsonValue &val : delta.items) {
+            QJsonObject itemObj = val.toObject();
+            const QString itemId = itemObj["id"].toString();
+            if (itemId.isEmpty()) continue;
+            mergedItems.insert(itemId, itemObj);
+            deletedIds.remove(itemId);
+        }
+        for (const QString &id : delta.deletedIds) {
+            mergedItems.remove(id);
+            deletedIds.insert(id);
+        }
+        for (auto it = delta.downloadUrls.begin(); it != delta.downloadUrls.end(); ++it) {
+            downloadUrls.insert(it.key(), it.value());
+        }
+        cursor = delta.version;
+    }
+
+    // Дельта без изменений элементов (все уже получено или версия сдвинулась без правок) все равно сдвигает курсор
+    if (mergedItems.isEmpty() && deletedIds.isEmpty()) {
+        if (cursor > m_storageController->getBoardServerVersion(m_currentBoardId)) {
+            m_storageController->setBoardServerVersion(m_currentBoardId, cursor);
+        }
+        return;
+    }
+
+    QJsonArray items;
+    for (const QJsonObject &itemObj : std::as_const(mergedItems)) {
+        items.append(itemObj);
+    }
+
+    QStringList changedIds;
+    QStringList removedIds;
+    QSqlDatabase::database().transaction();
+    applyIncomingItems(items, QStringList(deletedIds.begin(), deletedIds.end()), changedIds, removedIds);
+    m_storageController->setBoardServerVersion(m_currentBoardId, cursor);
+    QSqlDatabase::database().commit();
+
+    m_storageController->applyNetworkChanges(changedIds, removedIds);
+    emit remoteChangesApplied(changedIds + removedIds);
+    downloadMissingImages(downloadUrls);
+}
+
+void NetworkController::sendLiveTransforms(const QVector<SyncProtocol::LiveTransformFrame> &frames)
+{
+    if (frames.isEmpty() || m_currentBoardId.isEmpty() || !m_webSocket->isValid()) return;
+    m_webSocket->sendBinaryMessage(SyncProtocol::encodeLiveTransform(m_currentBoardId, frames));
+}
+
 // =====================================================================
 // ПАКЕТНАЯ СИНХРОНИЗАЦИЯ (ВЫЗЫВАЕТСЯ ПРИ CTRL+S)
 // =====================================================================
@@ -157,7 +285,7 @@ void NetworkController::checkMissingImagesAndUpload(const QJsonObject& boardStat
         if (urls.isEmpty()) {
             pushStateToServer(boardState);
         } else {
-            // Иначе сохраняем стейт и начинаем счетчик асинхронных загрузок
+            // Иначе сохраняем стейт и ставим выгрузки в очередь (одновременно идет не больше maxParallelTransfers)
             m_pendingBoardState = boardState;
             m_pendingUploads = urls.keys().size();
 
@@ -171,71 +299,66 @@ void NetworkController::checkMissingImagesAndUpload(const QJsonObject& boardStat
 
 void NetworkController::uploadToS3(const QString& hash, const QString& url)
 {
+    CacheManager::instance().waitForPendingSaves(); //PNG из стека отмены мог еще не дописаться
     QString imageCachePath = CacheManager::instance().getCacheFilePath(hash);
-    QFile file(imageCachePath);
-    
-    // Открываем локально, без выделения памяти через new
-    if (!file.open(QIODevice::ReadOnly)) {
+    if (!QFile::exists(imageCachePath)) {
         qWarning() << "Cannot find image in cache for upload:" << hash;
-        m_uploadFailed = true;
-        m_pendingUploads--;
-        if (m_pendingUploads == 0) {
-            emit syncFinished(false);
-        }
+        onUploadFinished(hash, false);
         return;
     }
 
-    // Вычитываем все байты в память
-    QByteArray fileData = file.readAll();
-    file.close(); // Файл больше не нужен, закрываем сразу
-
-    QNetworkRequest request((QUrl(url)));
-    // Устанавливаем заголовки. S3 требует точного совпадения Content-Type с тем, что было при генерации presigned URL
-    request.setHeader(QNetworkRequest::ContentTypeHeader, "image/png");
-    request.setHeader(QNetworkRequest::ContentLengthHeader, fileData.size());
-    
-    // Передаем QByteArray вместо файла
-    QNetworkReply *reply = m_networkManager->put(request, fileData);
-    connect(reply, &QNetworkReply::finished, this, [this, reply, hash]() {
-        if (reply->error() != QNetworkReply::NoError) {
-            qWarning() << "Failed to upload image to S3:" << hash << "Error:" << reply->errorString();
-            m_uploadFailed = true;
-        } else {
-            qDebug() << "Successfully uploaded image to S3:" << hash;
-        }
+    // Файл читается потоково во время отправки, а не целиком в память
+    m_transfers->enqueueUpload(hash, QUrl(url), imageCachePath, "image/png");
+}
 
-        reply->deleteLater();
+void NetworkController::onUploadFinished(const QString& hash, bool success)
+{
+    if (!success) {
+        qWarning() << "Failed to upload image to S3:" << hash;
+        m_uploadFailed = true;
+    } else {
+        qDebug() << "Successfully uploaded image to S3:" << hash;
+    }
 
-        // Уменьшаем счетчик. Когда дойдет до 0, заливаем JSON конфигурацию доски
-        m_pendingUploads--;
-        if (m_pendingUploads == 0) {
-            if (m_uploadFailed) {
-                emit syncFinished(false);
-            } else {
-                pushStateToServer(m_pendingBoardState);
-            }
+    // Уменьшаем счетчик. Когда дойдет до 0, заливаем JSON конфигурацию доски
+    if (m_pendingUploads <= 0) return;
+    m_pendingUploads--;
+    if (m_pendingUploads == 0) {
+        if (m_uploadFailed) {
+            emit syncFinished(false);
+        } else {
+            pushStateToServer(m_pendingBoardState);
         }
-    });
+    }
 }
 
 void NetworkController::pushStateToServer(const QJsonObject& boardState)
 {
-    QString apiUrl = API_BASE_URL + "/boards/" + m_currentBoardId + "/sync"; // На бэке нужно сделать этот PUT эндпоинт
+    const QString boardId = m_currentBoardId;
+    QString apiUrl = API_BASE_URL + "/boards/" + boardId + "/sync"; // На бэке нужно сделать этот PUT эндпоинт
     QNetworkRequest request((QUrl(apiUrl)));
     request.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
     
     QString token = SettingsManager::instance().getJwtToken();
     request.setRawHeader("Authorization", ("Bearer " + token).toUtf8());
 
-    QNetworkReply *reply = m_networkManager->put(request, QJsonDocument(boardState).toJson());
+    QByteArray body = QJsonDocument(boardState).toJson(QJsonDocument::Compact);
+    qDebug() << "Pushing board delta:" << boardState["updated_items"].toArray().size() << "items," << body.size() << "bytes";
 
-    connect(reply, &QNetworkReply::finished, this, [this, reply]() {
+    QNetworkReply *reply = m_networkManager->put(request, body);
+
+    connect(reply, &QNetworkReply::finished, this, [this, reply, boardId, boardState]() {
         if (reply->error() == QNetworkReply::NoError) {
             qDebug() << "Board state successfully synced to server!";
+
+            // Сервер может вернуть новые версии элементов: {"versions": {"<id>": <version>}}
+            QJsonObject response = QJsonDocument::fromJson(reply->readAll()).object();
             
-            // Снимаем флаги is_dirty и физически удаляем удаленные элементы из БД
-            m_storageController->markAsSynced(m_currentBoardId);
-            fetchMetadataAndMissingImages();
+            // Снимаем отправленные биты dirty_fields и физически удаляем удаленные элементы из БД
+            m_storageController->markAsSynced(boardId, boardState, response["versions"].toObject());
+            if (boardId == m_currentBoardId) {
+                fetchMetadataAndMissingImages();
+            }
             emit syncFinished(true);
         } else {
             qWarning() << "Failed to sync board state:" << reply->errorString();
@@ -251,15 +374,42 @@ void NetworkController::pushStateToServer(const QJsonObject& boardState)
 
 void NetworkController::fetchMetadataAndMissingImages()
 {
+    const QString boardId = m_currentBoardId;
+    if (boardId.isEmpty()) return;
+
+    // Новый запрос начинается с текущего курсора и покрывает все, что вернул бы предыдущий
+    if (m_metadataReply) {
+        m_metadataReply->abort();
+    }
+
     QString token = SettingsManager::instance().getJwtToken();
-    QString apiUrl = API_BASE_URL + "/boards/" + m_currentBoardId + "/metadata";
+    QUrl apiUrl(API_BASE_URL + "/boards/" + boardId + "/metadata");
+
+    // Курсор since_version: сервер вернет только элементы, измененные после этой версии
+    qint64 sinceVersion = m_storageController->getBoardServerVersion(boardId);
+    if (sinceVersion > 0) {
+        QUrlQuery query;
+        query.addQueryItem("since_version", QString::number(sinceVersion));
+        apiUrl.setQuery(query);
+    }
     
-    QNetworkRequest request((QUrl(apiUrl)));
+    QNetworkRequest request(apiUrl);
     request.setRawHeader("Authorization", ("Bearer " + token).toUtf8());
 
     QNetworkReply *reply = m_networkManager->get(request);
+    m_metadataReply = reply;
     
-    connect(reply, &QNetworkReply::finished, this, [this, reply]() {
+    connect(reply, &QNetworkReply::finished, this, [this, reply, boardId, sinceVersion]() {
+        if (m_metadataReply == reply) {
+            m_metadataReply.clear();
+        }
+
+        // Ответ для доски, которую уже закрыли: его элементы и удаления к текущей доске не относятся
+        if (boardId != m_currentBoardId) {
+            reply->deleteLater();
+            return;
+        }
+
         int statusCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
         
         // 404 означает, что мы только что авторизовались и открыли локальную доску
@@ -275,84 +425,124 @@ void NetworkController::fetchMetadataAndMissingImages()
             return;
         }
 
-        QJsonDocument doc = QJsonDocument::fromJson(reply->readAll());
+        QByteArray responseBytes = reply->readAll();
+        QJsonDocument doc = QJsonDocument::fromJson(responseBytes);
         QJsonObject response = doc.object();
         
         QJsonObject dataObj = response["data"].toObject();
         QJsonArray itemsArray = dataObj["items"].toArray();
-        bool localDbChanged = false;
+        QStringList changedIds;
+        QStringList removedIds;
         QSet<QString> serverItemIds;
+
+        // Сервер с поддержкой курсора подтверждает since_version и присылает только изменения,
+        // старый сервер игнорирует параметр и отдает доску целиком
+        bool isDelta = sinceVersion > 0 && dataObj.contains("since_version");
+        qDebug() << "Fetched board" << (isDelta ? "delta:" : "snapshot:") << itemsArray.size() << "items," << responseBytes.size() << "bytes";
         
         QSqlDatabase::database().transaction();
-        for (const QJsonValue &val : itemsArray) {
-            QJsonObject itemObj = val.toObject();
-            const QString itemId = itemObj["id"].toString();
-            if (!itemId.isEmpty()) {
-                serverItemIds.insert(itemId);
-            }
-            if (m_storageController->applyNetworkDelta("ADD_ITEM", itemObj)) {
-                localDbChanged = true;
+
+        // В дельте удаления приходят явным списком
+        QStringList deletedIds;
+        if (isDelta) {
+            for (const QJsonValue &val : dataObj["deleted_ids"].toArray()) {
+                deletedIds.append(val.toString());
             }
         }
+        applyIncomingItems(itemsArray, deletedIds, changedIds, removedIds);
+
+        if (!isDelta) {
+            for (const QJsonValue &val : itemsArray) {
+                serverItemIds.insert(val.toObject()["id"].toString());
+            }
 
-        QSqlQuery localItemsQuery;
-        localItemsQuery.prepare("SELECT id FROM items WHERE board_id = :board_id AND is_dirty = 0 AND is_deleted = 0");
-        localItemsQuery.bindValue(":board_id", m_currentBoardId);
-        if (localItemsQuery.exec()) {
-            while (localItemsQuery.next()) {
-                const QString localId = localItemsQuery.value("id").toString();
-                if (!serverItemIds.contains(localId)) {
-                    QSqlQuery deleteQuery;
-                    deleteQuery.prepare("DELETE FROM items WHERE id = :id");
-                    deleteQuery.bindValue(":id", localId);
-                    if (deleteQuery.exec()) {
-                        localDbChanged = true;
+            // В полном снимке удаленными считаются синхронизированные элементы, которых нет на сервере
+            QSqlQuery localItemsQuery;
+            localItemsQuery.prepare("SELECT id FROM items WHERE board_id = :board_id AND is_dirty = 0 AND is_deleted = 0");
+            localItemsQuery.bindValue(":board_id", boardId);
+            if (localItemsQuery.exec()) {
+                while (localItemsQuery.next()) {
+                    const QString localId = localItemsQuery.value("id").toString();
+                    if (!serverItemIds.contains(localId)) {
+                        QSqlQuery deleteQuery;
+                        deleteQuery.prepare("DELETE FROM items WHERE id = :id");
+                        deleteQuery.bindValue(":id", localId);
+                        if (deleteQuery.exec()) {
+                            removedIds.append(localId);
+                        }
                     }
                 }
             }
         }
+
+        if (dataObj.contains("version")) {
+            // Курсор пишется той доске, для которой отправлялся запрос
+            m_storageController->setBoardServerVersion(boardId, dataObj["version"].toVariant().toLongLong());
+        }
         QSqlDatabase::database().commit();
         
-        if (localDbChanged) {
-            m_storageController->loadBoardFromDb(m_currentBoardId);
-        }
+        // Применяем к модели только затронутые элементы: pixmap'ы, делегаты и история отмен сохраняются
+        m_storageController->applyNetworkChanges(changedIds, removedIds);
+        emit remoteChangesApplied(changedIds + removedIds);
 
-        QJsonObject downloadUrls = response["download_urls"].toObject();
-        for (auto it = downloadUrls.begin(); it != downloadUrls.end(); ++it) {
-            QString hash = it.key();
-            QString url = it.value().toString();
-            
-            if (!CacheManager::instance().isCached(hash)) {
-                downloadImageFromS3(hash, url);
-            }
-        }
+        downloadMissingImages(response["download_urls"].toObject());
         reply->deleteLater();
     });
 }
 
+void NetworkController::applyIncomingItems(const QJsonArray &items, const QStringList &deletedIds, QStringList &changedIds, QStringList &removedIds)
+{
+    for (const QJsonValue &val : items) {
+        QJsonObject itemObj = val.toObject();
+        if (m_storageController->applyNetworkDelta("ADD_ITEM", itemObj)) {
+            changedIds.append(itemObj["id"].toString());
+        }
+    }
+
+    for (const QString &id : deletedIds) {
+        QJsonObject deleteObj;
+        deleteObj["id"] = id;
+        if (m_storageController->applyNetworkDelta("DELETE_ITEM", deleteObj)) {
+            removedIds.append(id);
+        }
+    }
+}
+
+void NetworkController::downloadMissingImages(const QJsonObject &downloadUrls)
+{
+    for (auto it = downloadUrls.begin(); it != downloadUrls.end(); ++it) {
+        QString hash = it.key();
+        QString url = it.value().toString();
+
+        if (!CacheManager::instance().isCached(hash)) {
+            downloadImageFromS3(hash, url);
+        }
+    }
+}
+
 void NetworkController::downloadImageFromS3(const QString &hash, const QString &url)
 {
-    QNetworkRequest request((QUrl(url)));
-    QNetworkReply *reply = m_networkManager->get(request);
-    
-    connect(reply, &QNetworkReply::finished, this, [this, reply, hash]() {
-        if (reply->error() == QNetworkReply::NoError) {
-            QByteArray imageData = reply->readAll();
-            CacheManager::instance().saveToCache(hash, imageData);
-            
-            // Находим и обновляем UI элементы, связанные с этой картинкой
-            QSqlQuery q;
-            q.prepare("SELECT id FROM items WHERE board_id = :board_id AND payload LIKE :hash");
-            q.bindValue(":board_id", m_currentBoardId);
-            q.bindValue(":hash", "%" + hash + "%");
-            if (q.exec()) {
-                while (q.next()) {
-                    emit itemUpdatedFromNetwork(q.value("id").toString());
-                }
-            }
+    // Ответ пишется на диск по мере получения и сразу попадает в кэш под своим хэшем
+    m_transfers->enqueueDownload(hash, QUrl(url), CacheManager::instance().getCacheFilePath(hash));
+}
+
+void NetworkController::onDownloadFinished(const QString &hash, bool success)
+{
+    if (!success) {
+        qWarning() << "Failed to download image from S3:" << hash;
+        return;
+    }
+
+    // Находим и обновляем UI элементы, связанные с этой картинкой
+    QSqlQuery q;
+    q.prepare("SELECT id FROM items WHERE board_id = :board_id AND payload LIKE :hash");
+    q.bindValue(":board_id", m_currentBoardId);
+    q.bindValue(":hash", "%" + hash + "%");
+    if (q.exec()) {
+        while (q.next()) {
+            emit itemUpdatedFromNetwork(q.value("id").toString());
         }
-        reply->deleteLater();
-    });
+    }
 }
 
 void NetworkController::syncLocalBoardToServer()
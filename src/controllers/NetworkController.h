@@ -5,9 +5,13 @@
 #include <QWebSocket>
 #include <QtQml/qqml.h>
 #include <QJsonObject>
+#include <QPointer>
 #include <QSet>
+#include <QTimer>
+#include "SyncProtocol.h"
 
 class StorageController;
+class TransferScheduler;
 
 class NetworkController : public QObject {
     Q_OBJECT
@@ -23,40 +27,60 @@ public:
     // НОВЫЙ МЕТОД ДЛЯ Ctrl+S
     Q_INVOKABLE void syncBoardToServer();
 
+    // Промежуточные положения перетаскиваемых элементов для соавторов (без сохранения на сервере)
+    void sendLiveTransforms(const QVector<SyncProtocol::LiveTransformFrame> &frames);
+
 signals:
     void itemUpdatedFromNetwork(const QString &itemId);
+    // Элементы, к которым только что применилось авторитетное состояние с сервера
+    void remoteChangesApplied(const QStringList &itemIds);
+    void liveTransformsReceived(const QVector<SyncProtocol::LiveTransformFrame> &frames);
     
     // Сигналы для UI (можно показывать крутилку загрузки)
     void syncStarted();
     void syncFinished(bool success);
+    void transferProgress(qint64 bytesDone, qint64 bytesTotal);
     
 private slots:
     void onConnected();
     void onDisconnected();
     void onTextMessageReceived(const QString &message);
+    void onBinaryMessageReceived(const QByteArray &message);
+    void flushIncomingDeltas();
     void onError(QAbstractSocket::SocketError error);
 
 private:
     // Новые методы пакетной синхронизации
     void checkMissingImagesAndUpload(const QJsonObject& boardState, const QSet<QString>& hashes);
     void uploadToS3(const QString& hash, const QString& url);
+    void onUploadFinished(const QString& hash, bool success);
+    void onDownloadFinished(const QString& hash, bool success);
     void pushStateToServer(const QJsonObject& boardState);
 
     void fetchMetadataAndMissingImages();
+    //применяет элементы и удаления с сервера к БД, собирая id для обновления модели
+    void applyIncomingItems(const QJsonArray &items, const QStringList &deletedIds, QStringList &changedIds, QStringList &removedIds);
+    void downloadMissingImages(const QJsonObject &downloadUrls);
     void downloadImageFromS3(const QString &hash, const QString &url);
     void syncLocalBoardToServer();
 
     StorageController *m_storageController;
     QNetworkAccessManager *m_networkManager;
     QWebSocket *m_webSocket;
+    TransferScheduler *m_transfers; //очередь передачи картинок в S3 и из S3
     QString m_currentBoardId;
+    QPointer<QNetworkReply> m_metadataReply; //запрос /metadata в полете; при смене доски прерывается
 
     // Переменные для отслеживания пакетной загрузки
     int m_pendingUploads = 0;
     QJsonObject m_pendingBoardState;
     bool m_uploadFailed = false;
+
+    // Дельты из WebSocket копятся и применяются одной пачкой раз в кадр
+    QVector<SyncProtocol::BoardDeltaMessage> m_incomingDeltas;
+    QTimer m_coalesceTimer;
     
-    // API routes
-    const QString API_BASE_URL = "https://imagoref.ru/api";
-    const QString WS_URL = "wss://imagoref.ru/ws";
+    // API routes; IMAGOREF_API_URL / IMAGOREF_WS_URL подменяют сервер, например локальным в тестах
+    const QString API_BASE_URL = qEnvironmentVariable("IMAGOREF_API_URL", "https://imagoref.ru/api");
+    const QString WS_URL = qEnvironmentVariable("IMAGOREF_WS_URL", "wss://imagoref.ru/ws");
 };
@@ -0,0 +1,172 @@
+#include "PaletteController.h"
+#include "ImageModel.h"
+
+#include <QColor>
+#include <QImage>
+#include <QThread>
+#include <iterator>
+
+namespace {
+constexpr int C_IMAGE_COLORS = 6; //цветов в палитре одного изображения
+constexpr int C_BOARD_COLORS = 8; //цветов в палитре доски
+constexpr int C_REBUILD_DELAY_MS = 250; //пауза после последнего изменения модели перед пересчетом
+
+QStringList colorNames(const QVector<ColorQuantizer::Swatch> &swatches)
+{
+    QStringList names;
+    names.reserve(swatches.size());
+    for (const ColorQuantizer::Swatch &swatch : swatches) {
+        names.append(QColor(swatch.color).name());
+    }
+    return names;
+}
+}
+
+PaletteController::PaletteController(ImagoImageModel *model, QObject *parent)
+    : QObject(parent), m_model(model)
+{
+    m_pool.setMaxThreadCount(1);
+    m_pool.setThreadPriority(QThread::LowPriority);
+
+    m_rebuildTimer.setSingleShot(true);
+    m_rebuildTimer.setInterval(C_REBUILD_DELAY_MS);
+    connect(&m_rebuildTimer, &QTimer::timeout, this, &PaletteController::rebuild);
+
+    connect(m_model, &QAbstractItemModel::rowsInserted, this, &PaletteController::scheduleRebuild);
+    connect(m_model, &QAbstractItemModel::rowsRemoved, this, [this]() {
+        scheduleRebuild();
+        updateSelectionPalette();
+    });
+    connect(m_model, &QAbstractItemModel::modelReset, this, [this]() {
+        scheduleRebuild();
+        updateSelectionPalette();
+    });
+    connect(m_model, &QAbstractItemModel::dataChanged, this, [this](const QModelIndex&, const QModelIndex&, const QVector<int>& roles) {
+        //на палитру доски влияют только пиксели (Source) и площадь на холсте; перемещения ее не меняют
+        const bool pixels = roles.isEmpty() || roles.contains(ImagoImageModel::SourceRole);
+        if (pixels || roles.contains(ImagoImageModel::WidthRole) || roles.contains(ImagoImageModel::HeightRole)) {
+            scheduleRebuild();
+        }
+        if (pixels || roles.contains(ImagoImageModel::SelectedRole)) {
+            updateSelectionPalette();
+        }
+    });
+}
+
+PaletteController::~PaletteController()
+{
+    m_pool.clear();
+    m_pool.waitForDone();
+}
+
+QStringList PaletteController::getBoardPalette() const
+{
+    return m_boardPalette;
+}
+
+QStringList PaletteController::getSelectionPalette() const
+{
+    return m_selectionPalette;
+}
+
+QStringList PaletteController::getImagePalette(int index) const
+{
+    if (index < 0 || index >= m_model->getCount()) return {};
+
+    const auto it = m_cache.constFind(m_model->getItem(index).imageHash);
+    if (it == m_cache.constEnd()) return {};
+    return colorNames(*it);
+}
+
+void PaletteController::scheduleRebuild()
+{
+    m_rebuildTimer.start();
+}
+
+void PaletteController::rebuild()
+{
+    QVector<ColorQuantizer::Swatch> weighted;
+    QSet<QString> onBoard;
+    bool complete = true;
+
+    const int count = m_model->getCount();
+    for (int i = 0; i < count; ++i) {
+        if (!m_model->hasPixmap(i)) continue;
+
+        const ImagoImageData data = m_model->getItem(i);
+        if (data.imageHash.isEmpty()) continue;
+        onBoard.insert(data.imageHash);
+
+        const auto it = m_cache.constFind(data.imageHash);
+        if (it == m_cache.constEnd()) {
+            complete = false;
+            if (m_pending.contains(data.imageHash)) continue;
+
+            //QPixmap можно трогать только в GUI-потоке; для растровых pixmap toImage не копирует пиксели
+            m_pending.insert(data.imageHash);
+            const QString hash = data.imageHash;
+            const QImage image = data.pixmap.toImage();
+            m_pool.start([this, hash, image]() {
+                const QVector<ColorQuantizer::Swatch> swatches = ColorQuantizer::extract(image, C_IMAGE_COLORS);
+                QMetaObject::invokeMethod(this, [this, hash, swatches]() {
+                    onImagePalette(hash, swatches);
+                }, Qt::QueuedConnection);
+            });
+            continue;
+        }
+
+        //вклад изображения пропорционален его площади на холсте
+        const qreal area = data.width * data.height;
+        for (const ColorQuantizer::Swatch &swatch : *it) {
+            weighted.append({swatch.color, float(swatch.weight * area)});
+        }
+    }
+
+    //палитра доски сводится, когда готовы палитры всех изображений: onImagePalette вызовет rebuild снова
+    if (!complete) return;
+
+    //кэш не переживает изображения: палитры удаленных с доски и оставшихся от прошлой доски выбрасываются
+    for (auto it = m_cache.begin(); it != m_cache.end();) {
+        it = onBoard.contains(it.key()) ? std::next(it) : m_cache.erase(it);
+    }
+
+    const int generation = ++m_generation;
+    if (weighted.isEmpty()) {
+        if (!m_boardPalette.isEmpty()) {
+            m_boardPalette.clear();
+            emit boardPaletteChanged();
+        }
+        return;
+    }
+
+    m_pool.start([this, generation, weighted]() {
+        const QStringList names = colorNames(ColorQuantizer::merge(weighted, C_BOARD_COLORS));
+        QMetaObject::invokeMethod(this, [this, generation, names]() {
+            if (generation != m_generation || names == m_boardPalette) return;
+            m_boardPalette = names;
+            emit boardPaletteChanged();
+        }, Qt::QueuedConnection);
+    });
+}
+
+void PaletteController::onImagePalette(const QString &imageHash, const QVector<ColorQuantizer::Swatch> &swatches)
+{
+    m_pending.remove(imageHash);
+    m_cache.insert(imageHash, swatches);
+    emit imagePaletteReady(imageHash);
+    updateSelectionPalette();
+
+    if (m_pending.isEmpty()) scheduleRebuild();
+}
+
+void PaletteController::updateSelectionPalette()
+{
+    QStringList palette;
+    if (m_model->getSelectedCount() == 1) {
+        palette = getImagePalette(m_model->getSelectedIndices().first().toInt());
+    }
+    if (palette != m_selectionPalette) {
+        m_selectionPalette = palette;
+        emit selectionPaletteChanged();
+    }
+}
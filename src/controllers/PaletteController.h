@@ -0,0 +1,57 @@
+//PaletteController — доминирующие цвета изображений и всей доски. Палитры считаются в фоновом потоке и кэшируются по хэшу изображения
+
+#pragma once
+
+#include <QObject>
+#include <QHash>
+#include <QSet>
+#include <QStringList>
+#include <QThreadPool>
+#include <QTimer>
+#include <QtQml/qqml.h>
+
+#include "ColorQuantizer.h"
+
+class ImagoImageModel;
+
+class PaletteController : public QObject {
+    Q_OBJECT
+    QML_UNCREATABLE("PaletteController is only available via BoardController.paletteController")
+
+    //палитра доски: цвета всех изображений с учетом их площади на холсте, "#rrggbb" по убыванию веса
+    Q_PROPERTY(QStringList boardPalette READ getBoardPalette NOTIFY boardPaletteChanged)
+    //палитра единственного выделенного изображения; пустая, если выделено не одно или палитра еще считается
+    Q_PROPERTY(QStringList selectionPalette READ getSelectionPalette NOTIFY selectionPaletteChanged)
+
+public:
+    explicit PaletteController(ImagoImageModel *model, QObject *parent = nullptr);
+    ~PaletteController();
+
+    QStringList getBoardPalette() const;
+    QStringList getSelectionPalette() const;
+
+    //палитра одного изображения; пустая, пока она еще считается
+    Q_INVOKABLE QStringList getImagePalette(int index) const;
+
+signals:
+    void boardPaletteChanged();
+    void selectionPaletteChanged();
+    void imagePaletteReady(const QString &imageHash);
+
+private:
+    void scheduleRebuild();
+    void rebuild(); //запускает извлечение для новых изображений, а когда все готово — сведение палитры доски
+    void onImagePalette(const QString &imageHash, const QVector<ColorQuantizer::Swatch> &swatches);
+    void updateSelectionPalette();
+
+    ImagoImageModel *m_model;
+
+    QHash<QString, QVector<ColorQuantizer::Swatch>> m_cache; //imageHash -> палитра, только для изображений текущей доски
+    QSet<QString> m_pending; //хэши, которые сейчас считаются
+    QStringList m_boardPalette;
+    QStringList m_selectionPalette;
+    int m_generation = 0; //номер последнего сведения, устаревшие результаты отбрасываются
+
+    QTimer m_rebuildTimer; //собирает серию изменений модели в один пересчет
+    QThreadPool m_pool; //свой пул в один поток, чтобы не отнимать ядра у апскейла и загрузки
+};
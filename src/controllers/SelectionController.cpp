@@ -9,16 +9,23 @@ SelectionController::SelectionController(ImagoImageModel *model, QObject *parent
 
 bool SelectionController::getHasSelection() const
 {
-    return !m_model->getSelectedIndices().isEmpty();
+    return m_model->hasSelection();
+}
+
+int SelectionController::getSelectedCount() const
+{
+    return m_model->getSelectedCount();
 }
 
 void SelectionController::selectItem(int index, bool addToSelection)
 {
     //если клик без зажатого Shift/Ctrl, сначала снимаем выделение со всех остальных
+    m_model->beginTransaction();
     if (!addToSelection) {
         m_model->clearSelection();
     }
     m_model->setSelected(index, true);
+    m_model->commitTransaction();
     emit selectionChanged();
 }
 
@@ -30,16 +37,17 @@ void SelectionController::deselectItem(int index)
 
 void SelectionController::toggleSelection(int index)
 {
-    ImagoImageData item = m_model->getItem(index);
-    m_model->setSelected(index, !item.selected);
+    m_model->setSelected(index, !m_model->isSelected(index));
     emit selectionChanged();
 }
 
 void SelectionController::selectAll()
 {
+    m_model->beginTransaction();
     for (int i = 0; i < m_model->getCount(); ++i) {
         m_model->setSelected(i, true);
     }
+    m_model->commitTransaction();
     emit selectionChanged();
 }
 
@@ -55,6 +63,7 @@ void SelectionController::selectInRect(qreal x, qreal y, qreal width, qreal heig
     QRectF selectionRect(x, y, width, height);
     selectionRect = selectionRect.normalized(); //normalized() исправляет отрицательные ширину/высоту, он пересчитает координаты так, чтобы размеры были положительными
     
+    m_model->beginTransaction();
     if (!addToSelection) {
         m_model->clearSelection();
     }
@@ -63,13 +72,21 @@ void SelectionController::selectInRect(qreal x, qreal y, qreal width, qreal heig
     
     //проходим по всем картинкам и проверяем, пересекается ли их прямоугольник с прямоугольником рамки
     for (int i = 0; i < m_model->getCount(); ++i) {
-        ImagoImageData item = m_model->getItem(i);
-        QRectF itemRect(item.x, item.y, item.width, item.height);
+        const QRectF itemRect = m_model->getItemRect(i);
+        const qreal rotation = m_model->getItemRotation(i);
+        
+        //без поворота хватает пересечения прямоугольников
+        if (rotation == 0) {
+            if (selectionRect.intersects(itemRect) || selectionRect.contains(itemRect.center())) {
+                m_model->setSelected(i, true);
+            }
+            continue;
+        }
         
         QTransform transform;
-        transform.translate(item.x + item.width / 2.0, item.y + item.height / 2.0);
-        transform.rotate(item.rotation);
-        transform.translate(-(item.x + item.width / 2.0), -(item.y + item.height / 2.0));
+        transform.translate(itemRect.center().x(), itemRect.center().y());
+        transform.rotate(rotation);
+        transform.translate(-itemRect.center().x(), -itemRect.center().y());
         
         QPolygonF itemPolygonF = transform.map(itemRect);
         
@@ -77,6 +94,7 @@ void SelectionController::selectInRect(qreal x, qreal y, qreal width, qreal heig
             m_model->setSelected(i, true);
         }
     }
+    m_model->commitTransaction();
     
     emit selectionChanged();
 }
@@ -84,13 +102,20 @@ void SelectionController::selectInRect(qreal x, qreal y, qreal width, qreal heig
 int SelectionController::hitTest(qreal x, qreal y) const
 {
     for (int i = m_model->getCount() - 1; i >= 0; --i) {
-        ImagoImageData item = m_model->getItem(i);
-        QRectF rect(item.x, item.y, item.width, item.height);
+        const QRectF rect = m_model->getItemRect(i);
+        const qreal rotation = m_model->getItemRotation(i);
+        
+        if (rotation == 0) {
+            if (rect.contains(x, y)) {
+                return i;
+            }
+            continue;
+        }
         
         QTransform transform;
-        transform.translate(item.x + item.width / 2.0, item.y + item.height / 2.0);
-        transform.rotate(item.rotation);
-        transform.translate(-(item.x + item.width / 2.0), -(item.y + item.height / 2.0));
+        transform.translate(rect.center().x(), rect.center().y());
+        transform.rotate(rotation);
+        transform.translate(-rect.center().x(), -rect.center().y());
         
         QPolygonF polygon = transform.map(rect);
         if (polygon.containsPoint(QPointF(x, y), Qt::OddEvenFill)) {
@@ -104,28 +129,28 @@ int SelectionController::hitTest(qreal x, qreal y) const
 qreal SelectionController::getItemX(int index) const
 {
     if (index >= 0 && index < m_model->getCount())
-        return m_model->getItem(index).x;
+        return m_model->getItemRect(index).x();
     return 0;
 }
 
 qreal SelectionController::getItemY(int index) const
 {
     if (index >= 0 && index < m_model->getCount())
-        return m_model->getItem(index).y;
+        return m_model->getItemRect(index).y();
     return 0;
 }
 
 qreal SelectionController::getItemWidth(int index) const
 {
     if (index >= 0 && index < m_model->getCount())
-        return m_model->getItem(index).width;
+        return m_model->getItemRect(index).width();
     return 0;
 }
 
 qreal SelectionController::getItemHeight(int index) const
 {
     if (index >= 0 && index < m_model->getCount())
-        return m_model->getItem(index).height;
+        return m_model->getItemRect(index).height();
     return 0;
 }
 
@@ -139,6 +164,6 @@ qreal SelectionController::getItemOpacity(int index) const
 bool SelectionController::getIsItemSelected(int index) const
 {
     if (index >= 0 && index < m_model->getCount())
-        return m_model->getItem(index).selected;
+        return m_model->isSelected(index);
     return false;
 }
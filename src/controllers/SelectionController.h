@@ -14,12 +14,14 @@ class SelectionController : public QObject {
 
     //свойство активного/неактивного выбора картинки
     Q_PROPERTY(bool hasSelection READ getHasSelection NOTIFY selectionChanged)
+    Q_PROPERTY(int selectedCount READ getSelectedCount NOTIFY selectionChanged)
 
 public:
     explicit SelectionController(ImagoImageModel *model, QObject *parent = nullptr);
 
     //метод, который проверяет, есть ли хоть одна выделенная картинка
     bool getHasSelection() const;
+    int getSelectedCount() const;
 
     //выделение
     Q_INVOKABLE void selectItem(int index, bool addToSelection = false);
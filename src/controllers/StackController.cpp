@@ -1,5 +1,114 @@
 #include "StackController.h"
 #include "ImageModel.h"
+#include "CacheManager.h"
+
+#include <memory>
+
+namespace {
+//постоянная часть цены команды: сам объект, id и координаты. Ограничивает и историю из одних перемещений
+constexpr qint64 C_COMMAND_BYTES = 4 * 1024;
+//сколько пикселей может держать история отмены
+constexpr qint64 C_UNDO_BUDGET_BYTES = qint64(1024) * 1024 * 1024;
+
+//снимок для стека отмены: пиксели уходят в кэш, в команде остается только хэш
+ImagoImageData compactSnapshot(const ImagoImageData &item)
+{
+    ImagoImageData snapshot = item;
+    if (!snapshot.imageHash.isEmpty() && !snapshot.pixmap.isNull()) {
+        CacheManager::instance().retainPixmap(snapshot.imageHash, snapshot.pixmap);
+        snapshot.pixmap = QPixmap();
+    }
+    return snapshot;
+}
+
+//обратное: картинка возвращается из кэша по хэшу
+ImagoImageData rehydrate(ImagoImageData snapshot)
+{
+    if (snapshot.pixmap.isNull() && !snapshot.imageHash.isEmpty()) {
+        snapshot.pixmap = CacheManager::instance().loadPixmap(snapshot.imageHash);
+    }
+    return snapshot;
+}
+
+//строки команды запоминаются как id: после удаления/вставки строк индексы сдвигаются, а id остаются
+QStringList itemIds(ImagoImageModel *model, const QVector<int> &indices)
+{
+    QStringList ids;
+    ids.reserve(indices.size());
+    for (int index : indices) {
+        ids.append(model->getItem(index).id);
+    }
+    return ids;
+}
+
+//цена команды в байтах: постоянная часть плюс пиксели в кэше, которые держат она и ее дочерние команды.
+//Общая картинка у двух команд считается дважды — бюджет оценивается сверху
+qint64 commandBytes(const QUndoCommand *command)
+{
+    QStringList hashes;
+    if (auto *add = dynamic_cast<const AddImageCommand*>(command)) hashes = add->retainedHashes();
+    else if (auto *remove = dynamic_cast<const RemoveImageCommand*>(command)) hashes = remove->retainedHashes();
+    else if (auto *upscale = dynamic_cast<const UpscaleImageCommand*>(command)) hashes = upscale->retainedHashes();
+
+    qint64 bytes = C_COMMAND_BYTES;
+    for (const QString &hash : std::as_const(hashes)) {
+        bytes += CacheManager::instance().pixmapBytes(hash);
+    }
+    for (int i = 0; i < command->childCount(); ++i) {
+        bytes += commandBytes(command->child(i));
+    }
+    return bytes;
+}
+
+//HistoryEntry — обертка над командой в UndoHistory. Команду можно забрать из обертки и переложить в новый
+//стек уже выполненной: тогда первый redo пропускается
+class HistoryEntry : public QUndoCommand {
+public:
+    explicit HistoryEntry(QUndoCommand *command, qint64 bytes = -1)
+        : QUndoCommand(command->text())
+        , m_command(command)
+        , m_done(bytes >= 0)
+        , m_bytes(bytes)
+    {
+    }
+
+    void undo() override { m_command->undo(); }
+
+    void redo() override
+    {
+        if (m_done) {
+            m_done = false;
+            return;
+        }
+        m_command->redo();
+        //цена считается после первого выполнения: добавление заполняет снимок только в redo
+        if (m_bytes < 0) m_bytes = commandBytes(m_command.get());
+    }
+
+    //переложенные команды не склеиваются друг с другом: их границы уже выбрал пользователь
+    int id() const override { return m_mergeable ? m_command->id() : -1; }
+
+    bool mergeWith(const QUndoCommand *other) override
+    {
+        auto *entry = dynamic_cast<const HistoryEntry*>(other);
+        if (!entry || !m_command->mergeWith(entry->m_command.get())) return false;
+        setText(m_command->text());
+        //склеенная команда держит и картинки присоединенной
+        m_bytes = commandBytes(m_command.get());
+        return true;
+    }
+
+    qint64 bytes() const { return qMax<qint64>(m_bytes, C_COMMAND_BYTES); }
+    void setMergeable(bool mergeable) { m_mergeable = mergeable; }
+    QUndoCommand *take() { return m_command.release(); }
+
+private:
+    std::unique_ptr<QUndoCommand> m_command;
+    bool m_done;
+    bool m_mergeable = true;
+    qint64 m_bytes;
+};
+}
 
 AddImageCommand::AddImageCommand(ImagoImageModel *model, const QString &imageId, const QUrl &source, qreal x, qreal y, qreal w, qreal h, QUndoCommand *parent) : QUndoCommand("Добавление изображения", parent)
     , m_model(model)
@@ -24,12 +133,17 @@ void AddImageCommand::redo()
         m_firstRedo = false;
         int idx = m_model->getIndexById(m_imageId);
         if (idx >= 0) {
-            m_data = m_model->getItem(idx);
+            m_data = compactSnapshot(m_model->getItem(idx));
         }
         return; //изображение уже добавлено при создании команды
     }
     
-    m_model->addImage(m_data);
+    m_model->addImage(rehydrate(m_data));
+}
+
+QStringList AddImageCommand::retainedHashes() const
+{
+    return m_data.imageHash.isEmpty() ? QStringList() : QStringList{m_data.imageHash};
 }
 
 RemoveImageCommand::RemoveImageCommand(ImagoImageModel *model, const QList<int> &indices, QUndoCommand *parent) : QUndoCommand(QString("Удаление %1 элементов").arg(indices.count()), parent)
@@ -40,16 +154,16 @@ RemoveImageCommand::RemoveImageCommand(ImagoImageModel *model, const QList<int>
     std::sort(sortedIndices.begin(), sortedIndices.end(), std::greater<int>());
     
     for (int idx : sortedIndices) {
-        ImagoImageData item = m_model->getItem(idx);
-        m_snapshots.append(item);
+        m_snapshots.append(compactSnapshot(m_model->getItem(idx)));
+        m_rows.append(idx);
     }
 }
 
 void RemoveImageCommand::undo()
 {
-    //восстанавливаем в обратном порядке (чтобы индексы были правильными)
+    //восстанавливаем по возрастанию строк, тогда каждая вставка попадает на свою исходную строку
     for (int i = m_snapshots.count() - 1; i >= 0; --i) {
-        m_model->addImage(m_snapshots[i]);
+        m_model->insertImage(m_rows[i], rehydrate(m_snapshots[i]));
     }
 }
 
@@ -60,9 +174,18 @@ void RemoveImageCommand::redo()
     }
 }
 
+QStringList RemoveImageCommand::retainedHashes() const
+{
+    QStringList hashes;
+    for (const ImagoImageData &snap : m_snapshots) {
+        if (!snap.imageHash.isEmpty()) hashes.append(snap.imageHash);
+    }
+    return hashes;
+}
+
 MoveImageCommand::MoveImageCommand(ImagoImageModel *model, int index, const QPointF &oldPos, const QPointF &newPos, QUndoCommand *parent) : QUndoCommand("Перемещение элемента", parent)
     , m_model(model)
-    , m_index(index)
+    , m_id(model->getItem(index).id)
     , m_oldPos(oldPos)
     , m_newPos(newPos)
 {
@@ -70,12 +193,12 @@ MoveImageCommand::MoveImageCommand(ImagoImageModel *model, int index, const QPoi
 
 void MoveImageCommand::undo()
 {
-    m_model->setPosition(m_index, m_oldPos.x(), m_oldPos.y());
+    m_model->setPosition(m_model->getIndexById(m_id), m_oldPos.x(), m_oldPos.y());
 }
 
 void MoveImageCommand::redo()
 {
-    m_model->setPosition(m_index, m_newPos.x(), m_newPos.y());
+    m_model->setPosition(m_model->getIndexById(m_id), m_newPos.x(), m_newPos.y());
 }
 
 bool MoveImageCommand::mergeWith(const QUndoCommand *other)
@@ -84,7 +207,7 @@ bool MoveImageCommand::mergeWith(const QUndoCommand *other)
         return false;
 
     const MoveImageCommand *cmd = static_cast<const MoveImageCommand*>(other);
-    if (cmd->m_index != m_index)
+    if (cmd->m_id != m_id)
         return false;
 
     m_newPos = cmd->m_newPos;
@@ -93,7 +216,7 @@ bool MoveImageCommand::mergeWith(const QUndoCommand *other)
 
 MoveImagesCommand::MoveImagesCommand(ImagoImageModel *model, const QVector<int>& indices, const QVector<QPointF> &oldPos, const QVector<QPointF> &newPos, QUndoCommand *parent) : QUndoCommand("Перемещение элементов", parent)
     , m_model(model)
-    , m_indices(indices)
+    , m_ids(itemIds(model, indices))
     , m_oldPos(oldPos)
     , m_newPos(newPos)
 {
@@ -101,16 +224,20 @@ MoveImagesCommand::MoveImagesCommand(ImagoImageModel *model, const QVector<int>&
 
 void MoveImagesCommand::undo()
 {
-    for (int i = 0; i < m_indices.size(); ++i) {
-        m_model->setPosition(m_indices[i], m_oldPos[i].x(), m_oldPos[i].y());
+    m_model->beginTransaction();
+    for (int i = 0; i < m_ids.size(); ++i) {
+        m_model->setPosition(m_model->getIndexById(m_ids[i]), m_oldPos[i].x(), m_oldPos[i].y());
     }
+    m_model->commitTransaction();
 }
 
 void MoveImagesCommand::redo()
 {
-    for (int i = 0; i < m_indices.size(); ++i) {
-        m_model->setPosition(m_indices[i], m_newPos[i].x(), m_newPos[i].y());
+    m_model->beginTransaction();
+    for (int i = 0; i < m_ids.size(); ++i) {
+        m_model->setPosition(m_model->getIndexById(m_ids[i]), m_newPos[i].x(), m_newPos[i].y());
     }
+    m_model->commitTransaction();
 }
 
 bool MoveImagesCommand::mergeWith(const QUndoCommand *other)
@@ -119,7 +246,7 @@ bool MoveImagesCommand::mergeWith(const QUndoCommand *other)
         return false;
 
     const MoveImagesCommand *cmd = static_cast<const MoveImagesCommand*>(other);
-    if (cmd->m_indices != m_indices) // Must be exactly the same subset of indices
+    if (cmd->m_ids != m_ids) // Must be exactly the same subset of items
         return false;
 
     m_newPos = cmd->m_newPos;
@@ -128,7 +255,7 @@ bool MoveImagesCommand::mergeWith(const QUndoCommand *other)
 
 ResizeImageCommand::ResizeImageCommand(ImagoImageModel *model, int index, const QRectF &oldRect, const QPointF &oldPos, const QRectF &newRect, const QPointF &newPos, QUndoCommand *parent) : QUndoCommand("Изменение размера", parent)
     , m_model(model)
-    , m_index(index)
+    , m_id(model->getItem(index).id)
     , m_oldRect(oldRect), m_newRect(newRect)
     , m_oldPos(oldPos), m_newPos(newPos)
 {
@@ -136,38 +263,40 @@ ResizeImageCommand::ResizeImageCommand(ImagoImageModel *model, int index, const
 
 void ResizeImageCommand::undo()
 {
-    m_model->setPosition(m_index, m_oldPos.x(), m_oldPos.y());
-    m_model->setSize(m_index, m_oldRect.width(), m_oldRect.height());
+    m_model->setPosition(m_model->getIndexById(m_id), m_oldPos.x(), m_oldPos.y());
+    m_model->setSize(m_model->getIndexById(m_id), m_oldRect.width(), m_oldRect.height());
 }
 
 void ResizeImageCommand::redo()
 {
-    m_model->setPosition(m_index, m_newPos.x(), m_newPos.y());
-    m_model->setSize(m_index, m_newRect.width(), m_newRect.height());
+    m_model->setPosition(m_model->getIndexById(m_id), m_newPos.x(), m_newPos.y());
+    m_model->setSize(m_model->getIndexById(m_id), m_newRect.width(), m_newRect.height());
 }
 
 RotateImageCommand::RotateImageCommand(ImagoImageModel *model, int index, qreal angleDelta, QUndoCommand *parent) : QUndoCommand("Вращение элемента", parent)
     , m_model(model)
-    , m_index(index)
+    , m_id(model->getItem(index).id)
     , m_angleDelta(angleDelta)
 {
 }
 
 void RotateImageCommand::undo()
 {
-    ImagoImageData item = m_model->getItem(m_index);
-    m_model->setRotation(m_index, item.rotation - m_angleDelta);
+    int index = m_model->getIndexById(m_id);
+    if (index < 0) return;
+    m_model->setRotation(index, m_model->getItem(index).rotation - m_angleDelta);
 }
 
 void RotateImageCommand::redo()
 {
-    ImagoImageData item = m_model->getItem(m_index);
-    m_model->setRotation(m_index, item.rotation + m_angleDelta);
+    int index = m_model->getIndexById(m_id);
+    if (index < 0) return;
+    m_model->setRotation(index, m_model->getItem(index).rotation + m_angleDelta);
 }
 
 CropImageCommand::CropImageCommand(ImagoImageModel *model, int index, const QPointF &oldPos, const QSizeF &oldSize, const QRectF &oldCrop, const QPointF &newPos, const QSizeF &newSize, const QRectF &newCrop, QUndoCommand *parent) : QUndoCommand("Обрезка изображения", parent)
     , m_model(model)
-    , m_index(index)
+    , m_id(model->getItem(index).id)
     , m_oldPos(oldPos), m_newPos(newPos)
     , m_oldSize(oldSize), m_newSize(newSize)
     , m_oldCrop(oldCrop), m_newCrop(newCrop)
@@ -176,21 +305,21 @@ CropImageCommand::CropImageCommand(ImagoImageModel *model, int index, const QPoi
 
 void CropImageCommand::undo()
 {
-    m_model->setPosition(m_index, m_oldPos.x(), m_oldPos.y());
-    m_model->setSize(m_index, m_oldSize.width(), m_oldSize.height());
-    m_model->setCrop(m_index, m_oldCrop.x(), m_oldCrop.y(), m_oldCrop.width(), m_oldCrop.height());
+    m_model->setPosition(m_model->getIndexById(m_id), m_oldPos.x(), m_oldPos.y());
+    m_model->setSize(m_model->getIndexById(m_id), m_oldSize.width(), m_oldSize.height());
+    m_model->setCrop(m_model->getIndexById(m_id), m_oldCrop.x(), m_oldCrop.y(), m_oldCrop.width(), m_oldCrop.height());
 }
 
 void CropImageCommand::redo()
 {
-    m_model->setPosition(m_index, m_newPos.x(), m_newPos.y());
-    m_model->setSize(m_index, m_newSize.width(), m_newSize.height());
-    m_model->setCrop(m_index, m_newCrop.x(), m_newCrop.y(), m_newCrop.width(), m_newCrop.height());
+    m_model->setPosition(m_model->getIndexById(m_id), m_newPos.x(), m_newPos.y());
+    m_model->setSize(m_model->getIndexById(m_id), m_newSize.width(), m_newSize.height());
+    m_model->setCrop(m_model->getIndexById(m_id), m_newCrop.x(), m_newCrop.y(), m_newCrop.width(), m_newCrop.height());
 }
 
 SetLabelCommand::SetLabelCommand(ImagoImageModel *model, int index, const QString &oldLabel, const QString &newLabel, QUndoCommand *parent) : QUndoCommand("Изменение подписи", parent)
     , m_model(model)
-    , m_index(index)
+    , m_id(model->getItem(index).id)
     , m_oldLabel(oldLabel)
     , m_newLabel(newLabel)
 {
@@ -198,17 +327,17 @@ SetLabelCommand::SetLabelCommand(ImagoImageModel *model, int index, const QStrin
 
 void SetLabelCommand::undo()
 {
-    m_model->setLabel(m_index, m_oldLabel);
+    m_model->setLabel(m_model->getIndexById(m_id), m_oldLabel);
 }
 
 void SetLabelCommand::redo()
 {
-    m_model->setLabel(m_index, m_newLabel);
+    m_model->setLabel(m_model->getIndexById(m_id), m_newLabel);
 }
 
 SetOpacityCommand::SetOpacityCommand(ImagoImageModel *model, const QVector<int> &indices, const QVector<qreal> &oldOpacities, qreal newOpacity, QUndoCommand *parent) : QUndoCommand("Изменение непрозрачности", parent)
     , m_model(model)
-    , m_indices(indices)
+    , m_ids(itemIds(model, indices))
     , m_oldOpacities(oldOpacities)
     , m_newOpacity(newOpacity)
 {
@@ -216,16 +345,20 @@ SetOpacityCommand::SetOpacityCommand(ImagoImageModel *model, const QVector<int>
 
 void SetOpacityCommand::undo()
 {
-    for (int i = 0; i < m_indices.count(); ++i) {
-        m_model->setOpacity(m_indices[i], m_oldOpacities[i]);
+    m_model->beginTransaction();
+    for (int i = 0; i < m_ids.size(); ++i) {
+        m_model->setOpacity(m_model->getIndexById(m_ids[i]), m_oldOpacities[i]);
     }
+    m_model->commitTransaction();
 }
 
 void SetOpacityCommand::redo()
 {
-    for (int i = 0; i < m_indices.count(); ++i) {
-        m_model->setOpacity(m_indices[i], m_newOpacity);
+    m_model->beginTransaction();
+    for (int i = 0; i < m_ids.size(); ++i) {
+        m_model->setOpacity(m_model->getIndexById(m_ids[i]), m_newOpacity);
     }
+    m_model->commitTransaction();
 }
 
 bool SetOpacityCommand::mergeWith(const QUndoCommand *other)
@@ -234,7 +367,7 @@ bool SetOpacityCommand::mergeWith(const QUndoCommand *other)
         return false;
 
     const SetOpacityCommand *cmd = static_cast<const SetOpacityCommand*>(other);
-    if (cmd->m_indices != m_indices) // Must be exactly the same subset of indices
+    if (cmd->m_ids != m_ids) // Must be exactly the same subset of items
         return false;
 
     m_newOpacity = cmd->m_newOpacity;
@@ -243,7 +376,7 @@ bool SetOpacityCommand::mergeWith(const QUndoCommand *other)
 
 ArrangeCommand::ArrangeCommand(ImagoImageModel *model, const QVector<int> &indices, const QVector<QPointF> &oldPositions, const QVector<QPointF> &newPositions, QUndoCommand *parent) : QUndoCommand("Расположить изображения", parent)
     , m_model(model)
-    , m_indices(indices)
+    , m_ids(itemIds(model, indices))
     , m_oldPositions(oldPositions)
     , m_newPositions(newPositions)
 {
@@ -251,23 +384,25 @@ ArrangeCommand::ArrangeCommand(ImagoImageModel *model, const QVector<int> &indic
 
 void ArrangeCommand::undo()
 {
-    for (int i = 0; i < m_indices.count(); ++i) {
-        m_model->setPosition(m_indices[i], m_oldPositions[i].x(), m_oldPositions[i].y());
+    m_model->beginTransaction();
+    for (int i = 0; i < m_ids.size(); ++i) {
+        m_model->setPosition(m_model->getIndexById(m_ids[i]), m_oldPositions[i].x(), m_oldPositions[i].y());
     }
+    m_model->commitTransaction();
 }
 
 void ArrangeCommand::redo()
 {
-    for (int i = 0; i < m_indices.count(); ++i) {
-        m_model->setPosition(m_indices[i], m_newPositions[i].x(), m_newPositions[i].y());
+    m_model->beginTransaction();
+    for (int i = 0; i < m_ids.size(); ++i) {
+        m_model->setPosition(m_model->getIndexById(m_ids[i]), m_newPositions[i].x(), m_newPositions[i].y());
     }
+    m_model->commitTransaction();
 }
 
-UpscaleImageCommand::UpscaleImageCommand(ImagoImageModel *model, int index, const QPixmap &oldPix, const QRectF &oldCrop, const QString &oldHash, const QPixmap &newPix, const QRectF &newCrop, const QString &newHash, QUndoCommand *parent) : QUndoCommand(parent)
+UpscaleImageCommand::UpscaleImageCommand(ImagoImageModel *model, int index, const QRectF &oldCrop, const QString &oldHash, const QRectF &newCrop, const QString &newHash, QUndoCommand *parent) : QUndoCommand(parent)
     , m_model(model)
-    , m_index(index)
-    , m_oldPix(oldPix)
-    , m_newPix(newPix)
+    , m_id(model->getItem(index).id)
     , m_oldCrop(oldCrop)
     , m_newCrop(newCrop)
     , m_oldHash(oldHash)
@@ -276,13 +411,107 @@ UpscaleImageCommand::UpscaleImageCommand(ImagoImageModel *model, int index, cons
 }
 
 void UpscaleImageCommand::undo() {
-    m_model->setPixmap(m_index, m_oldPix);
-    m_model->setImageHash(m_index, m_oldHash); // Восстанавливаем старый хэш
-    m_model->setCrop(m_index, m_oldCrop.x(), m_oldCrop.y(), m_oldCrop.width(), m_oldCrop.height());
+    apply(m_oldHash, m_oldCrop);
 }
 
 void UpscaleImageCommand::redo() {
-    m_model->setPixmap(m_index, m_newPix);
-    m_model->setImageHash(m_index, m_newHash); // Применяем новый хэш
-    m_model->setCrop(m_index, m_newCrop.x(), m_newCrop.y(), m_newCrop.width(), m_newCrop.height());
+    apply(m_newHash, m_newCrop);
+}
+
+QStringList UpscaleImageCommand::retainedHashes() const {
+    return {m_oldHash, m_newHash};
+}
+
+void UpscaleImageCommand::apply(const QString &hash, const QRectF &crop) {
+    int index = m_model->getIndexById(m_id);
+    if (index < 0) return;
+
+    //пиксели берутся из кэша: в памяти стека хранятся только хэши
+    QPixmap pixmap = CacheManager::instance().loadPixmap(hash);
+    //картинка, хэш и обрезка меняются одной транзакцией: подписчики видят один dataChanged
+    m_model->beginTransaction();
+    if (!pixmap.isNull()) {
+        m_model->setPixmap(index, pixmap);
+    }
+    m_model->setImageHash(index, hash);
+    m_model->setCrop(index, crop.x(), crop.y(), crop.width(), crop.height());
+    m_model->commitTransaction();
+}
+
+UndoHistory::UndoHistory(QObject *parent) : QObject(parent)
+    , m_byteBudget(C_UNDO_BUDGET_BYTES)
+{
+    connect(&m_stack, &QUndoStack::canUndoChanged, this, &UndoHistory::canUndoChanged);
+    connect(&m_stack, &QUndoStack::canRedoChanged, this, &UndoHistory::canRedoChanged);
+}
+
+void UndoHistory::push(QUndoCommand *command)
+{
+    m_stack.push(new HistoryEntry(command));
+    trimToBudget();
+}
+
+void UndoHistory::setByteBudget(qint64 bytes)
+{
+    m_byteBudget = bytes;
+    trimToBudget();
+}
+
+qint64 UndoHistory::retainedBytes() const
+{
+    qint64 total = 0;
+    for (int i = 0; i < m_stack.count(); ++i) {
+        total += static_cast<const HistoryEntry*>(m_stack.command(i))->bytes();
+    }
+    return total;
+}
+
+void UndoHistory::trimToBudget()
+{
+    //обрезаем только сразу после push: тогда все команды выполнены и отмена идет с вершины
+    const int total = count();
+    if (total <= 1 || index() != total) return;
+
+    QVector<HistoryEntry*> entries;
+    entries.reserve(total);
+    qint64 bytes = 0;
+    for (int i = 0; i < total; ++i) {
+        //в стеке только обертки: другого пути в m_stack, кроме push, нет
+        auto *entry = static_cast<HistoryEntry*>(const_cast<QUndoCommand*>(m_stack.command(i)));
+        entries.append(entry);
+        bytes += entry->bytes();
+    }
+    if (bytes <= m_byteBudget) return;
+
+    //выбрасываем с запасом до трех четвертей бюджета, чтобы не пересобирать стек на каждом следующем push.
+    //Последняя команда остается, даже если одна не помещается в бюджет
+    const qint64 target = m_byteBudget - m_byteBudget / 4;
+    int dropped = 0;
+    while (dropped < total - 1 && bytes > target) {
+        bytes -= entries[dropped]->bytes();
+        ++dropped;
+    }
+
+    //QUndoStack не умеет удалять команды снизу: забираем оставшиеся команды из оберток и собираем стек заново
+    QVector<QUndoCommand*> kept;
+    QVector<qint64> keptBytes;
+    for (int i = dropped; i < total; ++i) {
+        keptBytes.append(entries[i]->bytes());
+        kept.append(entries[i]->take());
+    }
+    const int cleanRow = m_stack.cleanIndex() - dropped; //чистое состояние могло уйти вместе со старыми командами
+    m_stack.clear();
+
+    for (int i = 0; i < kept.size(); ++i) {
+        if (i == cleanRow) m_stack.setClean();
+        auto *entry = new HistoryEntry(kept[i], keptBytes[i]);
+        entry->setMergeable(false);
+        m_stack.push(entry);
+        if (i == kept.size() - 1) entry->setMergeable(true); //к вершине снова можно приклеить перемещение
+    }
+    if (cleanRow == kept.size()) {
+        m_stack.setClean();
+    } else if (cleanRow < 0) {
+        m_stack.resetClean();
+    }
 }
@@ -3,10 +3,12 @@
 #pragma once
 
 #include <QUndoCommand>
+#include <QUndoStack>
 #include <QPointF>
 #include <QRectF>
 #include <QSizeF>
 #include <QString>
+#include <QStringList>
 #include <QUrl>
 
 #include "ImageModel.h"
@@ -17,6 +19,7 @@ public:
     AddImageCommand(ImagoImageModel *model, const QString &imageId, const QUrl &source, qreal x, qreal y, qreal w, qreal h, QUndoCommand *parent = nullptr);
     void undo() override;
     void redo() override;
+    QStringList retainedHashes() const; //картинки в кэше, которые держит команда
 
 private:
     ImagoImageModel *m_model;
@@ -31,10 +34,12 @@ public:
     RemoveImageCommand(ImagoImageModel *model, const QList<int> &indices, QUndoCommand *parent = nullptr);
     void undo() override;
     void redo() override;
+    QStringList retainedHashes() const;
 
 private:
     ImagoImageModel *m_model;
     QList<ImagoImageData> m_snapshots;
+    QList<int> m_rows; //исходные строки снимков: отмена возвращает элементы на свои места
 };
 
 //MoveImageCommand - команда перемещения изображения
@@ -48,7 +53,7 @@ public:
 
 private:
     ImagoImageModel *m_model;
-    int m_index;
+    QString m_id; //строки сдвигаются при удалении/вставке, поэтому команда помнит id
     QPointF m_oldPos;
     QPointF m_newPos;
 };
@@ -64,7 +69,7 @@ public:
 
 private:
     ImagoImageModel *m_model;
-    QVector<int> m_indices;
+    QStringList m_ids;
     QVector<QPointF> m_oldPos;
     QVector<QPointF> m_newPos;
 };
@@ -78,7 +83,7 @@ public:
 
 private:
     ImagoImageModel *m_model;
-    int m_index;
+    QString m_id;
     QRectF m_oldRect, m_newRect;
     QPointF m_oldPos, m_newPos;
 };
@@ -92,7 +97,7 @@ public:
 
 private:
     ImagoImageModel *m_model;
-    int m_index;
+    QString m_id;
     qreal m_angleDelta;
 };
 
@@ -105,7 +110,7 @@ public:
 
 private:
     ImagoImageModel *m_model;
-    int m_index;
+    QString m_id;
     QPointF m_oldPos, m_newPos;
     QSizeF m_oldSize, m_newSize;
     QRectF m_oldCrop, m_newCrop;
@@ -120,7 +125,7 @@ public:
 
 private:
     ImagoImageModel *m_model;
-    int m_index;
+    QString m_id;
     QString m_oldLabel, m_newLabel;
 };
 
@@ -135,7 +140,7 @@ public:
 
 private:
     ImagoImageModel *m_model;
-    QVector<int> m_indices;
+    QStringList m_ids;
     QVector<qreal> m_oldOpacities;
     qreal m_newOpacity;
 };
@@ -149,21 +154,64 @@ public:
 
 private:
     ImagoImageModel *m_model;
-    QVector<int> m_indices;
+    QStringList m_ids;
     QVector<QPointF> m_oldPositions, m_newPositions;
 };
 
-//UpscaleImageCommand - команда применения/отмены увеличения разрешения
+//UpscaleImageCommand - команда применения/отмены увеличения разрешения. Хранит только хэши картинок,
+//сами пиксели на undo/redo берутся из CacheManager
 class UpscaleImageCommand : public QUndoCommand {
 public:
-    UpscaleImageCommand(ImagoImageModel *model, int index, const QPixmap &oldPix, const QRectF &oldCrop, const QString &oldHash, const QPixmap &newPix, const QRectF &newCrop, const QString &newHash, QUndoCommand *parent = nullptr);
+    UpscaleImageCommand(ImagoImageModel *model, int index, const QRectF &oldCrop, const QString &oldHash, const QRectF &newCrop, const QString &newHash, QUndoCommand *parent = nullptr);
     void undo() override;
     void redo() override;
-    
+    QStringList retainedHashes() const;
+
 private:
+    void apply(const QString &hash, const QRectF &crop);
+
     ImagoImageModel *m_model;
-    int m_index;
-    QPixmap m_oldPix, m_newPix;
+    QString m_id;
     QRectF m_oldCrop, m_newCrop;
-    QString m_oldHash, m_newHash; // Добавили хранение хэшей
+    QString m_oldHash, m_newHash;
+};
+
+//UndoHistory - стек отмены с бюджетом по байтам вместо лимита по числу команд. Команда стоит столько,
+//сколько пикселей держит в кэше (добавление, удаление, апскейл), плюс небольшая постоянная часть;
+//когда сумма превышает бюджет, самые старые команды выбрасываются. QUndoStack спрятан внутри: каждая команда
+//проходит через push и оборачивается, иначе стек нельзя пересобрать при обрезке. Макросов нет — вместо них
+//команда-родитель с дочерними командами
+class UndoHistory : public QObject {
+    Q_OBJECT
+
+public:
+    explicit UndoHistory(QObject *parent = nullptr);
+
+    void push(QUndoCommand *command);
+    void undo() { m_stack.undo(); }
+    void redo() { m_stack.redo(); }
+    void clear() { m_stack.clear(); }
+
+    bool canUndo() const { return m_stack.canUndo(); }
+    bool canRedo() const { return m_stack.canRedo(); }
+    int count() const { return m_stack.count(); }
+    int index() const { return m_stack.index(); }
+
+    void setClean() { m_stack.setClean(); }
+    bool isClean() const { return m_stack.isClean(); }
+    int cleanIndex() const { return m_stack.cleanIndex(); }
+
+    void setByteBudget(qint64 bytes);
+    qint64 byteBudget() const { return m_byteBudget; }
+    qint64 retainedBytes() const;
+
+signals:
+    void canUndoChanged(bool canUndo);
+    void canRedoChanged(bool canRedo);
+
+private:
+    void trimToBudget();
+
+    QUndoStack m_stack;
+    qint64 m_byteBudget;
 };
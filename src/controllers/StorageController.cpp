@@ -1,6 +1,7 @@
 #include "StorageController.h"
 #include "ImageModel.h"
 #include "BoardController.h"
+#include "StackController.h"
 
 #include <QFile>
 #include <QFileInfo>
@@ -20,8 +21,89 @@
 #include "CacheManager.h"
 #include <QDebug>
 #include <QVariantMap>
+#include <QSqlRecord>
 
-StorageController::StorageController(ImagoImageModel *model, QUndoStack *undoStack, QObject *parent) : QObject(parent)
+namespace {
+//соответствие битов маски SyncField ключам JSON-представления элемента
+struct SyncFieldKeys {
+    int field;
+    bool inPayload; //ключи лежат во вложенном объекте payload
+    QStringList keys;
+};
+
+const QVector<SyncFieldKeys>& syncFieldKeys()
+{
+    static const QVector<SyncFieldKeys> table = {
+        {SyncPosition, false, {"x", "y"}},
+        {SyncSize, false, {"width", "height"}},
+        {SyncZValue, false, {"z_index"}},
+        {SyncRotation, true, {"rotation"}},
+        {SyncLabel, true, {"label"}},
+        {SyncCrop, true, {"cropX", "cropY", "cropWidth", "cropHeight"}},
+        {SyncOpacity, true, {"opacity"}},
+        {SyncImage, true, {"imageHash"}}
+    };
+    return table;
+}
+
+//копирование из src в dst только тех полей, которые отмечены в маске fields
+void copySyncFields(QJsonObject &dst, const QJsonObject &src, int fields)
+{
+    QJsonObject dstPayload = dst["payload"].toObject();
+    const QJsonObject srcPayload = src["payload"].toObject();
+
+    for (const SyncFieldKeys &group : syncFieldKeys()) {
+        if (!(fields & group.field)) continue;
+
+        const QJsonObject &from = group.inPayload ? srcPayload : src;
+        QJsonObject &to = group.inPayload ? dstPayload : dst;
+        for (const QString &key : group.keys) {
+            if (from.contains(key)) {
+                to[key] = from[key];
+            }
+        }
+    }
+
+    if (dstPayload.isEmpty()) {
+        dst.remove("payload");
+    } else {
+        dst["payload"] = dstPayload;
+    }
+}
+
+//JSON-представление строки таблицы items (в том же формате, что приходит с сервера)
+QJsonObject itemRowToJson(const QSqlQuery &q)
+{
+    QJsonObject itemObj;
+    itemObj["id"] = q.value("id").toString();
+    itemObj["board_id"] = q.value("board_id").toString();
+    itemObj["type"] = q.value("type").toString();
+    itemObj["x"] = q.value("x").toDouble();
+    itemObj["y"] = q.value("y").toDouble();
+    itemObj["width"] = q.value("width").toDouble();
+    itemObj["height"] = q.value("height").toDouble();
+    itemObj["z_index"] = q.value("z_index").toInt();
+    itemObj["payload"] = QJsonDocument::fromJson(q.value("payload").toString().toUtf8()).object();
+    itemObj["updated_at"] = q.value("updated_at").toLongLong();
+    return itemObj;
+}
+
+//добавление колонки в существующую таблицу (миграция старых баз). Возвращает true, если колонка была создана
+bool ensureColumn(const QString &table, const QString &column, const QString &definition)
+{
+    if (QSqlDatabase::database().record(table).contains(column)) {
+        return false;
+    }
+    QSqlQuery q;
+    if (!q.exec(QString("ALTER TABLE %1 ADD COLUMN %2 %3").arg(table, column, definition))) {
+        qWarning() << "Failed to migrate column" << table << column << q.lastError().text();
+        return false;
+    }
+    return true;
+}
+}
+
+StorageController::StorageController(ImagoImageModel *model, UndoHistory *undoStack, QObject *parent) : QObject(parent)
     , m_model(model)
     , m_undoStack(undoStack)
 {
@@ -68,7 +150,26 @@ void StorageController::initDatabase()
            "payload TEXT, "
            "updated_at INTEGER, "
            "is_dirty INTEGER DEFAULT 1, "
-           "is_deleted INTEGER DEFAULT 0)");
+           "is_deleted INTEGER DEFAULT 0, "
+           "version INTEGER DEFAULT 0, "
+           "dirty_fields INTEGER DEFAULT 0)");
+
+    //результаты апскейла: (исходный хэш, кроп, модель) -> хэш результата в кэше картинок
+    q.exec("CREATE TABLE IF NOT EXISTS upscale_cache ("
+           "source_hash TEXT, "
+           "crop TEXT, "
+           "model_id TEXT, "
+           "result_hash TEXT, "
+           "created_at INTEGER, "
+           "PRIMARY KEY (source_hash, crop, model_id))");
+
+    //миграция баз, созданных до появления дельта-синхронизации
+    ensureColumn("boards", "server_version", "INTEGER DEFAULT 0");
+    ensureColumn("items", "version", "INTEGER DEFAULT 0");
+    if (ensureColumn("items", "dirty_fields", "INTEGER DEFAULT 0")) {
+        //про старые несинхронизированные элементы неизвестно, что именно менялось — отправляем их целиком
+        q.exec(QString("UPDATE items SET dirty_fields = %1 WHERE is_dirty = 1").arg(SyncAllFields));
+    }
 }
 
 QVariantList StorageController::getLocalBoards()
@@ -295,8 +396,8 @@ bool StorageController::importFromIref(const QString& filePath)
                 payloadObj["opacity"] = data.opacity;
                 payloadObj["imageHash"] = data.imageHash;
 
-                q.prepare("INSERT OR REPLACE INTO items (id, board_id, type, x, y, width, height, z_index, payload, updated_at, is_dirty, is_deleted) "
-                          "VALUES (:id, :board_id, :type, :x, :y, :width, :height, :z_index, :payload, :updated, 1, 0)");
+                q.prepare("INSERT OR REPLACE INTO items (id, board_id, type, x, y, width, height, z_index, payload, updated_at, is_dirty, is_deleted, version, dirty_fields) "
+                          "VALUES (:id, :board_id, :type, :x, :y, :width, :height, :z_index, :payload, :updated, 1, 0, 0, :dirty_fields)");
                 q.bindValue(":id", data.id);
                 q.bindValue(":board_id", boardId);
                 q.bindValue(":type", "image");
@@ -307,6 +408,7 @@ bool StorageController::importFromIref(const QString& filePath)
                 q.bindValue(":z_index", data.zValue);
                 q.bindValue(":payload", QString(QJsonDocument(payloadObj).toJson(QJsonDocument::Compact)));
                 q.bindValue(":updated", QDateTime::currentSecsSinceEpoch());
+                q.bindValue(":dirty_fields", SyncAllFields);
                 q.exec();
             }
         }
@@ -350,6 +452,7 @@ bool StorageController::exportToIref(const QString& boardId, const QString& file
     QJsonArray itemsArray;
 
     if (!exportBoardId.isEmpty()) {
+        CacheManager::instance().waitForPendingSaves(); //файлы кэша читаются напрямую
         QSqlQuery q;
         // ЭКСПОРТИРУЕМ ТОЛЬКО НЕ УДАЛЕННЫЕ ЭЛЕМЕНТЫ
         q.prepare("SELECT * FROM items WHERE board_id = :board_id AND is_deleted = 0");
@@ -457,8 +560,38 @@ bool StorageController::exportToIref(const QString& boardId, const QString& file
     return true;
 }
 
-void StorageController::upsertItem(const ImagoImageData &item)
+int StorageController::fieldsForRoles(const QVector<int> &roles)
 {
+    //пустой список ролей означает, что могло измениться что угодно
+    if (roles.isEmpty()) return SyncAllFields;
+
+    int fields = 0;
+    for (int role : roles) {
+        switch (role) {
+        case ImagoImageModel::XRole:
+        case ImagoImageModel::YRole: fields |= SyncPosition; break;
+        case ImagoImageModel::WidthRole:
+        case ImagoImageModel::HeightRole: fields |= SyncSize; break;
+        case ImagoImageModel::ZValueRole: fields |= SyncZValue; break;
+        case ImagoImageModel::RotationRole: fields |= SyncRotation; break;
+        case ImagoImageModel::LabelRole: fields |= SyncLabel; break;
+        case ImagoImageModel::CropXRole:
+        case ImagoImageModel::CropYRole:
+        case ImagoImageModel::CropWidthRole:
+        case ImagoImageModel::CropHeightRole: fields |= SyncCrop; break;
+        case ImagoImageModel::OpacityRole: fields |= SyncOpacity; break;
+        case ImagoImageModel::SourceRole: fields |= SyncImage; break;
+        case ImagoImageModel::IdRole: fields |= SyncAllFields; break;
+        default: break; //выделение и прочие локальные роли не синхронизируются
+        }
+    }
+    return fields;
+}
+
+void StorageController::upsertItem(const ImagoImageData &item, int fields)
+{
+    if (fields == 0) return;
+
     BoardController* board = qobject_cast<BoardController*>(parent());
     QString boardId = board ? board->getCurrentBoardId() : "";
     if (boardId.isEmpty()) return;
@@ -473,19 +606,51 @@ void StorageController::upsertItem(const ImagoImageData &item)
     payloadObj["opacity"] = item.opacity;
     payloadObj["imageHash"] = item.imageHash;
 
+    QJsonObject itemObj;
+    itemObj["x"] = item.x;
+    itemObj["y"] = item.y;
+    itemObj["width"] = item.width;
+    itemObj["height"] = item.height;
+    itemObj["z_index"] = item.zValue;
+    itemObj["payload"] = payloadObj;
+
+    //из модели берутся только измененные поля, остальные — из строки БД: в модели могут быть чужие
+    //промежуточные положения (живое перетаскивание соавтора), которых нет ни на сервере, ни локально
+    if (fields != SyncAllFields) {
+        QSqlQuery stored;
+        stored.prepare("SELECT * FROM items WHERE id = :id AND is_deleted = 0");
+        stored.bindValue(":id", item.id);
+        if (stored.exec() && stored.next()) {
+            QJsonObject row = itemRowToJson(stored);
+            copySyncFields(row, itemObj, fields);
+            itemObj = row;
+            payloadObj = row["payload"].toObject();
+        }
+    }
+
+    //маска изменённых полей накапливается до следующей успешной синхронизации
     QSqlQuery q;
-    q.prepare("INSERT OR REPLACE INTO items (id, board_id, type, x, y, width, height, z_index, payload, updated_at, is_dirty, is_deleted) "
-              "VALUES (:id, :board_id, :type, :x, :y, :width, :height, :z_index, :payload, :updated, 1, 0)");
+    q.prepare("INSERT INTO items (id, board_id, type, x, y, width, height, z_index, payload, updated_at, is_dirty, is_deleted, version, dirty_fields) "
+              "VALUES (:id, :board_id, :type, :x, :y, :width, :height, :z_index, :payload, :updated, 1, 0, 0, :dirty_fields) "
+              "ON CONFLICT(id) DO UPDATE SET "
+              "board_id = excluded.board_id, type = excluded.type, x = excluded.x, y = excluded.y, "
+              "width = excluded.width, height = excluded.height, z_index = excluded.z_index, "
+              "payload = excluded.payload, updated_at = excluded.updated_at, is_dirty = 1, "
+              "dirty_fields = CASE WHEN items.is_deleted = 1 THEN excluded.dirty_fields | :all_fields "
+              "ELSE items.dirty_fields | excluded.dirty_fields END, "
+              "is_deleted = 0");
     q.bindValue(":id", item.id);
     q.bindValue(":board_id", boardId);
     q.bindValue(":type", "image");
-    q.bindValue(":x", item.x);
-    q.bindValue(":y", item.y);
-    q.bindValue(":width", item.width);
-    q.bindValue(":height", item.height);
-    q.bindValue(":z_index", item.zValue);
+    q.bindValue(":x", itemObj["x"].toDouble());
+    q.bindValue(":y", itemObj["y"].toDouble());
+    q.bindValue(":width", itemObj["width"].toDouble());
+    q.bindValue(":height", itemObj["height"].toDouble());
+    q.bindValue(":z_index", itemObj["z_index"].toDouble());
     q.bindValue(":payload", QString(QJsonDocument(payloadObj).toJson(QJsonDocument::Compact)));
     q.bindValue(":updated", QDateTime::currentSecsSinceEpoch());
+    q.bindValue(":dirty_fields", fields);
+    q.bindValue(":all_fields", SyncAllFields);
     
     if (!q.exec()) {
         qWarning() << "Failed to upsert item:" << q.lastError().text();
@@ -526,38 +691,78 @@ void StorageController::updateBoardMetadata(qreal camX, qreal camY, qreal camZoo
 
 bool StorageController::applyNetworkDelta(const QString& actionType, const QJsonObject& payload)
 {
-    // Этот метод мы позже адаптируем под Snapshot Sync, пока оставляем базовую вставку
     QString itemId = payload["id"].toString();
     if (itemId.isEmpty()) itemId = payload["item_id"].toString();
     if (itemId.isEmpty()) return false;
 
-    qint64 networkUpdated = payload.contains("updated_at") ? payload["updated_at"].toVariant().toLongLong() : QDateTime::currentSecsSinceEpoch();
-
     if (actionType == "DELETE_ITEM") {
-        deleteItem(itemId);
-        return true;
+        //удаление на сервере окончательное, локальная строка больше не нужна
+        QSqlQuery qDelete;
+        qDelete.prepare("DELETE FROM items WHERE id = :id");
+        qDelete.bindValue(":id", itemId);
+        return qDelete.exec() && qDelete.numRowsAffected() > 0;
+    }
+
+    qint64 serverVersion = payload["version"].toVariant().toLongLong();
+
+    QSqlQuery local;
+    local.prepare("SELECT * FROM items WHERE id = :id");
+    local.bindValue(":id", itemId);
+
+    QJsonObject merged;
+    QJsonObject before;
+    int dirtyFields = 0;
+    qint64 localVersion = 0;
+    bool isDeleted = false;
+
+    if (local.exec() && local.next()) {
+        localVersion = local.value("version").toLongLong();
+        //эта версия (или более новая) уже применена
+        if (serverVersion > 0 && localVersion >= serverVersion) return false;
+
+        dirtyFields = local.value("dirty_fields").toInt();
+        isDeleted = local.value("is_deleted").toInt() == 1;
+        before = itemRowToJson(local);
+        merged = before;
+
+        //локально изменённые и ещё не отправленные поля не затираем
+        copySyncFields(merged, payload, SyncAllFields & ~dirtyFields);
+    } else {
+        merged = payload;
+        merged["type"] = payload["type"].toString("image");
     }
 
+    bool changed = before.isEmpty() || merged != before;
+    qint64 networkUpdated = payload.contains("updated_at") ? payload["updated_at"].toVariant().toLongLong() : QDateTime::currentSecsSinceEpoch();
+    QString boardId = payload["board_id"].toString();
+    if (boardId.isEmpty()) boardId = merged["board_id"].toString();
+
     QSqlQuery q;
-    q.prepare("INSERT OR REPLACE INTO items (id, board_id, type, x, y, width, height, z_index, payload, updated_at, is_dirty, is_deleted) "
-              "VALUES (:id, :board_id, :type, :x, :y, :width, :height, :z_index, :payload, :updated_at, 0, 0)");
+    q.prepare("INSERT OR REPLACE INTO items (id, board_id, type, x, y, width, height, z_index, payload, updated_at, is_dirty, is_deleted, version, dirty_fields) "
+              "VALUES (:id, :board_id, :type, :x, :y, :width, :height, :z_index, :payload, :updated_at, :is_dirty, :is_deleted, :version, :dirty_fields)");
     q.bindValue(":id", itemId);
-    q.bindValue(":board_id", payload["board_id"].toString());
-    q.bindValue(":type", payload["type"].toString("image"));
-    q.bindValue(":x", payload["x"].toDouble());
-    q.bindValue(":y", payload["y"].toDouble());
-    q.bindValue(":width", payload["width"].toDouble());
-    q.bindValue(":height", payload["height"].toDouble());
-    q.bindValue(":z_index", payload["z_index"].toInt());
-    
-    QJsonObject innerPayload = payload["payload"].toObject();
-    q.bindValue(":payload", QString(QJsonDocument(innerPayload).toJson(QJsonDocument::Compact)));
+    q.bindValue(":board_id", boardId);
+    q.bindValue(":type", merged["type"].toString("image"));
+    q.bindValue(":x", merged["x"].toDouble());
+    q.bindValue(":y", merged["y"].toDouble());
+    q.bindValue(":width", merged["width"].toDouble());
+    q.bindValue(":height", merged["height"].toDouble());
+    q.bindValue(":z_index", merged["z_index"].toInt());
+    q.bindValue(":payload", QString(QJsonDocument(merged["payload"].toObject()).toJson(QJsonDocument::Compact)));
     q.bindValue(":updated_at", networkUpdated);
-    
-    return q.exec();
+    q.bindValue(":is_dirty", (dirtyFields != 0 || isDeleted) ? 1 : 0);
+    q.bindValue(":is_deleted", isDeleted ? 1 : 0);
+    q.bindValue(":version", qMax(localVersion, serverVersion));
+    q.bindValue(":dirty_fields", dirtyFields);
+
+    if (!q.exec()) {
+        qWarning() << "Failed to apply network delta:" << q.lastError().text();
+        return false;
+    }
+    return changed;
 }
 
-ImagoImageData StorageController::getItemFromDb(const QString& itemId)
+ImagoImageData StorageController::getItemFromDb(const QString& itemId, bool loadPixmap)
 {
     ImagoImageData data;
     QSqlQuery q;
@@ -582,12 +787,61 @@ ImagoImageData StorageController::getItemFromDb(const QString& itemId)
     data.opacity = inner.contains("opacity") ? inner["opacity"].toDouble() : 1.0;
     data.imageHash = inner["imageHash"].toString();
     
-    QString imageCachePath = CacheManager::instance().getCacheFilePath(data.imageHash);
-    data.pixmap.load(imageCachePath);
+    if (loadPixmap) {
+        QString imageCachePath = CacheManager::instance().getCacheFilePath(data.imageHash);
+        data.pixmap.load(imageCachePath);
+    }
     
     return data;
 }
 
+void StorageController::applyNetworkChanges(const QStringList& changedIds, const QStringList& removedIds)
+{
+    if (changedIds.isEmpty() && removedIds.isEmpty()) return;
+
+    //изменения уже лежат в БД — блокируем обратную запись из сигналов модели
+    m_isLoading = true;
+
+    for (const QString &id : removedIds) {
+        m_model->removeImageById(id);
+    }
+
+    for (const QString &id : changedIds) {
+        int idx = m_model->getIndexById(id);
+        if (idx < 0) {
+            //новый элемент от другого участника
+            ImagoImageData data = getItemFromDb(id);
+            if (!data.id.isEmpty()) {
+                m_model->addImage(data);
+            }
+            continue;
+        }
+
+        ImagoImageData data = getItemFromDb(id, false);
+        if (data.id.isEmpty()) {
+            m_model->removeImageById(id);
+            continue;
+        }
+
+        const ImagoImageData current = m_model->getItem(idx);
+        data.selected = current.selected;
+
+        if (data.imageHash == current.imageHash && !current.pixmap.isNull()) {
+            //картинка не менялась — переиспользуем уже декодированный pixmap и адрес для QML
+            data.pixmap = current.pixmap;
+            data.source = current.source;
+            data.version = current.version;
+        } else {
+            data.pixmap = CacheManager::instance().loadFromCache(data.imageHash);
+            data.version = QDateTime::currentMSecsSinceEpoch(); //сброс кэша QML
+        }
+
+        m_model->updateItemData(id, data);
+    }
+
+    m_isLoading = false;
+}
+
 void StorageController::loadBoardFromDb(const QString& boardId)
 {
     m_isLoading = true;
@@ -648,17 +902,21 @@ QJsonObject StorageController::getUnsyncedBoardState(const QString& boardId)
             if (q.value("is_deleted").toInt() == 1) {
                 deletedItems.append(q.value("id").toString());
             } else {
+                QJsonObject row = itemRowToJson(q);
+                qint64 version = q.value("version").toLongLong();
+
+                //элемент, которого ещё нет на сервере, отправляем целиком, остальные — только изменённые поля
+                int fields = q.value("dirty_fields").toInt();
+                if (version == 0 || fields == 0) fields = SyncAllFields;
+
                 QJsonObject itemObj;
-                itemObj["id"] = q.value("id").toString();
+                itemObj["id"] = row["id"];
                 itemObj["board_id"] = boardId;
-                itemObj["type"] = q.value("type").toString();
-                itemObj["x"] = q.value("x").toDouble();
-                itemObj["y"] = q.value("y").toDouble();
-                itemObj["width"] = q.value("width").toDouble();
-                itemObj["height"] = q.value("height").toDouble();
-                itemObj["z_index"] = q.value("z_index").toInt();
-                itemObj["payload"] = QJsonDocument::fromJson(q.value("payload").toString().toUtf8()).object();
-                itemObj["updated_at"] = q.value("updated_at").toLongLong();
+                itemObj["type"] = row["type"];
+                itemObj["base_version"] = version;
+                itemObj["fields"] = fields;
+                itemObj["updated_at"] = row["updated_at"];
+                copySyncFields(itemObj, row, fields);
                 
                 updatedItems.append(itemObj);
             }
@@ -670,23 +928,61 @@ QJsonObject StorageController::getUnsyncedBoardState(const QString& boardId)
     return state;
 }
 
-void StorageController::markAsSynced(const QString& boardId)
+void StorageController::markAsSynced(const QString& boardId, const QJsonObject& pushedState, const QJsonObject& serverVersions)
 {
-    // Физически удаляем из БД записи, которые были помечены как is_deleted
+    QSqlDatabase::database().transaction();
+
+    //физически удаляем из БД записи, удаление которых подтвердил сервер
     QSqlQuery qDelete;
-    qDelete.prepare("DELETE FROM items WHERE board_id = :board_id AND is_deleted = 1");
-    qDelete.bindValue(":board_id", boardId);
-    qDelete.exec();
+    qDelete.prepare("DELETE FROM items WHERE id = :id AND is_deleted = 1");
+    for (const QJsonValue &val : pushedState["deleted_items"].toArray()) {
+        qDelete.bindValue(":id", val.toString());
+        qDelete.exec();
+    }
 
-    // Снимаем флаг is_dirty с остальных
+    //снимаем только отправленные биты: поля, изменённые во время запроса, останутся грязными
     QSqlQuery qUpdate;
-    qUpdate.prepare("UPDATE items SET is_dirty = 0 WHERE board_id = :board_id");
-    qUpdate.bindValue(":board_id", boardId);
-    qUpdate.exec();
+    qUpdate.prepare("UPDATE items SET "
+                    "dirty_fields = dirty_fields & ~:fields, "
+                    "is_dirty = CASE WHEN (dirty_fields & ~:fields) = 0 AND is_deleted = 0 THEN 0 ELSE 1 END, "
+                    "version = MAX(version, :version) "
+                    "WHERE id = :id");
+    for (const QJsonValue &val : pushedState["updated_items"].toArray()) {
+        QJsonObject itemObj = val.toObject();
+        QString id = itemObj["id"].toString();
+        qUpdate.bindValue(":fields", itemObj["fields"].toInt(SyncAllFields));
+        qUpdate.bindValue(":version", serverVersions[id].toVariant().toLongLong());
+        qUpdate.bindValue(":id", id);
+        qUpdate.exec();
+    }
 
-    // Снимаем флаг с самой доски
+    //снимаем флаг с самой доски
     QSqlQuery qBoard;
     qBoard.prepare("UPDATE boards SET is_dirty = 0 WHERE id = :id");
     qBoard.bindValue(":id", boardId);
     qBoard.exec();
+
+    QSqlDatabase::database().commit();
+}
+
+qint64 StorageController::getBoardServerVersion(const QString& boardId)
+{
+    QSqlQuery q;
+    q.prepare("SELECT server_version FROM boards WHERE id = :id");
+    q.bindValue(":id", boardId);
+    if (q.exec() && q.next()) {
+        return q.value("server_version").toLongLong();
+    }
+    return 0;
+}
+
+void StorageController::setBoardServerVersion(const QString& boardId, qint64 version)
+{
+    QSqlQuery q;
+    q.prepare("UPDATE boards SET server_version = :version WHERE id = :id");
+    q.bindValue(":version", version);
+    q.bindValue(":id", boardId);
+    if (!q.exec()) {
+        qWarning() << "Failed to update board server version:" << q.lastError().text();
+    }
 }
@@ -4,7 +4,6 @@
 
 #include <QObject>
 #include <QUrl>
-#include <QUndoStack>
 #include <QtQml/qqml.h>
 #include <QSqlDatabase>
 #include <QSqlQuery>
@@ -13,6 +12,20 @@
 #include "ImageModel.h"
 
 class ImagoImageModel;
+class UndoHistory;
+
+//SyncField — битовая маска полей элемента, изменённых локально с момента последней синхронизации
+enum SyncField : int {
+    SyncPosition = 1 << 0, //x, y
+    SyncSize = 1 << 1, //width, height
+    SyncZValue = 1 << 2, //z_index
+    SyncRotation = 1 << 3, //payload.rotation
+    SyncLabel = 1 << 4, //payload.label
+    SyncCrop = 1 << 5, //payload.cropX/cropY/cropWidth/cropHeight
+    SyncOpacity = 1 << 6, //payload.opacity
+    SyncImage = 1 << 7, //payload.imageHash
+    SyncAllFields = 0xFF
+};
 
 class StorageController : public QObject {
     Q_OBJECT
@@ -24,7 +37,7 @@ class StorageController : public QObject {
     Q_PROPERTY(QString windowTitle READ getWindowTitle NOTIFY filePathChanged)
 
 public:
-    explicit StorageController(ImagoImageModel *model, QUndoStack *undoStack, QObject *parent = nullptr);
+    explicit StorageController(ImagoImageModel *model, UndoHistory *undoStack, QObject *parent = nullptr);
     ~StorageController();
 
     // Статические методы для работы с БД (для BoardsManager)
@@ -40,17 +53,24 @@ public:
     QString getBoardTitle(const QString& boardId);
 
     //методы синхронизации и атомарных сохранений
-    void upsertItem(const ImagoImageData &item);
+    static int fieldsForRoles(const QVector<int> &roles); //перевод ролей модели в маску SyncField
+    void upsertItem(const ImagoImageData &item, int fields = SyncAllFields);
     void deleteItem(const QString &itemId);
     void updateBoardMetadata(qreal camX, qreal camY, qreal camZoom);
     void loadBoardFromDb(const QString& boardId);
 
     //новые методы для пакетной синхронизации (State-based Sync)
     QJsonObject getUnsyncedBoardState(const QString& boardId);
-    void markAsSynced(const QString& boardId);
+    void markAsSynced(const QString& boardId, const QJsonObject& pushedState, const QJsonObject& serverVersions = QJsonObject());
+
+    //серверный курсор доски (since_version) для инкрементальной загрузки изменений
+    qint64 getBoardServerVersion(const QString& boardId);
+    void setBoardServerVersion(const QString& boardId, qint64 version);
 
     bool applyNetworkDelta(const QString& actionType, const QJsonObject& payload);
-    ImagoImageData getItemFromDb(const QString& itemId);
+    //точечное применение сетевых изменений к модели без перезагрузки доски и без очистки undo-стека
+    void applyNetworkChanges(const QStringList& changedIds, const QStringList& removedIds);
+    ImagoImageData getItemFromDb(const QString& itemId, bool loadPixmap = true);
     bool isLoading() const { return m_isLoading; }
 
     //методы операций
@@ -78,7 +98,7 @@ private:
 
     //внутренние поля класса
     ImagoImageModel *m_model;
-    QUndoStack *m_undoStack;
+    UndoHistory *m_undoStack;
     QString m_currentFilePath;
     int m_gridSize = 25;
     bool m_isLoading = false;
@@ -0,0 +1,191 @@
+#include "SyncProtocol.h"
+
+#include <QCborArray>
+#include <QCborMap>
+#include <QCborValue>
+#include <QJsonValue>
+
+namespace SyncProtocol {
+
+namespace {
+
+//ключи конверта сообщения
+enum EnvelopeKey : int {
+    KeyType = 0,
+    KeyBoardId = 1,
+    KeyBaseVersion = 2,
+    KeyVersion = 3,
+    KeyItems = 4,
+    KeyDeletedIds = 5,
+    KeyDownloadUrls = 6,
+    KeyFrames = 7
+};
+
+//известные поля элемента и его payload кодируются числами, остальные передаются строкой как есть
+const QStringList& itemKeys()
+{
+    static const QStringList keys = {
+        "id", "board_id", "type", "x", "y", "width", "height", "z_index", "version", "updated_at", "payload"
+    };
+    return keys;
+}
+
+const QStringList& payloadKeys()
+{
+    static const QStringList keys = {
+        "rotation", "label", "cropX", "cropY", "cropWidth", "cropHeight", "opacity", "imageHash"
+    };
+    return keys;
+}
+
+QCborMap packObject(const QJsonObject &object, const QStringList &keys, bool nestedPayload)
+{
+    QCborMap map;
+    for (auto it = object.begin(); it != object.end(); ++it) {
+        QCborValue value = (nestedPayload && it.key() == "payload")
+            ? QCborValue(packObject(it.value().toObject(), payloadKeys(), false))
+            : QCborValue::fromJsonValue(it.value());
+
+        int index = keys.indexOf(it.key());
+        if (index >= 0) {
+            map.insert(qint64(index), value);
+        } else {
+            map.insert(it.key(), value);
+        }
+    }
+    return map;
+}
+
+QJsonObject unpackObject(const QCborMap &map, const QStringList &keys, bool nestedPayload)
+{
+    QJsonObject object;
+    for (auto it = map.begin(); it != map.end(); ++it) {
+        QString key;
+        if (it.key().isInteger()) {
+            qint64 index = it.key().toInteger();
+            if (index < 0 || index >= keys.size()) continue; //поле из более новой версии протокола
+            key = keys.at(int(index));
+        } else {
+            key = it.key().toString();
+        }
+
+        if (nestedPayload && key == "payload") {
+            object.insert(key, unpackObject(it.value().toMap(), payloadKeys(), false));
+        } else {
+            object.insert(key, it.value().toJsonValue());
+        }
+    }
+    return object;
+}
+
+}
+
+int messageType(const QByteArray &data)
+{
+    QCborValue root = QCborValue::fromCbor(data);
+    if (!root.isMap()) return 0;
+    return int(root.toMap().value(qint64(KeyType)).toInteger());
+}
+
+QByteArray encodeBoardDelta(const BoardDeltaMessage &message)
+{
+    QCborArray items;
+    for (const QJsonValue &item : message.items) {
+        items.append(packObject(item.toObject(), itemKeys(), true));
+    }
+
+    QCborArray deletedIds;
+    for (const QString &id : message.deletedIds) {
+        deletedIds.append(id);
+    }
+
+    QCborMap map;
+    map.insert(qint64(KeyType), qint64(BoardDelta));
+    map.insert(qint64(KeyBoardId), message.boardId);
+    map.insert(qint64(KeyBaseVersion), message.baseVersion);
+    map.insert(qint64(KeyVersion), message.version);
+    map.insert(qint64(KeyItems), items);
+    if (!deletedIds.isEmpty()) map.insert(qint64(KeyDeletedIds), deletedIds);
+    if (!message.downloadUrls.isEmpty()) map.insert(qint64(KeyDownloadUrls), QCborMap::fromJsonObject(message.downloadUrls));
+
+    return map.toCborValue().toCbor();
+}
+
+bool decodeBoardDelta(const QByteArray &data, BoardDeltaMessage &message)
+{
+    QCborParserError error;
+    QCborValue root = QCborValue::fromCbor(data, &error);
+    if (error.error != QCborError::NoError || !root.isMap()) return false;
+
+    QCborMap map = root.toMap();
+    if (map.value(qint64(KeyType)).toInteger() != BoardDelta) return false;
+
+    message.boardId = map.value(qint64(KeyBoardId)).toString();
+    message.baseVersion = map.value(qint64(KeyBaseVersion)).toInteger();
+    message.version = map.value(qint64(KeyVersion)).toInteger();
+
+    message.items = QJsonArray();
+    const QCborArray items = map.value(qint64(KeyItems)).toArray();
+    for (const QCborValue &item : items) {
+        message.items.append(unpackObject(item.toMap(), itemKeys(), true));
+    }
+
+    message.deletedIds.clear();
+    const QCborArray deletedIds = map.value(qint64(KeyDeletedIds)).toArray();
+    for (const QCborValue &id : deletedIds) {
+        message.deletedIds.append(id.toString());
+    }
+
+    message.downloadUrls = map.value(qint64(KeyDownloadUrls)).toMap().toJsonObject();
+    return true;
+}
+
+QByteArray encodeLiveTransform(const QString &boardId, const QVector<LiveTransformFrame> &frames)
+{
+    //кадр — плоский массив [id, x, y, width, height, rotation], без ключей
+    QCborArray packedFrames;
+    for (const LiveTransformFrame &frame : frames) {
+        QCborArray packed;
+        packed.append(frame.itemId);
+        packed.append(frame.rect.x());
+        packed.append(frame.rect.y());
+        packed.append(frame.rect.width());
+        packed.append(frame.rect.height());
+        packed.append(frame.rotation);
+        packedFrames.append(packed);
+    }
+
+    QCborMap map;
+    map.insert(qint64(KeyType), qint64(LiveTransform));
+    map.insert(qint64(KeyBoardId), boardId);
+    map.insert(qint64(KeyFrames), packedFrames);
+    return map.toCborValue().toCbor();
+}
+
+bool decodeLiveTransform(const QByteArray &data, QString &boardId, QVector<LiveTransformFrame> &frames)
+{
+    QCborParserError error;
+    QCborValue root = QCborValue::fromCbor(data, &error);
+    if (error.error != QCborError::NoError || !root.isMap()) return false;
+
+    QCborMap map = root.toMap();
+    if (map.value(qint64(KeyType)).toInteger() != LiveTransform) return false;
+
+    boardId = map.value(qint64(KeyBoardId)).toString();
+    frames.clear();
+
+    const QCborArray packedFrames = map.value(qint64(KeyFrames)).toArray();
+    for (const QCborValue &value : packedFrames) {
+        QCborArray packed = value.toArray();
+        if (packed.size() < 6) continue;
+
+        LiveTransformFrame frame;
+        frame.itemId = packed.at(0).toString();
+        frame.rect = QRectF(packed.at(1).toDouble(), packed.at(2).toDouble(), packed.at(3).toDouble(), packed.at(4).toDouble());
+        frame.rotation = packed.at(5).toDouble();
+        frames.append(frame);
+    }
+    return true;
+}
+
+}
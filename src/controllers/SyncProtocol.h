@@ -0,0 +1,48 @@
+//SyncProtocol — бинарный формат сообщений WebSocket (CBOR с целочисленными ключами). Несет дельты элементов доски напрямую, без повторного запроса /metadata
+
+#pragma once
+
+#include <QByteArray>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QStringList>
+#include <QRectF>
+#include <QVector>
+
+namespace SyncProtocol {
+
+//версия формата, передается серверу при подключении
+constexpr int C_PROTOCOL_VERSION = 1;
+
+enum MessageType : int {
+    BoardDelta = 1, //изменения доски между baseVersion и version
+    LiveTransform = 2 //промежуточные положения элементов во время перетаскивания, не сохраняются
+};
+
+//BoardDeltaMessage — дельта доски: элементы в том же JSON-виде, что отдает /metadata
+struct BoardDeltaMessage {
+    QString boardId;
+    qint64 baseVersion = 0; //версия доски, к которой применяется дельта
+    qint64 version = 0; //версия доски после применения
+    QJsonArray items;
+    QStringList deletedIds;
+    QJsonObject downloadUrls; //hash -> presigned URL для картинок, которых может не быть в кэше
+};
+
+//LiveTransformFrame — один сэмпл геометрии элемента, который соавтор сейчас двигает
+struct LiveTransformFrame {
+    QString itemId;
+    QRectF rect;
+    qreal rotation = 0;
+};
+
+//тип сообщения или 0, если данные не являются сообщением протокола
+int messageType(const QByteArray &data);
+
+QByteArray encodeBoardDelta(const BoardDeltaMessage &message);
+bool decodeBoardDelta(const QByteArray &data, BoardDeltaMessage &message);
+
+QByteArray encodeLiveTransform(const QString &boardId, const QVector<LiveTransformFrame> &frames);
+bool decodeLiveTransform(const QByteArray &data, QString &boardId, QVector<LiveTransformFrame> &frames);
+
+}
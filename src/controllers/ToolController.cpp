@@ -2,15 +2,21 @@
 #include "ImageModel.h"
 #include "StackController.h"
 #include "SettingsManager.h"
+#include "LayoutEngine.h"
 
 #include <cmath>
+#include <algorithm>
 #include <QGuiApplication>
-#include <QScreen>
-#include <QPixmap>
+#include <QTransform>
 #include <QClipboard>
 #include <QColor>
 
-ToolController::ToolController(ImagoImageModel *model, QUndoStack *undoStack, QObject *parent)
+namespace {
+//отношение сторон раскладки, если вызывающий его не передал
+constexpr qreal C_DEFAULT_ARRANGE_ASPECT = 16.0 / 10.0;
+}
+
+ToolController::ToolController(ImagoImageModel *model, UndoHistory *undoStack, QObject *parent)
     : QObject(parent)
     , m_model(model)
     , m_undoStack(undoStack)
@@ -41,17 +47,66 @@ void ToolController::toggleEyedropper()
     emit isEyedropperActiveChanged();
 }
 
-QColor ToolController::getColorAtPoint(int globalX, int globalY)
+QColor ToolController::getColorAtScenePoint(qreal sceneX, qreal sceneY)
 {
-    QScreen *screen = QGuiApplication::screenAt(QPoint(globalX, globalY));
-    if (!screen) screen = QGuiApplication::primaryScreen();
-    if (!screen) return Qt::black;
-
-    // Снимок экрана 1x1 пиксель
-    QPixmap pixmap = screen->grabWindow(0, globalX, globalY, 1, 1);
-    QImage image = pixmap.toImage();
-    if (image.isNull()) return Qt::black;
-    return image.pixelColor(0, 0);
+    const int sampleSize = SettingsManager::instance().getEyedropperSampleSize();
+
+    //сверху вниз: верхний элемент — последняя строка модели
+    for (int i = m_model->getCount() - 1; i >= 0; --i) {
+        const QRectF rect = m_model->getItemRect(i);
+        if (rect.isEmpty() || !m_model->hasPixmap(i)) continue;
+
+        QPointF local(sceneX, sceneY);
+        const qreal rotation = m_model->getItemRotation(i);
+        if (rotation != 0) {
+            QTransform inverse;
+            inverse.translate(rect.center().x(), rect.center().y());
+            inverse.rotate(-rotation);
+            inverse.translate(-rect.center().x(), -rect.center().y());
+            local = inverse.map(local);
+        }
+        if (!rect.contains(local)) continue;
+
+        const ImagoImageData item = m_model->getItem(i);
+        if (item.id != m_sampleItemId || item.version != m_sampleVersion || item.imageHash != m_sampleImageHash) {
+            m_sampleImage = item.pixmap.toImage().convertToFormat(QImage::Format_ARGB32);
+            m_sampleItemId = item.id;
+            m_sampleVersion = item.version;
+            m_sampleImageHash = item.imageHash;
+        }
+        if (m_sampleImage.isNull()) continue;
+
+        //обрезка задана в пикселях исходной картинки
+        const QRectF source = (item.cropWidth > 0 && item.cropHeight > 0)
+            ? QRectF(item.cropX, item.cropY, item.cropWidth, item.cropHeight)
+            : QRectF(m_sampleImage.rect());
+        const int px = int(source.x() + (local.x() - rect.x()) / rect.width() * source.width());
+        const int py = int(source.y() + (local.y() - rect.y()) / rect.height() * source.height());
+
+        //среднее по квадрату N×N с весом по альфе, чтобы прозрачные края не темнили цвет
+        const int half = sampleSize / 2;
+        const int left = qBound(0, px - half, m_sampleImage.width() - 1);
+        const int right = qBound(0, px + half, m_sampleImage.width() - 1);
+        const int top = qBound(0, py - half, m_sampleImage.height() - 1);
+        const int bottom = qBound(0, py + half, m_sampleImage.height() - 1);
+
+        qint64 sumR = 0, sumG = 0, sumB = 0, sumA = 0;
+        for (int y = top; y <= bottom; ++y) {
+            const QRgb *line = reinterpret_cast<const QRgb *>(m_sampleImage.constScanLine(y));
+            for (int x = left; x <= right; ++x) {
+                const int a = qAlpha(line[x]);
+                sumR += qRed(line[x]) * a;
+                sumG += qGreen(line[x]) * a;
+                sumB += qBlue(line[x]) * a;
+                sumA += a;
+            }
+        }
+
+        //полностью прозрачный участок — смотрим на изображение ниже
+        if (sumA == 0) continue;
+        return QColor(int(sumR / sumA), int(sumG / sumA), int(sumB / sumA));
+    }
+    return QColor();
 }
 
 void ToolController::copyColorToClipboard(const QColor &color)
@@ -93,50 +148,51 @@ void ToolController::snapToGrid()
     int gridSize = SettingsManager::instance().getGridSize();
     if (gridSize <= 0) return;
 
-    QVariantList indices = m_model->getSelectedIndices();
-    if (indices.isEmpty()) return;
-
-    m_undoStack->beginMacro("Привязка к сетке");
-
-    for (const QVariant &v : indices) {
-        int i = v.toInt();
-        ImagoImageData data = m_model->getItem(i);
-        
-        qreal oldX = data.x;
-        qreal oldY = data.y;
-        
-        qreal cx = oldX + data.width / 2.0;
-        qreal cy = oldY + data.height / 2.0;
-
-        qreal rad = data.rotation * M_PI / 180.0;
-        qreal cosA = std::cos(rad);
-        qreal sinA = std::sin(rad);
+    const QVariantList selected = m_model->getSelectedIndices();
+    if (selected.isEmpty()) return;
 
-        qreal rx = (-data.width / 2.0) * cosA - (-data.height / 2.0) * sinA;
-        qreal ry = (-data.width / 2.0) * sinA + (-data.height / 2.0) * cosA;
-
-        qreal targetX = cx + rx;
-        qreal targetY = cy + ry;
-
-        qreal snappedX = std::round(targetX / gridSize) * gridSize;
-        qreal snappedY = std::round(targetY / gridSize) * gridSize;
-
-        qreal newCx = snappedX - rx;
-        qreal newCy = snappedY - ry;
+    QVector<int> indices;
+    QVector<QPointF> oldPositions;
+    QVector<QPointF> newPositions;
+    indices.reserve(selected.size());
+    oldPositions.reserve(selected.size());
+    newPositions.reserve(selected.size());
+
+    //к сетке притягивается левый верхний угол повернутого изображения; сдвиг угла равен сдвигу всего элемента
+    for (const QVariant &v : selected) {
+        const int i = v.toInt();
+        const QRectF rect = m_model->getItemRect(i);
+        const qreal rotation = m_model->getItemRotation(i);
+
+        qreal cornerX = rect.x();
+        qreal cornerY = rect.y();
+        if (rotation != 0) {
+            const qreal rad = rotation * M_PI / 180.0;
+            const qreal cosA = std::cos(rad);
+            const qreal sinA = std::sin(rad);
+            const qreal halfW = rect.width() / 2.0;
+            const qreal halfH = rect.height() / 2.0;
+            cornerX = rect.center().x() - halfW * cosA + halfH * sinA;
+            cornerY = rect.center().y() - halfW * sinA - halfH * cosA;
+        }
 
-        qreal newX = newCx - data.width / 2.0;
-        qreal newY = newCy - data.height / 2.0;
+        const qreal dx = std::round(cornerX / gridSize) * gridSize - cornerX;
+        const qreal dy = std::round(cornerY / gridSize) * gridSize - cornerY;
+        const QPointF newPos(rect.x() + dx, rect.y() + dy);
 
-        if (!qFuzzyCompare(oldX, newX) || !qFuzzyCompare(oldY, newY)) {
-            m_undoStack->push(new MoveImageCommand(
-                m_model, i, 
-                QPointF(oldX, oldY),
-                QPointF(newX, newY)
-            ));
+        if (!qFuzzyCompare(rect.x(), newPos.x()) || !qFuzzyCompare(rect.y(), newPos.y())) {
+            indices.append(i);
+            oldPositions.append(rect.topLeft());
+            newPositions.append(newPos);
         }
     }
 
-    m_undoStack->endMacro();
+    if (indices.isEmpty()) return;
+
+    //один шаг отмены, позиции применяются одной транзакцией модели
+    ArrangeCommand *command = new ArrangeCommand(m_model, indices, oldPositions, newPositions);
+    command->setText("Привязка к сетке");
+    m_undoStack->push(command);
 }
 
 void ToolController::rotateSelected(qreal angleDelta)
@@ -144,14 +200,15 @@ void ToolController::rotateSelected(qreal angleDelta)
     QVariantList indices = m_model->getSelectedIndices();
     if (indices.isEmpty()) return;
 
-    m_undoStack->beginMacro(angleDelta > 0 ? "Вращение по часовой" : "Вращение против часовой");
+    //один шаг отмены: дочерние команды выполняются и отменяются вместе с родителем
+    QUndoCommand *command = new QUndoCommand(angleDelta > 0 ? "Вращение по часовой" : "Вращение против часовой");
 
     for (const QVariant &v : indices) {
         int idx = v.toInt();
-        m_undoStack->push(new RotateImageCommand(m_model, idx, angleDelta));
+        new RotateImageCommand(m_model, idx, angleDelta, command);
     }
 
-    m_undoStack->endMacro();
+    m_undoStack->push(command);
 }
 
 void ToolController::cropImage(int index, qreal cropX, qreal cropY, qreal cropWidth, qreal cropHeight)
@@ -212,17 +269,21 @@ void ToolController::setLabelForSelected(const QString &label)
     QVariantList indices = m_model->getSelectedIndices();
     if (indices.isEmpty()) return;
 
-    m_undoStack->beginMacro("Подписать изображения");
+    QUndoCommand *command = new QUndoCommand("Подписать изображения");
 
     for (const QVariant &v : indices) {
         int idx = v.toInt();
         ImagoImageData item = m_model->getItem(idx);
         if (item.label != label) {
-            m_undoStack->push(new SetLabelCommand(m_model, idx, item.label, label));
+            new SetLabelCommand(m_model, idx, item.label, label, command);
         }
     }
 
-    m_undoStack->endMacro();
+    if (command->childCount() == 0) {
+        delete command;
+        return;
+    }
+    m_undoStack->push(command);
 }
 
 void ToolController::setOpacityForSelected(qreal opacity)
@@ -250,89 +311,164 @@ void ToolController::setOpacityForSelected(qreal opacity)
     m_undoStack->push(new SetOpacityCommand(m_model, intIndices, oldOpacities, opacity));
 }
 
-void ToolController::arrangeAll(qreal centerX, qreal centerY)
+void ToolController::arrangeAll(qreal centerX, qreal centerY, qreal aspectRatio)
+{
+    QVector<int> indices;
+    indices.reserve(m_model->getCount());
+    for (int i = 0; i < m_model->getCount(); ++i) {
+        indices.append(i);
+    }
+    arrangeItems(indices, QPointF(centerX, centerY), aspectRatio);
+}
+
+void ToolController::arrangeSelected(qreal aspectRatio)
+{
+    const QVariantList selected = m_model->getSelectedIndices();
+    if (selected.size() < 2) return;
+
+    //выделенное раскладывается на месте — вокруг центра его текущих габаритов
+    QVector<int> indices;
+    indices.reserve(selected.size());
+    QRectF bounds;
+    for (const QVariant &v : selected) {
+        int index = v.toInt();
+        indices.append(index);
+        bounds = bounds.isNull() ? m_model->getItemRect(index) : bounds.united(m_model->getItemRect(index));
+    }
+    arrangeItems(indices, bounds.center(), aspectRatio);
+}
+
+void ToolController::alignSelected(const QString &mode)
+{
+    const QVariantList selected = m_model->getSelectedIndices();
+    if (selected.size() < 2) return;
+
+    QVector<int> indices;
+    QVector<QRectF> bounds;
+    QRectF total;
+    for (const QVariant &v : selected) {
+        const int index = v.toInt();
+        indices.append(index);
+        bounds.append(m_model->getItemBounds(index));
+        total = total.isNull() ? bounds.last() : total.united(bounds.last());
+    }
+
+    QVector<QPointF> offsets;
+    offsets.reserve(indices.size());
+    for (const QRectF &b : std::as_const(bounds)) {
+        QPointF offset;
+        if (mode == "left") offset.setX(total.left() - b.left());
+        else if (mode == "hcenter") offset.setX(total.center().x() - b.center().x());
+        else if (mode == "right") offset.setX(total.right() - b.right());
+        else if (mode == "top") offset.setY(total.top() - b.top());
+        else if (mode == "vcenter") offset.setY(total.center().y() - b.center().y());
+        else if (mode == "bottom") offset.setY(total.bottom() - b.bottom());
+        offsets.append(offset);
+    }
+
+    pushMoves(indices, offsets, "Выравнивание");
+}
+
+void ToolController::distributeSelected(const QString &axis)
 {
-    int count = m_model->getCount();
-    if (count == 0) return;
+    const QVariantList selected = m_model->getSelectedIndices();
+    if (selected.size() < 3) return;
 
-    int spacing = SettingsManager::instance().getArrangeSpacing();
+    const bool horizontal = axis != "vertical";
 
-    struct ItemInfo {
+    struct Entry {
         int index;
-        qreal itemWidth;
-        qreal itemHeight;
-        qreal bbWidth;
-        qreal bbHeight;
+        QRectF bounds;
     };
-    
-    QVector<ItemInfo> items;
-    items.reserve(count);
-    qreal totalArea = 0;
-    
-    for (int i = 0; i < count; ++i) {
-        ImagoImageData data = m_model->getItem(i);
-        
-        qreal rad = std::fabs(data.rotation) * M_PI / 180.0;
-        qreal cosA = std::fabs(std::cos(rad));
-        qreal sinA = std::fabs(std::sin(rad));
-        qreal bbW = data.width * cosA + data.height * sinA;
-        qreal bbH = data.width * sinA + data.height * cosA;
-        
-        items.append({i, data.width, data.height, bbW, bbH});
-        totalArea += (bbW + spacing) * (bbH + spacing);
+    QVector<Entry> entries;
+    entries.reserve(selected.size());
+    for (const QVariant &v : selected) {
+        entries.append({v.toInt(), m_model->getItemBounds(v.toInt())});
     }
 
-    std::sort(items.begin(), items.end(), [](const ItemInfo &a, const ItemInfo &b) {
-        return a.bbHeight > b.bbHeight;
+    std::sort(entries.begin(), entries.end(), [horizontal](const Entry &a, const Entry &b) {
+        return horizontal ? a.bounds.left() < b.bounds.left() : a.bounds.top() < b.bounds.top();
     });
 
-    qreal maxRowWidth = std::sqrt(totalArea) * 1.3;
-    if (maxRowWidth < 800) maxRowWidth = 800;
-
-    qreal startX = centerX - maxRowWidth / 2.0;
-    
-    qreal totalHeight = 0;
-    {
-        qreal cx = 0, rh = 0;
-        for (const auto &item : items) {
-            if (cx + item.bbWidth > maxRowWidth && cx > 0) {
-                totalHeight += rh + spacing;
-                cx = 0;
-                rh = 0;
-            }
-            cx += item.bbWidth + spacing;
-            rh = std::max(rh, item.bbHeight);
+    //промежуток = (размах от первого до последнего - сумма размеров) / число промежутков
+    qreal occupied = 0;
+    for (const Entry &e : std::as_const(entries)) {
+        occupied += horizontal ? e.bounds.width() : e.bounds.height();
+    }
+    const qreal start = horizontal ? entries.first().bounds.left() : entries.first().bounds.top();
+    qreal end = start;
+    for (const Entry &e : std::as_const(entries)) {
+        end = std::max(end, horizontal ? e.bounds.right() : e.bounds.bottom());
+    }
+    const qreal gap = (end - start - occupied) / (entries.size() - 1);
+
+    QVector<int> indices;
+    QVector<QPointF> offsets;
+    qreal cursor = start;
+    for (const Entry &e : std::as_const(entries)) {
+        indices.append(e.index);
+        if (horizontal) {
+            offsets.append(QPointF(cursor - e.bounds.left(), 0));
+            cursor += e.bounds.width() + gap;
+        } else {
+            offsets.append(QPointF(0, cursor - e.bounds.top()));
+            cursor += e.bounds.height() + gap;
         }
-        totalHeight += rh;
     }
-    qreal startY = centerY - totalHeight / 2.0;
 
-    QVector<int> sortedIndices;
+    pushMoves(indices, offsets, "Распределение");
+}
+
+//одна команда на все сдвинутые элементы; элементы без сдвига в нее не попадают
+void ToolController::pushMoves(const QVector<int> &indices, const QVector<QPointF> &offsets, const QString &text)
+{
+    QVector<int> moved;
     QVector<QPointF> oldPositions;
     QVector<QPointF> newPositions;
+    for (int i = 0; i < indices.size(); ++i) {
+        if (qFuzzyIsNull(offsets[i].x()) && qFuzzyIsNull(offsets[i].y())) continue;
 
-    qreal currentX = startX;
-    qreal currentY = startY;
-    qreal rowHeight = 0;
+        const QPointF oldPos = m_model->getItemRect(indices[i]).topLeft();
+        moved.append(indices[i]);
+        oldPositions.append(oldPos);
+        newPositions.append(oldPos + offsets[i]);
+    }
+    if (moved.isEmpty()) return;
 
-    for (const auto &item : items) {
-        if (currentX - startX + item.bbWidth > maxRowWidth && currentX > startX) {
-            currentX = startX;
-            currentY += rowHeight + spacing;
-            rowHeight = 0;
-        }
+    ArrangeCommand *command = new ArrangeCommand(m_model, moved, oldPositions, newPositions);
+    command->setText(text);
+    m_undoStack->push(command);
+}
 
-        qreal newX = currentX + item.bbWidth / 2.0 - item.itemWidth / 2.0;
-        qreal newY = currentY + item.bbHeight / 2.0 - item.itemHeight / 2.0;
+void ToolController::arrangeItems(const QVector<int> &indices, const QPointF &center, qreal aspectRatio)
+{
+    if (indices.isEmpty()) return;
+
+    //раскладываются габариты с учетом поворота, а элемент ставится в центр своей ячейки
+    QVector<QSizeF> bounds;
+    bounds.reserve(indices.size());
+    for (int index : indices) {
+        bounds.append(LayoutEngine::rotatedBounds(m_model->getItemRect(index).size(), m_model->getItemRotation(index)));
+    }
 
-        ImagoImageData data = m_model->getItem(item.index);
-        sortedIndices.append(item.index);
-        oldPositions.append(QPointF(data.x, data.y));
-        newPositions.append(QPointF(newX, newY));
+    LayoutEngine::Options options;
+    options.algorithm = LayoutEngine::algorithmFromString(SettingsManager::instance().getArrangeAlgorithm());
+    options.spacing = SettingsManager::instance().getArrangeSpacing();
+    options.aspectRatio = aspectRatio > 0 ? aspectRatio : C_DEFAULT_ARRANGE_ASPECT;
+    const LayoutEngine::Result layout = LayoutEngine::pack(bounds, options);
 
-        currentX += item.bbWidth + spacing;
-        rowHeight = std::max(rowHeight, item.bbHeight);
+    const QPointF origin = center - QPointF(layout.size.width() / 2.0, layout.size.height() / 2.0);
+
+    QVector<QPointF> oldPositions;
+    QVector<QPointF> newPositions;
+    oldPositions.reserve(indices.size());
+    newPositions.reserve(indices.size());
+    for (int i = 0; i < indices.size(); ++i) {
+        const QRectF rect = m_model->getItemRect(indices[i]);
+        const QPointF cellCenter = origin + layout.positions[i] + QPointF(bounds[i].width() / 2.0, bounds[i].height() / 2.0);
+        oldPositions.append(rect.topLeft());
+        newPositions.append(cellCenter - QPointF(rect.width() / 2.0, rect.height() / 2.0));
     }
 
-    m_undoStack->push(new ArrangeCommand(m_model, sortedIndices, oldPositions, newPositions));
+    m_undoStack->push(new ArrangeCommand(m_model, indices, oldPositions, newPositions));
 }
@@ -3,10 +3,14 @@
 #pragma once
 
 #include <QObject>
-#include <QUndoStack>
+#include <QPointF>
+#include <QVector>
+#include <QColor>
+#include <QImage>
 #include <QtQml/qqml.h>
 
 class ImagoImageModel;
+class UndoHistory;
 
 class ToolController : public QObject {
     Q_OBJECT
@@ -17,7 +21,7 @@ class ToolController : public QObject {
     Q_PROPERTY(bool isEyedropperActive READ getIsEyedropperActive NOTIFY isEyedropperActiveChanged)
 
 public:
-    explicit ToolController(ImagoImageModel *model, QUndoStack *undoStack, QObject *parent = nullptr);
+    explicit ToolController(ImagoImageModel *model, UndoHistory *undoStack, QObject *parent = nullptr);
 
     bool getIsPinned() const;
     bool getIsEyedropperActive() const;
@@ -29,11 +33,19 @@ public:
     Q_INVOKABLE void cropImage(int index, qreal cropX, qreal cropY, qreal cropWidth, qreal cropHeight);
     Q_INVOKABLE void setLabelForSelected(const QString &label);
     Q_INVOKABLE void setOpacityForSelected(qreal opacity);
-    Q_INVOKABLE void arrangeAll(qreal centerX = 10000.0, qreal centerY = 10000.0);
+    //aspectRatio — желаемое отношение ширины раскладки к высоте (обычно пропорции окна), 0 — по умолчанию
+    Q_INVOKABLE void arrangeAll(qreal centerX = 10000.0, qreal centerY = 10000.0, qreal aspectRatio = 0);
+    Q_INVOKABLE void arrangeSelected(qreal aspectRatio = 0);
+    //выравнивание выделенных по общим габаритам: "left", "hcenter", "right", "top", "vcenter", "bottom"
+    Q_INVOKABLE void alignSelected(const QString &mode);
+    //равные промежутки между выделенными: "horizontal" или "vertical"; крайние элементы остаются на месте
+    Q_INVOKABLE void distributeSelected(const QString &axis);
     Q_INVOKABLE void togglePin();
     
     Q_INVOKABLE void toggleEyedropper();
-    Q_INVOKABLE QColor getColorAtPoint(int globalX, int globalY);
+    //цвет изображения под точкой сцены: точка переводится обратным преобразованием элемента (поворот, обрезка)
+    //в пиксели картинки и усредняется по квадрату из настроек. Невалидный цвет — под точкой нет изображения
+    Q_INVOKABLE QColor getColorAtScenePoint(qreal sceneX, qreal sceneY);
     Q_INVOKABLE void copyColorToClipboard(const QColor &color);
 
 signals:
@@ -42,8 +54,17 @@ signals:
     void isEyedropperActiveChanged();
 
 private:
+    void arrangeItems(const QVector<int> &indices, const QPointF &center, qreal aspectRatio);
+    void pushMoves(const QVector<int> &indices, const QVector<QPointF> &offsets, const QString &text);
+
     ImagoImageModel *m_model;
-    QUndoStack *m_undoStack;
+    UndoHistory *m_undoStack;
     bool m_isPinned = false;
     bool m_isEyedropperActive = false;
+
+    //раскодированные пиксели последнего изображения под пипеткой, чтобы не конвертировать QPixmap на каждое движение
+    QString m_sampleItemId;
+    QString m_sampleImageHash;
+    qint64 m_sampleVersion = -1;
+    QImage m_sampleImage;
 };
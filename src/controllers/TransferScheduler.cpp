@@ -0,0 +1,302 @@
+#include "TransferScheduler.h"
+
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QFile>
+#include <QTimer>
+#include <QDebug>
+
+namespace {
+//базовая задержка повтора, дальше удваивается с каждой попыткой
+constexpr int C_RETRY_BASE_DELAY_MS = 500;
+constexpr int C_RETRY_MAX_DELAY_MS = 15000;
+}
+
+TransferScheduler::TransferScheduler(QNetworkAccessManager *networkManager, QObject *parent)
+    : QObject(parent)
+    , m_networkManager(networkManager)
+{
+}
+
+void TransferScheduler::setMaxConcurrent(int count)
+{
+    m_maxConcurrent = qMax(1, count);
+    startNext();
+}
+
+int TransferScheduler::maxConcurrent() const
+{
+    return m_maxConcurrent;
+}
+
+void TransferScheduler::setMaxAttempts(int attempts)
+{
+    m_maxAttempts = qMax(1, attempts);
+}
+
+void TransferScheduler::enqueueUpload(const QString &key, const QUrl &url, const QString &filePath, const QByteArray &contentType)
+{
+    if (m_keys.contains(key)) return;
+    m_keys.insert(key);
+
+    Transfer transfer;
+    transfer.direction = Direction::Upload;
+    transfer.key = key;
+    transfer.url = url;
+    transfer.filePath = filePath;
+    transfer.contentType = contentType;
+
+    //размер выгрузки известен заранее — сразу учитываем его в общем прогрессе
+    updateProgress(key, 0, QFile(filePath).size());
+
+    m_queue.enqueue(transfer);
+    startNext();
+}
+
+void TransferScheduler::enqueueDownload(const QString &key, const QUrl &url, const QString &filePath)
+{
+    if (m_keys.contains(key)) return;
+    m_keys.insert(key);
+
+    Transfer transfer;
+    transfer.direction = Direction::Download;
+    transfer.key = key;
+    transfer.url = url;
+    transfer.filePath = filePath;
+
+    updateProgress(key, 0, 0);
+
+    m_queue.enqueue(transfer);
+    startNext();
+}
+
+void TransferScheduler::cancelAll()
+{
+    m_generation++;
+    m_queue.clear();
+    m_waitingRetries = 0;
+
+    //отключаемся от ответов до abort(), чтобы не запустить повторы; недокачанные .part остаются для докачки
+    const QList<QNetworkReply*> replies = m_active.keys();
+    m_active.clear();
+    for (QNetworkReply *reply : replies) {
+        disconnect(reply, nullptr, this, nullptr);
+        reply->abort();
+        reply->deleteLater();
+    }
+
+    m_progress.clear();
+    m_keys.clear();
+    m_hadFailures = false;
+}
+
+bool TransferScheduler::isIdle() const
+{
+    return m_queue.isEmpty() && m_active.isEmpty() && m_waitingRetries == 0;
+}
+
+void TransferScheduler::startNext()
+{
+    while (m_active.size() < m_maxConcurrent && !m_queue.isEmpty()) {
+        startTransfer(m_queue.dequeue());
+    }
+}
+
+void TransferScheduler::startTransfer(const Transfer &transfer)
+{
+    Transfer current = transfer;
+    current.attempt++;
+
+    QNetworkRequest request(current.url);
+    request.setAttribute(QNetworkRequest::RedirectPolicyAttribute, QNetworkRequest::NoLessSafeRedirectPolicy);
+
+    ActiveTransfer active;
+    QNetworkReply *reply = nullptr;
+
+    if (current.direction == Direction::Upload) {
+        QFile *file = new QFile(current.filePath);
+        if (!file->open(QIODevice::ReadOnly)) {
+            qWarning() << "Cannot open file for upload:" << current.filePath;
+            delete file;
+            completeTransfer(current, false);
+            checkIdle();
+            return;
+        }
+
+        //S3 требует точного совпадения Content-Type с тем, что было при генерации presigned URL
+        request.setHeader(QNetworkRequest::ContentTypeHeader, current.contentType);
+        request.setHeader(QNetworkRequest::ContentLengthHeader, file->size());
+
+        reply = m_networkManager->put(request, file);
+        file->setParent(reply); //файл должен жить, пока запрос читает из него
+        active.file = file;
+
+        connect(reply, &QNetworkReply::uploadProgress, this, [this, key = current.key](qint64 sent, qint64 total) {
+            updateProgress(key, sent, total);
+        });
+    } else {
+        QFile *file = new QFile(current.filePath + ".part");
+        if (!file->open(QIODevice::WriteOnly | QIODevice::Append)) {
+            qWarning() << "Cannot open file for download:" << file->fileName();
+            delete file;
+            completeTransfer(current, false);
+            checkIdle();
+            return;
+        }
+
+        //докачка с того места, где оборвалась прошлая попытка
+        active.resumeOffset = file->size();
+        if (active.resumeOffset > 0) {
+            request.setRawHeader("Range", "bytes=" + QByteArray::number(active.resumeOffset) + "-");
+        }
+
+        reply = m_networkManager->get(request);
+        file->setParent(reply);
+        active.file = file;
+
+        connect(reply, &QNetworkReply::metaDataChanged, this, [this, reply]() {
+            auto it = m_active.find(reply);
+            if (it == m_active.end() || it->resumeOffset == 0) return;
+
+            //сервер проигнорировал Range и отдает файл с начала
+            int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+            if (status == 200) {
+                it->file->resize(0);
+                it->resumeOffset = 0;
+            }
+        });
+
+        connect(reply, &QNetworkReply::readyRead, this, [this, reply]() {
+            auto it = m_active.find(reply);
+            if (it == m_active.end()) return;
+            it->file->write(reply->readAll());
+        });
+
+        connect(reply, &QNetworkReply::downloadProgress, this, [this, reply, key = current.key](qint64 received, qint64 total) {
+            auto it = m_active.find(reply);
+            qint64 offset = it != m_active.end() ? it->resumeOffset : 0;
+            updateProgress(key, offset + received, total > 0 ? offset + total : 0);
+        });
+    }
+
+    active.transfer = current;
+    m_active.insert(reply, active);
+
+    connect(reply, &QNetworkReply::finished, this, [this, reply]() {
+        onReplyFinished(reply);
+    });
+}
+
+void TransferScheduler::onReplyFinished(QNetworkReply *reply)
+{
+    ActiveTransfer active = m_active.take(reply);
+    reply->deleteLater();
+
+    const Transfer &transfer = active.transfer;
+    bool ok = reply->error() == QNetworkReply::NoError;
+
+    if (transfer.direction == Direction::Download) {
+        if (ok) {
+            active.file->write(reply->readAll());
+            active.file->close();
+
+            //атомарно заменяем итоговый файл докачанным
+            QFile::remove(transfer.filePath);
+            ok = QFile::rename(active.file->fileName(), transfer.filePath);
+            if (!ok) {
+                qWarning() << "Failed to move downloaded file into place:" << transfer.filePath;
+            }
+        } else {
+            active.file->close();
+
+            //416: сохраненный кусок не соответствует файлу на сервере — начинаем заново
+            int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+            if (status == 416) {
+                QFile::remove(active.file->fileName());
+            }
+        }
+    }
+
+    if (!ok && isRetryable(reply) && transfer.attempt < m_maxAttempts) {
+        qWarning() << "Transfer failed, retrying:" << transfer.key << reply->errorString();
+        scheduleRetry(transfer);
+    } else {
+        if (!ok) {
+            qWarning() << "Transfer failed:" << transfer.key << reply->errorString();
+        }
+        completeTransfer(transfer, ok);
+    }
+
+    startNext();
+    checkIdle();
+}
+
+void TransferScheduler::scheduleRetry(Transfer transfer)
+{
+    int delay = qMin(C_RETRY_BASE_DELAY_MS << (transfer.attempt - 1), C_RETRY_MAX_DELAY_MS);
+    int generation = m_generation;
+    m_waitingRetries++;
+
+    QTimer::singleShot(delay, this, [this, transfer, generation]() {
+        if (generation != m_generation) return; //очередь отменили, пока ждали
+        m_waitingRetries--;
+        m_queue.prepend(transfer);
+        startNext();
+    });
+}
+
+void TransferScheduler::completeTransfer(const Transfer &transfer, bool success)
+{
+    m_keys.remove(transfer.key);
+
+    if (!success) {
+        m_hadFailures = true;
+    } else {
+        Progress &progress = m_progress[transfer.key];
+        progress.done = progress.total;
+    }
+
+    if (transfer.direction == Direction::Upload) {
+        emit uploadFinished(transfer.key, success);
+    } else {
+        emit downloadFinished(transfer.key, success);
+    }
+}
+
+void TransferScheduler::updateProgress(const QString &key, qint64 done, qint64 total)
+{
+    Progress &progress = m_progress[key];
+    progress.done = done;
+    if (total > 0) progress.total = total;
+
+    qint64 sumDone = 0;
+    qint64 sumTotal = 0;
+    for (const Progress &p : std::as_const(m_progress)) {
+        sumDone += p.done;
+        sumTotal += p.total;
+    }
+    emit progressChanged(sumDone, sumTotal);
+}
+
+void TransferScheduler::checkIdle()
+{
+    if (!isIdle()) return;
+
+    bool success = !m_hadFailures;
+    m_hadFailures = false;
+    m_progress.clear();
+    emit allFinished(success);
+}
+
+bool TransferScheduler::isRetryable(QNetworkReply *reply)
+{
+    //сетевые сбои и перегрузка сервера повторяем, ошибки доступа (например, истекший presigned URL) — нет
+    const QNetworkReply::NetworkError error = reply->error();
+    if (error == QNetworkReply::OperationCanceledError) return false;
+    //обрыв посреди тела приходит с уже полученным статусом 200 — это тоже сетевой сбой, докачиваем
+    if (error <= QNetworkReply::UnknownNetworkError) return true;
+
+    int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    return status == 0 || status == 408 || status == 416 || status == 429 || status >= 500;
+}
@@ -0,0 +1,87 @@
+//TransferScheduler — очередь передачи файлов в S3 и из S3. Ограничивает число одновременных запросов, передает данные потоково, повторяет неудачные запросы и считает общий прогресс
+
+#pragma once
+
+#include <QObject>
+#include <QUrl>
+#include <QHash>
+#include <QQueue>
+#include <QSet>
+
+class QNetworkAccessManager;
+class QNetworkReply;
+class QFile;
+
+class TransferScheduler : public QObject {
+    Q_OBJECT
+
+public:
+    explicit TransferScheduler(QNetworkAccessManager *networkManager, QObject *parent = nullptr);
+
+    //ограничение одновременных запросов и количества попыток
+    void setMaxConcurrent(int count);
+    int maxConcurrent() const;
+    void setMaxAttempts(int attempts);
+
+    //ключ, который уже в очереди, в работе или ждет повтора, повторно не ставится: две передачи писали бы в один .part
+    //выгрузка: тело PUT-запроса читается из файла по мере отправки
+    void enqueueUpload(const QString &key, const QUrl &url, const QString &filePath, const QByteArray &contentType);
+    //загрузка: ответ пишется в "<filePath>.part" и переименовывается после завершения, при повторе докачивается через Range
+    void enqueueDownload(const QString &key, const QUrl &url, const QString &filePath);
+
+    void cancelAll();
+    bool isIdle() const;
+
+signals:
+    void uploadFinished(const QString &key, bool success);
+    void downloadFinished(const QString &key, bool success);
+    //суммарный прогресс всех передач с момента последнего простоя очереди
+    void progressChanged(qint64 bytesDone, qint64 bytesTotal);
+    //очередь опустела; success = false, если хотя бы одна передача не удалась
+    void allFinished(bool success);
+
+private:
+    enum class Direction { Upload, Download };
+
+    struct Transfer {
+        Direction direction;
+        QString key;
+        QUrl url;
+        QString filePath;
+        QByteArray contentType;
+        int attempt = 0;
+    };
+
+    struct ActiveTransfer {
+        Transfer transfer;
+        QFile *file = nullptr;
+        qint64 resumeOffset = 0;
+    };
+
+    //учет прогресса одной передачи
+    struct Progress {
+        qint64 done = 0;
+        qint64 total = 0;
+    };
+
+    void startNext();
+    void startTransfer(const Transfer &transfer);
+    void onReplyFinished(QNetworkReply *reply);
+    void scheduleRetry(Transfer transfer);
+    void completeTransfer(const Transfer &transfer, bool success);
+    void updateProgress(const QString &key, qint64 done, qint64 total);
+    void checkIdle();
+    static bool isRetryable(QNetworkReply *reply);
+
+    QNetworkAccessManager *m_networkManager;
+    QQueue<Transfer> m_queue;
+    QHash<QNetworkReply*, ActiveTransfer> m_active;
+    QHash<QString, Progress> m_progress;
+    QSet<QString> m_keys; //ключи передач от постановки в очередь до завершения
+
+    int m_maxConcurrent = 4;
+    int m_maxAttempts = 4;
+    int m_waitingRetries = 0; //передачи, ожидающие повтора по таймеру
+    int m_generation = 0; //увеличивается при cancelAll, чтобы отложенные повторы не воскресали
+    bool m_hadFailures = false;
+};
@@ -3,129 +3,68 @@
 #include "ModelsManager.h"
 #include "StackController.h" // Added for QUndoCommand
 #include "CacheManager.h"
+#include "SettingsManager.h"
 
 #include <QThreadPool>
-#include <QPainter>
 #include <QDebug>
-#include <QCryptographicHash>
-#include <QBuffer>
-#include "net.h"
-#include "cpu.h"
-#include "mat.h"
-
-UpscaleWorker::UpscaleWorker(int index, const QImage &image, const QString &modelPath, const QString &paramPath)
-    : m_index(index), m_image(image), m_modelPath(modelPath), m_paramPath(paramPath) {
-    setAutoDelete(true);
-}
 
-void UpscaleWorker::run() {
-    QImage srcImage = m_image;
-    if (srcImage.isNull()) {
-        emit failed(m_index, "Invalid image data");
-        return;
-    }
+UpscaleController::UpscaleController(ImagoImageModel *model, ModelsManager *modelsManager, UndoHistory *undoStack, QObject *parent)
+    : QObject(parent), m_model(model), m_modelsManager(modelsManager), m_undoStack(undoStack) {
+    m_pool.setMaxThreadCount(1);
+}
 
-    // Convert to RGBA8888 for consistent processing
-    srcImage = srcImage.convertToFormat(QImage::Format_RGBA8888);
-    int w = srcImage.width();
-    int h = srcImage.height();
-
-    try {
-        ncnn::Net net;
-        // Optimization options
-        net.opt.use_vulkan_compute = false; // CPU fallback by default, or auto if Vulkan is enabled in ncnn
-        net.opt.use_fp16_packed = true;
-        net.opt.use_fp16_storage = true;
-        net.opt.use_fp16_arithmetic = true;
-        
-        int r1 = net.load_param(m_paramPath.toUtf8().constData());
-        int r2 = net.load_model(m_modelPath.toUtf8().constData());
-        
-        if (r1 != 0 || r2 != 0) {
-            emit failed(m_index, "Failed to load ncnn model");
-            return;
-        }
+UpscaleController::~UpscaleController() {
+    cancelAll();
+    m_pool.waitForDone();
+}
 
-        // Convert into ncnn matrix (discarding alpha for the network, format RGBA2RGB)
-        ncnn::Mat in = ncnn::Mat::from_pixels(srcImage.constBits(), ncnn::Mat::PIXEL_RGBA2RGB, w, h);
-
-        // Models typically expect [0, 1] floats. ncnn from_pixels gives [0, 255].
-        const float norm_vals[3] = {1/255.f, 1/255.f, 1/255.f};
-        in.substract_mean_normalize(0, norm_vals);
-
-        ncnn::Extractor ex = net.create_extractor();
-        ex.set_light_mode(true);
-        
-        ex.input("data", in);
-        
-        ncnn::Mat out;
-        ex.extract("output", out);
-        
-        if (out.empty()) {
-            emit failed(m_index, "Inference output is empty");
-            return;
-        }
-        
-        // Scale back to [0, 255] if the model outputs [0, 1]
-        const float denorm_vals[3] = {255.f, 255.f, 255.f};
-        out.substract_mean_normalize(0, denorm_vals);
-        
-        // Reconstruct image with scaled alpha if necessary
-        QImage scaledImage(out.w, out.h, QImage::Format_RGBA8888);
-        out.to_pixels(scaledImage.bits(), ncnn::Mat::PIXEL_RGB2RGBA);
-        
-        // If original image had transparency, upscale alpha with bicubic and reapply
-        if (srcImage.hasAlphaChannel()) {
-            // Исходник у нас в RGBA8888. Мы можем достать альфа-канал напрямую:
-            QImage alphaOnly(w, h, QImage::Format_Grayscale8);
-            for (int y = 0; y < h; ++y) {
-                const uchar *srcRow = srcImage.constScanLine(y);
-                uchar *alphaRow = alphaOnly.scanLine(y);
-                for (int x = 0; x < w; ++x) {
-                    alphaRow[x] = srcRow[x * 4 + 3]; // Alpha is the 4th byte
-                }
-            }
-            
-            QImage scaledAlpha = alphaOnly.scaled(out.w, out.h, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
-            
-            // Reapply alpha to the scaled rgba8888 (memory layout: R, G, B, A in bytes)
-            for (int y = 0; y < out.h; ++y) {
-                uchar *rgbaRow = scaledImage.scanLine(y);
-                const uchar *alphaRow = scaledAlpha.constScanLine(y);
-                for (int x = 0; x < out.w; ++x) {
-                    rgbaRow[x * 4 + 3] = alphaRow[x]; // Set 4th byte (Alpha)
-                }
-            }
-        }
-        
-        emit finished(m_index, scaledImage);
-        
-    } catch (const std::exception &e) {
-        emit failed(m_index, QString("Exception during upscale: %1").arg(e.what()));
-    }
+bool UpscaleController::isBusy() const {
+    return !m_jobs.isEmpty();
 }
 
-UpscaleController::UpscaleController(ImagoImageModel *model, ModelsManager *modelsManager, QUndoStack *undoStack, QObject *parent)
-    : QObject(parent), m_model(model), m_modelsManager(modelsManager), m_undoStack(undoStack) {
+qreal UpscaleController::getProgress() const {
+    if (m_batchTotal == 0) return 0.0;
+
+    qreal done = m_batchDone;
+    for (const Job &job : m_jobs) {
+        done += job.fraction;
+    }
+    return done / m_batchTotal;
 }
 
-void UpscaleController::upscaleImage(int index) {
+void UpscaleController::upscaleImage(int index, int priority, const QString &quality) {
     if (index < 0 || index >= m_model->getCount()) return;
-    if (m_activeTasks.contains(index)) return; // Already upscaling this image
-    
-    if (!m_modelsManager->isModelDownloaded()) {
-        emit upscaleFailed(index, "Upscale model is not downloaded");
-        return;
-    }
 
     ImagoImageData data = m_model->getItem(index);
+    if (m_jobs.contains(data.id)) return; // Already upscaling this image
+
     if (data.pixmap.isNull()) {
-        emit upscaleFailed(index, "Empty image");
+        emit upscaleFailed(data.id, "Empty image");
         return;
     }
 
-    m_activeTasks.insert(index);
-    emit upscaleStarted(index);
+    const QRectF crop(data.cropX, data.cropY, data.cropWidth, data.cropHeight);
+    const QSize sourceSize = (data.cropWidth > 0 && data.cropHeight > 0) ? crop.size().toSize() : data.pixmap.size();
+
+    // The model is picked per job: large sources may go to a lighter model
+    const ModelInfo modelInfo = m_modelsManager->selectModel(quality.isEmpty() ? SettingsManager::instance().getUpscaleQuality() : quality, sourceSize);
+    if (!modelInfo.isValid()) {
+        emit upscaleFailed(data.id, "Upscale model is not downloaded");
+        return;
+    }
+
+    // The same source, crop and model were upscaled before: reuse the cached result
+    const QString modelId = modelInfo.id;
+    const QString cachedHash = CacheManager::instance().findUpscaleResult(data.imageHash, crop, modelId);
+    if (!cachedHash.isEmpty()) {
+        QPixmap cachedPixmap = CacheManager::instance().loadFromCache(cachedHash);
+        if (!cachedPixmap.isNull()) {
+            emit upscaleStarted(data.id);
+            applyResult(index, cachedPixmap, cachedHash);
+            emit upscaleFinished(data.id);
+            return;
+        }
+    }
 
     QImage srcImage = data.pixmap.toImage();
     
@@ -133,57 +72,144 @@ void UpscaleController::upscaleImage(int index) {
     if (data.cropWidth > 0 && data.cropHeight > 0) {
         srcImage = srcImage.copy(data.cropX, data.cropY, data.cropWidth, data.cropHeight);
     }
-    
-    UpscaleWorker *worker = new UpscaleWorker(index, srcImage, m_modelsManager->getModelPath(), m_modelsManager->getParamPath());
-    connect(worker, &UpscaleWorker::finished, this, &UpscaleController::onUpscaleFinished, Qt::QueuedConnection);
-    connect(worker, &UpscaleWorker::failed, this, &UpscaleController::onUpscaleFailed, Qt::QueuedConnection);
 
-    QThreadPool::globalInstance()->start(worker);
+    bool wasBusy = isBusy();
+    if (!wasBusy) {
+        m_batchTotal = 0;
+        m_batchDone = 0;
+    }
+
+    Job job;
+    job.sourceHash = data.imageHash;
+    job.crop = crop;
+    job.modelId = modelId;
+    job.state = std::make_shared<UpscaleJobState>();
+    job.worker = new UpscaleWorker(data.id, srcImage, m_modelsManager, modelInfo, SettingsManager::instance().getUpscaleTileSize(), job.state);
+    connect(job.worker, &UpscaleWorker::progress, this, &UpscaleController::onUpscaleProgress, Qt::QueuedConnection);
+    connect(job.worker, &UpscaleWorker::finished, this, &UpscaleController::onUpscaleFinished, Qt::QueuedConnection);
+    connect(job.worker, &UpscaleWorker::failed, this, &UpscaleController::onUpscaleFailed, Qt::QueuedConnection);
+    connect(job.worker, &UpscaleWorker::cancelled, this, &UpscaleController::onUpscaleCancelled, Qt::QueuedConnection);
+
+    m_jobs.insert(data.id, job);
+    m_batchTotal++;
+    emit upscaleStarted(data.id);
+
+    m_pool.start(job.worker, priority);
+
+    if (!wasBusy) emit busyChanged();
+    emit progressChanged();
 }
 
-void UpscaleController::onUpscaleFinished(int index, QImage result) {
-    m_activeTasks.remove(index);
-    if (index >= 0 && index < m_model->getCount()) {
+void UpscaleController::upscaleSelection(const QRectF &visibleArea, const QString &quality) {
+    const QVariantList selected = m_model->getSelectedIndices();
+    for (const QVariant &v : selected) {
+        int index = v.toInt();
         ImagoImageData data = m_model->getItem(index);
-        
-        QPixmap oldPixmap = data.pixmap;
-        QString oldHash = data.imageHash; // Запоминаем старый хэш
-        QRectF oldCrop(data.cropX, data.cropY, data.cropWidth, data.cropHeight);
-        
-        QPixmap newPixmap = QPixmap::fromImage(result);
-        QRectF newCrop(0, 0, 0, 0); 
-        
-        // 1. Генерируем новый хэш для улучшенной картинки
-        QByteArray ba;
-        QBuffer buffer(&ba);
-        buffer.open(QIODevice::WriteOnly);
-        newPixmap.save(&buffer, "PNG");
-        QString newHash = QString(QCryptographicHash::hash(ba, QCryptographicHash::Md5).toHex());
-        
-        // 2. Обязательно сохраняем новые байты в кэш! 
-        // Иначе CloudController не найдет файл для отправки в S3
-        CacheManager::instance().saveToCache(newHash, ba);
-        
-        // 3. Отправляем в стек истории
-        if (m_undoStack) {
-            m_undoStack->push(new UpscaleImageCommand(
-                m_model, index,
-                oldPixmap, oldCrop, oldHash,  // Передаем старый хэш
-                newPixmap, newCrop, newHash   // Передаем новый хэш
-            ));
-        } else {
-            m_model->setPixmap(index, newPixmap);
-            m_model->setImageHash(index, newHash); // Устанавливаем хэш напрямую
-            if (data.cropWidth > 0 && data.cropHeight > 0) {
-                m_model->setCrop(index, 0, 0, 0, 0);
-            }
+        bool visible = visibleArea.isValid() && visibleArea.intersects(QRectF(data.x, data.y, data.width, data.height));
+        upscaleImage(index, visible ? 1 : 0, quality);
+    }
+}
+
+void UpscaleController::cancelUpscale(int index) {
+    if (index < 0 || index >= m_model->getCount()) return;
+    cancelJob(m_model->getItem(index).id);
+}
+
+void UpscaleController::cancelAll() {
+    const QStringList ids = m_jobs.keys();
+    for (const QString &id : ids) {
+        cancelJob(id);
+    }
+}
+
+void UpscaleController::cancelJob(const QString &itemId) {
+    auto it = m_jobs.find(itemId);
+    if (it == m_jobs.end()) return;
+
+    it->state->cancelled = true;
+
+    // A job that has not started yet is taken out of the queue right away;
+    // a running one stops at the next tile batch and reports cancelled()
+    if (!it->state->started && m_pool.tryTake(it->worker)) {
+        delete it->worker;
+        finishJob(itemId);
+        emit upscaleCancelled(itemId);
+    }
+}
+
+void UpscaleController::finishJob(const QString &itemId) {
+    if (!m_jobs.remove(itemId)) return;
+
+    m_batchDone++;
+    emit progressChanged();
+    if (m_jobs.isEmpty()) emit busyChanged();
+}
+
+void UpscaleController::onUpscaleProgress(QString itemId, int tilesDone, int tilesTotal) {
+    auto it = m_jobs.find(itemId);
+    if (it == m_jobs.end() || tilesTotal <= 0) return;
+
+    it->fraction = qreal(tilesDone) / tilesTotal;
+    emit upscaleProgress(itemId, tilesDone, tilesTotal);
+    emit progressChanged();
+}
+
+void UpscaleController::onUpscaleCancelled(QString itemId) {
+    finishJob(itemId);
+    emit upscaleCancelled(itemId);
+}
+
+void UpscaleController::onUpscaleFinished(QString itemId, QImage result, QString resultHash) {
+    auto it = m_jobs.find(itemId);
+    if (it == m_jobs.end()) return;
+    const Job job = *it;
+    finishJob(itemId);
+
+    // The result is valid even if the job was cancelled after its last tile, so keep it for next time
+    CacheManager::instance().storeUpscaleResult(job.sourceHash, job.crop, job.modelId, resultHash);
+
+    if (job.state->cancelled) {
+        emit upscaleCancelled(itemId);
+        return;
+    }
+
+    // The row may have moved or disappeared while the job was running
+    int index = m_model->getIndexById(itemId);
+    if (index >= 0) {
+        applyResult(index, QPixmap::fromImage(result), resultHash);
+    }
+    emit upscaleFinished(itemId);
+}
+
+void UpscaleController::applyResult(int index, const QPixmap &newPixmap, const QString &newHash) {
+    ImagoImageData data = m_model->getItem(index);
+
+    QString oldHash = data.imageHash; // Запоминаем старый хэш
+    QRectF oldCrop(data.cropX, data.cropY, data.cropWidth, data.cropHeight);
+    QRectF newCrop(0, 0, 0, 0);
+
+    // Команда хранит только хэши; обе картинки кладем в кэш, чтобы undo/redo не читали их с диска
+    CacheManager::instance().retainPixmap(oldHash, data.pixmap);
+    CacheManager::instance().retainPixmap(newHash, newPixmap);
+
+    // Отправляем в стек истории
+    if (m_undoStack) {
+        m_undoStack->push(new UpscaleImageCommand(
+            m_model, index,
+            oldCrop, oldHash,
+            newCrop, newHash
+        ));
+    } else {
+        m_model->setPixmap(index, newPixmap);
+        m_model->setImageHash(index, newHash); // Устанавливаем хэш напрямую
+        if (data.cropWidth > 0 && data.cropHeight > 0) {
+            m_model->setCrop(index, 0, 0, 0, 0);
         }
     }
-    emit upscaleFinished(index);
 }
 
-void UpscaleController::onUpscaleFailed(int index, QString error) {
-    m_activeTasks.remove(index);
-    qWarning() << "Upscale failed for index" << index << ":" << error;
-    emit upscaleFinished(index);
+void UpscaleController::onUpscaleFailed(QString itemId, QString error) {
+    finishJob(itemId);
+    qWarning() << "Upscale failed for item" << itemId << ":" << error;
+    emit upscaleFailed(itemId, error);
 }
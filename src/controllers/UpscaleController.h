@@ -2,54 +2,75 @@
 
 #include <QObject>
 #include <QPixmap>
-#include <QRunnable>
 #include <QImage>
-#include <QSet>
-#include <QUndoStack>
+#include <QHash>
+#include <QRectF>
+#include <QThreadPool>
+#include <memory>
+#include "UpscaleWorker.h"
 
 class ImagoImageModel;
-class ModelsManager;
-
-// Worker to run upscale in a background thread
-class UpscaleWorker : public QObject, public QRunnable {
-    Q_OBJECT
-public:
-    UpscaleWorker(int index, const QImage &image, const QString &modelPath, const QString &paramPath);
-
-    void run() override;
-
-signals:
-    void finished(int index, QImage result);
-    void failed(int index, QString error);
-
-private:
-    int m_index;
-    QImage m_image;
-    QString m_modelPath;
-    QString m_paramPath;
-};
+class UndoHistory;
 
 // Controller to handle upscale tasks
 class UpscaleController : public QObject {
     Q_OBJECT
+    Q_PROPERTY(bool busy READ isBusy NOTIFY busyChanged)
+    Q_PROPERTY(qreal progress READ getProgress NOTIFY progressChanged)
 
 public:
-    explicit UpscaleController(ImagoImageModel *model, ModelsManager *modelsManager, QUndoStack *undoStack, QObject *parent = nullptr);
+    explicit UpscaleController(ImagoImageModel *model, ModelsManager *modelsManager, UndoHistory *undoStack, QObject *parent = nullptr);
+    ~UpscaleController();
+
+    bool isBusy() const;
+    // Progress of the current batch of jobs, 0..1
+    qreal getProgress() const;
 
-    Q_INVOKABLE void upscaleImage(int index);
+    // Jobs with a higher priority start first (e.g. items currently on screen).
+    // quality is "auto", "fast" or "quality"; empty means the value from the settings
+    Q_INVOKABLE void upscaleImage(int index, int priority = 0, const QString &quality = QString());
+    // Queues every selected item; items intersecting visibleArea (scene coordinates) go first
+    Q_INVOKABLE void upscaleSelection(const QRectF &visibleArea = QRectF(), const QString &quality = QString());
+    Q_INVOKABLE void cancelUpscale(int index);
+    Q_INVOKABLE void cancelAll();
 
 signals:
-    void upscaleStarted(int index);
-    void upscaleFinished(int index);
-    void upscaleFailed(int index, QString error);
+    void busyChanged();
+    void progressChanged();
+    void upscaleStarted(const QString &itemId);
+    void upscaleProgress(const QString &itemId, int tilesDone, int tilesTotal);
+    void upscaleFinished(const QString &itemId);
+    void upscaleFailed(const QString &itemId, QString error);
+    void upscaleCancelled(const QString &itemId);
 
 private slots:
-    void onUpscaleFinished(int index, QImage result);
-    void onUpscaleFailed(int index, QString error);
+    void onUpscaleProgress(QString itemId, int tilesDone, int tilesTotal);
+    void onUpscaleFinished(QString itemId, QImage result, QString resultHash);
+    void onUpscaleFailed(QString itemId, QString error);
+    void onUpscaleCancelled(QString itemId);
 
 private:
+    struct Job {
+        UpscaleWorker *worker = nullptr; // owned by the pool; only valid for tryTake while queued
+        std::shared_ptr<UpscaleJobState> state;
+        qreal fraction = 0; // tiles done / tiles total
+        // Key of the result in the upscale cache
+        QString sourceHash;
+        QRectF crop;
+        QString modelId;
+    };
+
+    void cancelJob(const QString &itemId);
+    void finishJob(const QString &itemId);
+    void applyResult(int index, const QPixmap &newPixmap, const QString &newHash);
+
     ImagoImageModel *m_model;
     ModelsManager *m_modelsManager;
-    QUndoStack *m_undoStack;
-    QSet<int> m_activeTasks;
+    UndoHistory *m_undoStack;
+
+    // Dedicated pool: one job at a time, tiles inside a job use the cores
+    QThreadPool m_pool;
+    QHash<QString, Job> m_jobs; // keyed by item id, so row changes don't affect running jobs
+    int m_batchTotal = 0;
+    int m_batchDone = 0;
 };
@@ -0,0 +1,206 @@
+#include "UpscalePipeline.h"
+#include "PixelKernels.h"
+
+#include <QThreadPool>
+#include <QVector>
+#include <QDebug>
+#include <QElapsedTimer>
+#include "net.h"
+#include "mat.h"
+
+namespace {
+// Context (in source pixels) added around every tile so the network sees across seams
+constexpr int C_TILE_PADDING = 16;
+// Each parallel tile keeps at least this many ncnn threads
+constexpr int C_MIN_THREADS_PER_TILE = 2;
+constexpr int C_MAX_PARALLEL_TILES = 4;
+
+struct UpscaleTile {
+    QRect core;   // part of the source this tile is responsible for
+    QRect padded; // core plus padding, clamped to the image; this is what the network sees
+    ncnn::Mat out;
+};
+
+// Runs the network on one region of an RGBA8888 image, reading rows through the stride
+ncnn::Mat inferRegion(const ncnn::Net &net, const ModelInfo &model, const QImage &image, const QRect &region, int numThreads)
+{
+    const uchar *origin = image.constBits() + region.y() * image.bytesPerLine() + region.x() * 4;
+    ncnn::Mat in = ncnn::Mat::from_pixels(origin, ncnn::Mat::PIXEL_RGBA2RGB, region.width(), region.height(), int(image.bytesPerLine()));
+
+    // ncnn from_pixels gives [0, 255]; the manifest says what range the model expects
+    const float norm_vals[3] = {model.inputScale, model.inputScale, model.inputScale};
+    in.substract_mean_normalize(0, norm_vals);
+
+    ncnn::Extractor ex = net.create_extractor();
+    ex.set_light_mode(true);
+    ex.set_num_threads(numThreads);
+    ex.input(model.inputBlob.toUtf8().constData(), in);
+
+    ncnn::Mat out;
+    ex.extract(model.outputBlob.toUtf8().constData(), out);
+
+    if (!out.empty()) {
+        // Scale back to [0, 255]
+        const float denorm_vals[3] = {model.outputScale, model.outputScale, model.outputScale};
+        out.substract_mean_normalize(0, denorm_vals);
+    }
+    return out;
+}
+
+// Weight of the new tile at pos inside an overlap band: ramps linearly from 0 to 1 across the band
+float featherWeight(int pos, int bandStart, int bandLength)
+{
+    if (bandLength <= 0 || pos >= bandStart + bandLength) return 1.f;
+    return float(pos - bandStart + 1) / float(bandLength + 1);
+}
+
+// Writes one upscaled tile into the result. Tiles arrive in raster order, so only the
+// left and top overlaps already hold data from neighbours and need cross-fading
+void blendTile(QImage &result, const UpscaleTile &tile, int scale, const QSize &sourceSize)
+{
+    QImage tileImage(tile.out.w, tile.out.h, QImage::Format_RGBA8888);
+    tile.out.to_pixels(tileImage.bits(), ncnn::Mat::PIXEL_RGB2RGBA);
+
+    const int destX = tile.padded.x() * scale;
+    const int destY = tile.padded.y() * scale;
+
+    // Overlap with what the left/top neighbour wrote (its core plus its padding)
+    const int leftBand = tile.core.x() > 0 ? (qMin(sourceSize.width(), tile.core.x() + C_TILE_PADDING) - tile.padded.x()) * scale : 0;
+    const int topBand = tile.core.y() > 0 ? (qMin(sourceSize.height(), tile.core.y() + C_TILE_PADDING) - tile.padded.y()) * scale : 0;
+
+    for (int y = 0; y < tileImage.height(); ++y) {
+        const uchar *srcRow = tileImage.constScanLine(y);
+        uchar *dstRow = result.scanLine(destY + y) + destX * 4;
+        const float wy = featherWeight(y, 0, topBand);
+
+        for (int x = 0; x < tileImage.width(); ++x) {
+            const float weight = wy * featherWeight(x, 0, leftBand);
+            const uchar *src = srcRow + x * 4;
+            uchar *dst = dstRow + x * 4;
+
+            if (weight >= 1.f) {
+                dst[0] = src[0];
+                dst[1] = src[1];
+                dst[2] = src[2];
+            } else {
+                for (int c = 0; c < 3; ++c) {
+                    dst[c] = uchar(dst[c] + (src[c] - dst[c]) * weight + 0.5f);
+                }
+            }
+        }
+    }
+}
+}
+
+
+namespace UpscalePipeline {
+
+QImage upscale(const ncnn::Net &net, const ModelInfo &model, const QImage &image, int tileSize, int threads,
+               const ProgressCallback &progress, QString *error)
+{
+    auto fail = [error](const QString &message) {
+        if (error) *error = message;
+        return QImage();
+    };
+
+    if (image.isNull()) return fail("Invalid image data");
+
+    // Convert to RGBA8888 for consistent processing
+    const QImage srcImage = image.convertToFormat(QImage::Format_RGBA8888);
+    const int w = srcImage.width();
+    const int h = srcImage.height();
+
+    QElapsedTimer latency;
+    latency.start();
+
+    // Split the source into tiles so peak memory depends on the tile size, not the image size.
+    // Some models cap the tile size they were exported for
+    tileSize = qMax(1, tileSize);
+    if (model.maxTileSize > 0) tileSize = qMin(tileSize, model.maxTileSize);
+
+    QVector<UpscaleTile> tiles;
+    for (int ty = 0; ty < h; ty += tileSize) {
+        for (int tx = 0; tx < w; tx += tileSize) {
+            UpscaleTile tile;
+            tile.core = QRect(tx, ty, qMin(tileSize, w - tx), qMin(tileSize, h - ty));
+            tile.padded = tile.core.adjusted(-C_TILE_PADDING, -C_TILE_PADDING, C_TILE_PADDING, C_TILE_PADDING)
+                              .intersected(QRect(0, 0, w, h));
+            tiles.append(tile);
+        }
+    }
+
+    // Several tiles run at once when there are spare cores; each batch is blended before the next starts
+    const int cores = qMax(1, threads);
+    const int parallelTiles = qBound(1, cores / C_MIN_THREADS_PER_TILE, qMin(C_MAX_PARALLEL_TILES, int(tiles.size())));
+    const int threadsPerTile = qMax(1, cores / parallelTiles);
+
+    QThreadPool tilePool;
+    tilePool.setMaxThreadCount(parallelTiles);
+
+    QImage scaledImage;
+    int scale = 0;
+
+    for (int batchStart = 0; batchStart < tiles.size(); batchStart += parallelTiles) {
+        // Stopping is checked between batches; a running batch is short
+        if (progress && !progress(batchStart, int(tiles.size()))) return QImage();
+
+        const int batchEnd = qMin(int(tiles.size()), batchStart + parallelTiles);
+
+        for (int i = batchStart; i < batchEnd; ++i) {
+            tilePool.start([&tiles, &net, &model, &srcImage, i, threadsPerTile]() {
+                tiles[i].out = inferRegion(net, model, srcImage, tiles[i].padded, threadsPerTile);
+            });
+        }
+        tilePool.waitForDone();
+
+        for (int i = batchStart; i < batchEnd; ++i) {
+            UpscaleTile &tile = tiles[i];
+            if (tile.out.empty()) return fail("Inference output is empty");
+
+            // The manifest declares the scale factor; the first tile confirms it
+            if (scale == 0) {
+                scale = tile.out.w / tile.padded.width();
+                if (scale <= 0 || scale != model.scale) return fail("Unexpected inference output size");
+
+                scaledImage = QImage(w * scale, h * scale, QImage::Format_RGBA8888);
+                scaledImage.fill(Qt::black); // opaque; tiles only write RGB
+            }
+
+            if (tile.out.w != tile.padded.width() * scale || tile.out.h != tile.padded.height() * scale) {
+                return fail("Unexpected inference output size");
+            }
+
+            blendTile(scaledImage, tile, scale, QSize(w, h));
+            tile.out.release();
+        }
+    }
+
+    if (progress && !progress(int(tiles.size()), int(tiles.size()))) return QImage();
+
+    const int outW = scaledImage.width();
+    const int outH = scaledImage.height();
+
+    // If original image had transparency, upscale alpha separately and reapply
+    if (srcImage.hasAlphaChannel()) {
+        // Split alpha into a dense plane (RGBA8888: alpha is the 4th byte)
+        QImage alphaOnly(w, h, QImage::Format_Grayscale8);
+        for (int y = 0; y < h; ++y) {
+            PixelKernels::extractAlpha(srcImage.constScanLine(y), alphaOnly.scanLine(y), w);
+        }
+
+        QImage scaledAlpha(outW, outH, QImage::Format_Grayscale8);
+        PixelKernels::resizePlaneBilinear(alphaOnly.constBits(), w, h, int(alphaOnly.bytesPerLine()),
+                                          scaledAlpha.bits(), outW, outH, int(scaledAlpha.bytesPerLine()));
+
+        for (int y = 0; y < outH; ++y) {
+            PixelKernels::mergeAlpha(scaledImage.scanLine(y), scaledAlpha.constScanLine(y), outW);
+        }
+    }
+
+    qCDebug(lcUpscale) << "Upscaled with" << model.id << w << "x" << h << "->" << outW << "x" << outH << "in" << tiles.size() << "tiles,"
+                       << parallelTiles << "in parallel," << latency.elapsed() << "ms";
+
+    return scaledImage;
+}
+
+}
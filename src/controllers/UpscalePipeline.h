@@ -0,0 +1,22 @@
+#pragma once
+
+#include <QImage>
+#include <QString>
+#include <functional>
+
+#include "ModelsManager.h"
+
+namespace ncnn { class Net; }
+
+// Tiled ncnn upscale shared by the app (UpscaleWorker) and the command-line upscaler
+namespace UpscalePipeline {
+
+// Called before the first tile batch and after every batch; returning false stops the run
+using ProgressCallback = std::function<bool(int tilesDone, int tilesTotal)>;
+
+// Upscales image with a loaded net of the given model. threads is the ncnn thread budget for this image;
+// it is split between tiles running in parallel. Returns a null image on failure (error is set) or when stopped
+QImage upscale(const ncnn::Net &net, const ModelInfo &model, const QImage &image, int tileSize, int threads,
+               const ProgressCallback &progress = ProgressCallback(), QString *error = nullptr);
+
+}
@@ -0,0 +1,70 @@
+#include "UpscaleWorker.h"
+#include "UpscalePipeline.h"
+#include "CacheManager.h"
+
+#include <QCryptographicHash>
+#include <QBuffer>
+#include "net.h"
+
+UpscaleWorker::UpscaleWorker(const QString &itemId, const QImage &image, ModelsManager *modelsManager, const ModelInfo &model, int tileSize, std::shared_ptr<UpscaleJobState> state)
+    : m_itemId(itemId), m_image(image), m_modelsManager(modelsManager), m_modelInfo(model), m_tileSize(tileSize), m_state(std::move(state)) {
+    setAutoDelete(true);
+}
+
+void UpscaleWorker::run() {
+    m_state->started = true;
+    if (m_state->cancelled) {
+        emit cancelled(m_itemId);
+        return;
+    }
+
+    if (m_image.isNull()) {
+        emit failed(m_itemId, "Invalid image data");
+        return;
+    }
+
+    try {
+        // The network is loaded once and shared; only the extractor is per job
+        QString loadError;
+        std::shared_ptr<ncnn::Net> net = m_modelsManager->acquireNet(m_modelInfo, &loadError);
+        if (!net) {
+            emit failed(m_itemId, loadError);
+            return;
+        }
+
+        // Thread budget comes from the inference profile the net was loaded with
+        QString error;
+        QImage scaledImage = UpscalePipeline::upscale(*net, m_modelInfo, m_image, m_tileSize, net->opt.num_threads,
+            [this](int tilesDone, int tilesTotal) {
+                if (m_state->cancelled) return false;
+                if (tilesDone > 0) emit progress(m_itemId, tilesDone, tilesTotal);
+                return true;
+            }, &error);
+
+        if (scaledImage.isNull()) {
+            if (m_state->cancelled) {
+                emit cancelled(m_itemId);
+            } else {
+                emit failed(m_itemId, error);
+            }
+            return;
+        }
+
+        // Encode and hash here rather than on the UI thread; the file goes straight into the cache
+        QByteArray png;
+        QBuffer buffer(&png);
+        buffer.open(QIODevice::WriteOnly);
+        scaledImage.save(&buffer, "PNG");
+        QString resultHash = QString(QCryptographicHash::hash(png, QCryptographicHash::Md5).toHex());
+        // Результат запоминается по хэшу, поэтому без полного файла в кэше задачу считаем неудачной
+        if (!CacheManager::instance().saveToCache(resultHash, png)) {
+            emit failed(m_itemId, "Failed to write upscale result to cache");
+            return;
+        }
+
+        emit finished(m_itemId, scaledImage, resultHash);
+
+    } catch (const std::exception &e) {
+        emit failed(m_itemId, QString("Exception during upscale: %1").arg(e.what()));
+    }
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <QObject>
+#include <QRunnable>
+#include <QImage>
+#include <QString>
+#include <atomic>
+#include <memory>
+
+#include "ModelsManager.h"
+
+// State shared between a queued job and the controller
+struct UpscaleJobState {
+    std::atomic_bool started{false};
+    std::atomic_bool cancelled{false};
+};
+
+// Worker to run upscale in a background thread
+class UpscaleWorker : public QObject, public QRunnable {
+    Q_OBJECT
+public:
+    UpscaleWorker(const QString &itemId, const QImage &image, ModelsManager *modelsManager, const ModelInfo &model, int tileSize, std::shared_ptr<UpscaleJobState> state);
+
+    void run() override;
+
+signals:
+    void progress(QString itemId, int tilesDone, int tilesTotal);
+    void finished(QString itemId, QImage result, QString resultHash);
+    void failed(QString itemId, QString error);
+    void cancelled(QString itemId);
+
+private:
+    QString m_itemId;
+    QImage m_image;
+    ModelsManager *m_modelsManager;
+    ModelInfo m_modelInfo;
+    int m_tileSize;
+    std::shared_ptr<UpscaleJobState> m_state;
+};
@@ -3,22 +3,68 @@
 #include <QDir>
 #include <QFileInfo>
 #include <QFile>
+#include <QSaveFile>
+#include <QImageReader>
+#include <QThread>
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QDateTime>
+#include <QDebug>
+
+namespace {
+// Сколько декодированных пикселей держать в памяти для отмены/повтора
+constexpr int C_PIXMAP_CACHE_KB = 256 * 1024;
+
+int pixmapCostKb(const QPixmap &pixmap) {
+    return qMax<qint64>(1, qint64(pixmap.width()) * pixmap.height() * qMax(pixmap.depth(), 8) / 8 / 1024);
+}
+
+// Пишем во временный файл и переименовываем: файл по пути хэша либо полный, либо его нет.
+// QSaveFile дает временному файлу уникальное имя, так что запись из фонового потока, апскейла
+// и докачка "<путь>.part" из S3 друг другу не мешают
+bool savePngAtomically(const QImage &image, const QString &path) {
+    QSaveFile file(path);
+    return file.open(QIODevice::WriteOnly) && image.save(&file, "PNG") && file.commit();
+}
+
+bool saveBytesAtomically(const QByteArray &data, const QString &path) {
+    QSaveFile file(path);
+    return file.open(QIODevice::WriteOnly) && file.write(data) == data.size() && file.commit();
+}
+
+// Кроп в ключе хранится строкой; пустой кроп — вся картинка
+QString cropKey(const QRectF &crop) {
+    if (crop.width() <= 0 || crop.height() <= 0) return QString();
+    return QString("%1,%2,%3,%4").arg(crop.x()).arg(crop.y()).arg(crop.width()).arg(crop.height());
+}
+}
 
 CacheManager& CacheManager::instance() {
     static CacheManager instance;
     return instance;
 }
 
-CacheManager::CacheManager(QObject *parent) : QObject(parent) {
+CacheManager::CacheManager(QObject *parent) : QObject(parent), m_pixmaps(C_PIXMAP_CACHE_KB) {
     m_cacheDir = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/image_cache";
     QDir dir;
     if (!dir.exists(m_cacheDir)) {
         dir.mkpath(m_cacheDir);
     }
+
+    m_savePool.setMaxThreadCount(1);
+    m_savePool.setThreadPriority(QThread::LowPriority);
+}
+
+CacheManager::~CacheManager() {
+    m_savePool.waitForDone();
 }
 
 bool CacheManager::isCached(const QString &hash) const {
     if (hash.isEmpty()) return false;
+    {
+        QMutexLocker locker(&m_pixmapsMutex);
+        if (m_pendingSaves.contains(hash)) return true;
+    }
     return QFileInfo::exists(getCacheFilePath(hash));
 }
 
@@ -34,21 +80,124 @@ void CacheManager::saveToCache(const QString &hash, const QPixmap &pixmap) {
     }
 }
 
-void CacheManager::saveToCache(const QString &hash, const QByteArray &data) {
-    if (hash.isEmpty() || data.isEmpty()) return;
+bool CacheManager::saveToCache(const QString &hash, const QByteArray &data) {
+    if (hash.isEmpty() || data.isEmpty()) return false;
     QString path = getCacheFilePath(hash);
-    if (!QFileInfo::exists(path)) {
-        QFile file(path);
-        if (file.open(QIODevice::WriteOnly)) {
-            file.write(data);
-            file.close();
-        }
+    if (QFileInfo::exists(path)) return true;
+    if (!saveBytesAtomically(data, path)) {
+        qWarning() << "Failed to save image to cache:" << hash;
+        return false;
     }
+    return true;
 }
 
 QPixmap CacheManager::loadFromCache(const QString &hash) const {
-    if (isCached(hash)) {
-        return QPixmap(getCacheFilePath(hash));
+    if (hash.isEmpty()) return QPixmap();
+    {
+        QMutexLocker locker(&m_pixmapsMutex);
+        auto pending = m_pendingSaves.constFind(hash);
+        if (pending != m_pendingSaves.constEnd()) {
+            return QPixmap::fromImage(*pending);
+        }
+    }
+    const QString path = getCacheFilePath(hash);
+    if (QFileInfo::exists(path)) {
+        return QPixmap(path);
     }
     return QPixmap();
 }
+
+QPixmap CacheManager::loadPixmap(const QString &hash) {
+    if (hash.isEmpty()) return QPixmap();
+
+    {
+        QMutexLocker locker(&m_pixmapsMutex);
+        if (QPixmap *cached = m_pixmaps.object(hash)) {
+            return *cached;
+        }
+    }
+
+    QPixmap pixmap = loadFromCache(hash);
+    QMutexLocker locker(&m_pixmapsMutex);
+    if (!pixmap.isNull()) {
+        m_pixmaps.insert(hash, new QPixmap(pixmap), pixmapCostKb(pixmap));
+    }
+    return pixmap;
+}
+
+void CacheManager::retainPixmap(const QString &hash, const QPixmap &pixmap) {
+    if (hash.isEmpty() || pixmap.isNull()) return;
+
+    const QString path = getCacheFilePath(hash);
+    const bool needsSave = !QFileInfo::exists(path);
+
+    QMutexLocker locker(&m_pixmapsMutex);
+    m_pixmaps.insert(hash, new QPixmap(pixmap), pixmapCostKb(pixmap));
+    if (!needsSave || m_pendingSaves.contains(hash)) return;
+
+    //кодирование PNG большой картинки занимает сотни миллисекунд — в GUI-потоке остается только копия в QImage
+    const QImage image = pixmap.toImage();
+    m_pendingSaves.insert(hash, image);
+    m_savePool.start([this, hash, image, path]() {
+        if (!savePngAtomically(image, path)) {
+            qWarning() << "Failed to save image to cache:" << hash;
+        }
+        QMutexLocker locker(&m_pixmapsMutex);
+        m_pendingSaves.remove(hash);
+    });
+}
+
+qint64 CacheManager::pixmapBytes(const QString &hash) {
+    if (hash.isEmpty()) return 0;
+
+    {
+        QMutexLocker locker(&m_pixmapsMutex);
+        if (QPixmap *cached = m_pixmaps.object(hash)) {
+            return qint64(pixmapCostKb(*cached)) * 1024;
+        }
+        auto pending = m_pendingSaves.constFind(hash);
+        if (pending != m_pendingSaves.constEnd()) {
+            return pending->sizeInBytes();
+        }
+    }
+
+    //картинки нет в памяти: размер берется из заголовка файла, без декодирования
+    QImageReader reader(getCacheFilePath(hash));
+    const QSize size = reader.size();
+    return size.isValid() ? qint64(size.width()) * size.height() * 4 : 0;
+}
+
+void CacheManager::waitForPendingSaves() {
+    m_savePool.waitForDone();
+}
+
+QString CacheManager::findUpscaleResult(const QString &sourceHash, const QRectF &crop, const QString &modelId) const {
+    if (sourceHash.isEmpty()) return QString();
+
+    QSqlQuery q;
+    q.prepare("SELECT result_hash FROM upscale_cache WHERE source_hash = :source_hash AND crop = :crop AND model_id = :model_id");
+    q.bindValue(":source_hash", sourceHash);
+    q.bindValue(":crop", cropKey(crop));
+    q.bindValue(":model_id", modelId);
+    if (!q.exec() || !q.next()) return QString();
+
+    // Запись без файла в кэше бесполезна (например, кэш картинок очистили)
+    QString resultHash = q.value("result_hash").toString();
+    return isCached(resultHash) ? resultHash : QString();
+}
+
+void CacheManager::storeUpscaleResult(const QString &sourceHash, const QRectF &crop, const QString &modelId, const QString &resultHash) {
+    if (sourceHash.isEmpty() || resultHash.isEmpty()) return;
+
+    QSqlQuery q;
+    q.prepare("INSERT OR REPLACE INTO upscale_cache (source_hash, crop, model_id, result_hash, created_at) "
+              "VALUES (:source_hash, :crop, :model_id, :result_hash, :created_at)");
+    q.bindValue(":source_hash", sourceHash);
+    q.bindValue(":crop", cropKey(crop));
+    q.bindValue(":model_id", modelId);
+    q.bindValue(":result_hash", resultHash);
+    q.bindValue(":created_at", QDateTime::currentSecsSinceEpoch());
+    if (!q.exec()) {
+        qWarning() << "Failed to store upscale result:" << q.lastError().text();
+    }
+}
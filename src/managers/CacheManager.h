@@ -3,6 +3,12 @@
 #include <QObject>
 #include <QString>
 #include <QPixmap>
+#include <QRectF>
+#include <QCache>
+#include <QHash>
+#include <QImage>
+#include <QMutex>
+#include <QThreadPool>
 
 class CacheManager : public QObject {
     Q_OBJECT
@@ -12,14 +18,37 @@ public:
 
     bool isCached(const QString &hash) const;
     void saveToCache(const QString &hash, const QPixmap &pixmap);
-    void saveToCache(const QString &hash, const QByteArray &data);
+    // Готовые байты файла (PNG и т. п.) пишутся атомарно: по пути хэша не бывает недописанного файла.
+    // false, если записать не удалось; уже существующий файл не перезаписывается
+    bool saveToCache(const QString &hash, const QByteArray &data);
     QPixmap loadFromCache(const QString &hash) const;
     QString getCacheFilePath(const QString &hash) const;
 
+    // Декодированные картинки по хэшу для отмены/повтора: недавно использованные держатся в памяти
+    // (LRU с ограничением по объему), остальные заново читаются с диска
+    QPixmap loadPixmap(const QString &hash);
+    // Кладет картинку в LRU и, если ее нет на диске, ставит кодирование PNG в фоновый поток.
+    // Пока файл пишется, картинка отдается из памяти, а isCached уже возвращает true
+    void retainPixmap(const QString &hash, const QPixmap &pixmap);
+    // Сколько байт занимают декодированные пиксели картинки; 0, если ее нет ни в памяти, ни на диске
+    qint64 pixmapBytes(const QString &hash);
+    // Дожидается записи на диск всех картинок из retainPixmap — перед чтением файлов кэша напрямую
+    void waitForPendingSaves();
+
+    // Результаты апскейла (таблица upscale_cache в локальной БД). Пустая строка — результата нет
+    QString findUpscaleResult(const QString &sourceHash, const QRectF &crop, const QString &modelId) const;
+    void storeUpscaleResult(const QString &sourceHash, const QRectF &crop, const QString &modelId, const QString &resultHash);
+
 private:
     explicit CacheManager(QObject *parent = nullptr);
+    ~CacheManager() override;
     CacheManager(const CacheManager&) = delete;
     CacheManager& operator=(const CacheManager&) = delete;
 
     QString m_cacheDir;
+
+    mutable QMutex m_pixmapsMutex;
+    QCache<QString, QPixmap> m_pixmaps; //стоимость — объем в килобайтах
+    QHash<QString, QImage> m_pendingSaves; //картинки, чей PNG еще кодируется; под тем же мьютексом
+    QThreadPool m_savePool; //один поток: кодирование не должно отнимать ядра у апскейла
 };
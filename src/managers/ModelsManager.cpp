@@ -2,13 +2,112 @@
 #include <QStandardPaths>
 #include <QDir>
 #include <QFile>
+#include <QFileInfo>
 #include <QDebug>
 #include <QJSEngine>
 #include <QQmlEngine>
+#include <QMutexLocker>
+#include <QThreadPool>
+#include <QJsonDocument>
+#include <QJsonArray>
+#include <QVariantMap>
+#include <algorithm>
+#include <filesystem>
+#include <limits>
+#include "SettingsManager.h"
+#include "UpscalePipeline.h"
+#include "net.h"
+#include "cpu.h"
+
+Q_LOGGING_CATEGORY(lcUpscale, "imagoref.upscale", QtWarningMsg)
 
 const QString C_BASE_MODEL_URL = "https://imagoref.ru/models/";
-const QString C_MODEL_BIN = "model-DF2K.bin";
-const QString C_MODEL_PARAM = "model-DF2K.param";
+const QString C_MANIFEST_FILE = "manifest.json";
+const int C_NET_IDLE_TIMEOUT_MS = 5 * 60 * 1000; //через сколько простоя выгружать веса из памяти
+const int C_NET_IDLE_CHECK_MS = 30 * 1000;
+const int C_AUTOTUNE_DELAY_MS = 5000; //автонастройка не мешает запуску приложения
+const int C_AUTOTUNE_TILE = 48; //изображение 2×2 тайла: конвейер делит потоки между параллельными тайлами, как в заданиях
+const int C_AUTOTUNE_RUNS = 3; //первый прогон — прогрев, берется лучший
+const qreal C_AUTOTUNE_MIN_GAIN = 0.9; //вариант профиля принимается, только если он быстрее хотя бы на 10%
+const qreal C_AUTO_LIGHT_MEGAPIXELS = 16.0; //в режиме "auto" результат больше этого считается легкой моделью
+const int C_DOWNLOAD_MAX_ATTEMPTS = 4;
+const int C_DOWNLOAD_RETRY_DELAY_MS = 2000; //удваивается с каждой попыткой
+
+// Встроенный манифест: модель, которая была в приложении всегда. Остальные модели приходят с сервера.
+// Контрольных сумм DF2K здесь нет: файлы скачиваются как есть и помечаются непроверенными, пока серверный манифест не пришлет sha256
+const char C_BUILTIN_MANIFEST[] = R"({
+    "models": [
+        {
+            "id": "DF2K",
+            "name": "Real-ESRGAN DF2K x4",
+            "scale": 4,
+            "tier": "quality",
+            "param": "model-DF2K.param",
+            "bin": "model-DF2K.bin",
+            "size": 35000000,
+            "default": true
+        }
+    ]
+})";
+
+namespace {
+// Сеть вместе с аллокаторами, с которыми она настроена: они должны жить, пока жив любой Extractor
+struct LoadedNet {
+    ncnn::PoolAllocator blobAllocator;
+    ncnn::PoolAllocator workspaceAllocator;
+    ncnn::Net net;
+};
+
+// Лучшее время апскейла тестового изображения тем же конвейером, что и у заданий; -1 — инференс не прошел
+qint64 benchmarkPipeline(const ncnn::Net &net, const ModelInfo &model, const QImage &image, int threads)
+{
+    qint64 best = std::numeric_limits<qint64>::max();
+    for (int run = 0; run < C_AUTOTUNE_RUNS; ++run) {
+        QElapsedTimer timer;
+        timer.start();
+        if (UpscalePipeline::upscale(net, model, image, C_AUTOTUNE_TILE, threads).isNull()) return -1;
+        best = qMin(best, timer.nsecsElapsed());
+    }
+    return best;
+}
+
+QVector<ModelInfo> parseManifest(const QByteArray &json)
+{
+    QVector<ModelInfo> models;
+    const QJsonArray array = QJsonDocument::fromJson(json).object().value("models").toArray();
+    for (const QJsonValue &value : array) {
+        ModelInfo model = ModelInfo::fromJson(value.toObject());
+        if (model.isValid() && !model.paramFile.isEmpty() && !model.binFile.isEmpty()) {
+            models.append(model);
+        }
+    }
+    return models;
+}
+}
+
+ModelInfo ModelInfo::fromJson(const QJsonObject &obj)
+{
+    ModelInfo model;
+    model.id = obj.value("id").toString();
+    model.name = obj.value("name").toString(model.id);
+    model.scale = obj.value("scale").toInt(4);
+    model.tier = obj.value("tier").toString("quality");
+    model.paramFile = obj.value("param").toString();
+    model.binFile = obj.value("bin").toString();
+    model.inputBlob = obj.value("inputBlob").toString(model.inputBlob);
+    model.outputBlob = obj.value("outputBlob").toString(model.outputBlob);
+    model.inputScale = float(obj.value("inputScale").toDouble(model.inputScale));
+    model.outputScale = float(obj.value("outputScale").toDouble(model.outputScale));
+    model.maxTileSize = obj.value("maxTileSize").toInt(0);
+    model.sizeBytes = qint64(obj.value("size").toDouble(0));
+    model.isDefault = obj.value("default").toBool(false);
+
+    const QJsonObject hashes = obj.value("sha256").toObject();
+    for (auto it = hashes.begin(); it != hashes.end(); ++it) {
+        model.sha256.insert(it.key(), it.value().toString().toLower());
+    }
+    return model;
+}
 
 ModelsManager* ModelsManager::create(QQmlEngine *qmlEngine, QJSEngine *jsEngine)
 {
@@ -27,49 +126,398 @@ ModelsManager& ModelsManager::instance()
 
 ModelsManager::ModelsManager(QObject *parent) : QObject(parent), m_networkReply(nullptr) {
     m_networkManager = new QNetworkAccessManager(this);
-    
+
     // Setup models directory in AppData folder
     QString appDataDir = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
     m_modelsDir = QDir(appDataDir).filePath("models");
-    
+
     // Ensure the models directory exists
     QDir().mkpath(m_modelsDir);
-    
+
+    m_baseUrl = qEnvironmentVariable("IMAGOREF_MODELS_URL", C_BASE_MODEL_URL);
+    if (!m_baseUrl.endsWith('/')) m_baseUrl += '/';
+
+    m_netIdleTimer.setInterval(C_NET_IDLE_CHECK_MS);
+    connect(&m_netIdleTimer, &QTimer::timeout, this, &ModelsManager::releaseIdleNets);
+
+    // Новый профиль применяется к следующему заданию: сети перезагрузятся с новыми опциями
+    updateInferenceProfile();
+    connect(&SettingsManager::instance(), &SettingsManager::inferenceProfileChanged, this, [this]() {
+        updateInferenceProfile();
+        releaseNets();
+    });
+
+    loadManifest();
     checkModelExists();
+    fetchRemoteManifest();
 }
 
 bool ModelsManager::isModelDownloaded() const { return m_isModelDownloaded; }
 bool ModelsManager::isDownloading() const { return m_isDownloading; }
+QString ModelsManager::downloadingModelId() const { return m_isDownloading ? m_downloadModel.id : QString(); }
+
+void ModelsManager::setBaseUrl(const QString &url) {
+    m_baseUrl = url;
+    if (!m_baseUrl.endsWith('/')) m_baseUrl += '/';
+    fetchRemoteManifest();
+}
+
+bool ModelsManager::isVerified(const ModelInfo &model) {
+    return !model.sha256.value(model.paramFile).isEmpty() && !model.sha256.value(model.binFile).isEmpty();
+}
 qreal ModelsManager::downloadProgress() const { return m_downloadProgress; }
 
-QString ModelsManager::getModelPath() const {
-    return QDir(m_modelsDir).filePath(C_MODEL_BIN);
+QVariantList ModelsManager::getModelsForQml() const {
+    QVariantList list;
+    for (const ModelInfo &model : m_models) {
+        QVariantMap map;
+        map["id"] = model.id;
+        map["name"] = model.name;
+        map["scale"] = model.scale;
+        map["tier"] = model.tier;
+        map["sizeBytes"] = model.sizeBytes;
+        map["isDefault"] = model.isDefault;
+        map["downloaded"] = hasModelFiles(model);
+        map["verified"] = isVerified(model);
+        list.append(map);
+    }
+    return list;
+}
+
+QVector<ModelInfo> ModelsManager::getModels() const {
+    return m_models;
 }
 
-QString ModelsManager::getParamPath() const {
-    return QDir(m_modelsDir).filePath(C_MODEL_PARAM);
+ModelInfo ModelsManager::getModel(const QString &modelId) const {
+    for (const ModelInfo &model : m_models) {
+        if (modelId.isEmpty() ? model.isDefault : model.id == modelId) return model;
+    }
+    return modelId.isEmpty() && !m_models.isEmpty() ? m_models.first() : ModelInfo();
+}
+
+bool ModelsManager::hasModelFiles(const ModelInfo &model) const {
+    return model.isValid() && QFile::exists(getModelFilePath(model.paramFile)) && QFile::exists(getModelFilePath(model.binFile));
+}
+
+QString ModelsManager::getModelFilePath(const QString &fileName) const {
+    return QDir(m_modelsDir).filePath(fileName);
+}
+
+ModelInfo ModelsManager::selectModel(const QString &quality, const QSize &sourceSize) const {
+    QVector<ModelInfo> downloaded;
+    for (const ModelInfo &model : m_models) {
+        if (hasModelFiles(model)) downloaded.append(model);
+    }
+    if (downloaded.isEmpty()) return ModelInfo();
+
+    QString tier = quality == "fast" ? "light" : "quality";
+    if (quality == "auto") {
+        // Размер результата оцениваем по качественной модели: именно ее хотелось бы взять
+        int scale = 4;
+        for (const ModelInfo &model : downloaded) {
+            if (model.tier == "quality") { scale = model.scale; break; }
+        }
+        qreal megapixels = qreal(sourceSize.width()) * sourceSize.height() * scale * scale / 1e6;
+        if (megapixels > C_AUTO_LIGHT_MEGAPIXELS) tier = "light";
+    }
+
+    // Нужный уровень, среди них — модель по умолчанию; иначе любая скачанная
+    const ModelInfo *best = nullptr;
+    for (const ModelInfo &model : downloaded) {
+        if (model.tier != tier) continue;
+        if (!best || model.isDefault) best = &model;
+    }
+    if (!best) {
+        for (const ModelInfo &model : downloaded) {
+            if (!best || model.isDefault) best = &model;
+        }
+    }
+    return *best;
+}
+
+void ModelsManager::loadManifest() {
+    m_models = parseManifest(QByteArray(C_BUILTIN_MANIFEST));
+
+    // Манифест с сервера дополняет встроенный и заменяет записи с тем же id
+    QFile cached(getModelFilePath(C_MANIFEST_FILE));
+    if (!cached.open(QIODevice::ReadOnly)) return;
+
+    const QVector<ModelInfo> remote = parseManifest(cached.readAll());
+    bool hasDefault = false;
+    for (const ModelInfo &model : remote) {
+        hasDefault = hasDefault || model.isDefault;
+    }
+
+    for (const ModelInfo &model : remote) {
+        auto it = std::find_if(m_models.begin(), m_models.end(), [&model](const ModelInfo &m) { return m.id == model.id; });
+        if (it != m_models.end()) {
+            *it = model;
+        } else {
+            m_models.append(model);
+        }
+    }
+
+    // Модель по умолчанию одна: если сервер назначил свою, встроенная ею больше не считается
+    if (hasDefault) {
+        for (ModelInfo &model : m_models) {
+            model.isDefault = std::any_of(remote.begin(), remote.end(), [&model](const ModelInfo &m) {
+                return m.id == model.id && m.isDefault;
+            });
+        }
+    }
+}
+
+void ModelsManager::fetchRemoteManifest() {
+    QNetworkRequest request{QUrl(m_baseUrl + C_MANIFEST_FILE)};
+    request.setAttribute(QNetworkRequest::RedirectPolicyAttribute, QNetworkRequest::NoLessSafeRedirectPolicy);
+
+    QNetworkReply *reply = m_networkManager->get(request);
+    connect(reply, &QNetworkReply::finished, this, [this, reply]() {
+        reply->deleteLater();
+        if (reply->error() != QNetworkReply::NoError) {
+            qDebug() << "Models manifest is unavailable:" << reply->errorString();
+            return;
+        }
+
+        // Битый манифест не сохраняем, остается прошлый
+        const QByteArray json = reply->readAll();
+        if (parseManifest(json).isEmpty()) return;
+
+        QFile file(getModelFilePath(C_MANIFEST_FILE));
+        if (file.open(QIODevice::WriteOnly)) {
+            file.write(json);
+            file.close();
+        }
+
+        loadManifest();
+        checkModelExists();
+    });
+}
+
+std::shared_ptr<ncnn::Net> ModelsManager::loadNet(const ModelInfo &model, const InferenceProfile &profile, QString *error) const {
+    QElapsedTimer loadTimer;
+    loadTimer.start();
+
+    auto holder = std::make_shared<LoadedNet>();
+    ncnn::Option &opt = holder->net.opt;
+    opt.use_vulkan_compute = false; // CPU fallback by default, or auto if Vulkan is enabled in ncnn
+    opt.use_fp16_packed = true;
+    opt.use_fp16_storage = true;
+    opt.use_fp16_arithmetic = true;
+    opt.lightmode = true;
+
+    int threads = profile.threads;
+    if (threads <= 0) {
+        threads = profile.bigCoresOnly ? ncnn::get_big_cpu_count() : ncnn::get_cpu_count();
+    }
+    opt.num_threads = qMax(1, threads);
+    ncnn::set_cpu_powersave(profile.bigCoresOnly ? 2 : 0); // 2 — потоки ncnn только на производительных ядрах
+
+    if (profile.pooledAllocators) {
+        opt.blob_allocator = &holder->blobAllocator;
+        opt.workspace_allocator = &holder->workspaceAllocator;
+    }
+    opt.use_bf16_storage = profile.useBf16;
+    opt.use_int8_inference = profile.useInt8;
+
+    int r1 = holder->net.load_param(getModelFilePath(model.paramFile).toUtf8().constData());
+    int r2 = holder->net.load_model(getModelFilePath(model.binFile).toUtf8().constData());
+    if (r1 != 0 || r2 != 0) {
+        if (error) *error = "Failed to load ncnn model " + model.id;
+        return nullptr;
+    }
+
+    qCDebug(lcUpscale) << "Upscale model" << model.id << "loaded in" << loadTimer.elapsed() << "ms," << opt.num_threads << "threads";
+
+    // Указатель на сеть разделяет владение всей структурой вместе с аллокаторами
+    return std::shared_ptr<ncnn::Net>(holder, &holder->net);
+}
+
+std::shared_ptr<ncnn::Net> ModelsManager::acquireNet(const ModelInfo &model, QString *error) {
+    QMutexLocker locker(&m_netMutex);
+
+    LoadedNetEntry &entry = m_nets[model.id];
+    if (!entry.net) {
+        // Профиль инференса из настроек
+        entry.net = loadNet(model, m_profile, error);
+        if (!entry.net) {
+            m_nets.remove(model.id);
+            return nullptr;
+        }
+
+        // Таймер живет в главном потоке, а acquireNet вызывается из рабочих
+        QMetaObject::invokeMethod(this, [this]() {
+            if (!m_netIdleTimer.isActive()) m_netIdleTimer.start();
+        }, Qt::QueuedConnection);
+    }
+
+    entry.lastUsed.start();
+    return entry.net;
+}
+
+void ModelsManager::releaseIdleNets() {
+    QMutexLocker locker(&m_netMutex);
+
+    for (auto it = m_nets.begin(); it != m_nets.end();) {
+        // use_count() == 1: сетью сейчас не пользуется ни одно задание
+        if (it->net.use_count() == 1 && it->lastUsed.elapsed() > C_NET_IDLE_TIMEOUT_MS) {
+            qCDebug(lcUpscale) << "Upscale model" << it.key() << "unloaded after idle timeout";
+            it = m_nets.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    if (m_nets.isEmpty()) {
+        m_netIdleTimer.stop();
+    }
+}
+
+void ModelsManager::releaseNets(const QString &modelId) {
+    // Задания, которые уже держат сеть, доработают со своей копией указателя
+    QMutexLocker locker(&m_netMutex);
+    if (modelId.isEmpty()) {
+        m_nets.clear();
+    } else {
+        m_nets.remove(modelId);
+    }
+
+    if (m_nets.isEmpty()) {
+        m_netIdleTimer.stop();
+    }
+}
+
+void ModelsManager::updateInferenceProfile() {
+    const SettingsManager &settings = SettingsManager::instance();
+
+    QMutexLocker locker(&m_netMutex);
+    m_profile.threads = settings.getUpscaleThreads();
+    m_profile.bigCoresOnly = settings.getUpscaleBigCoresOnly();
+    m_profile.pooledAllocators = settings.getUpscalePooledAllocators();
+    m_profile.useBf16 = settings.getUpscaleUseBf16();
+    m_profile.useInt8 = settings.getUpscaleUseInt8();
+}
+
+void ModelsManager::autotuneInference() {
+    if (m_isAutotuning || !m_isModelDownloaded) return;
+
+    // Настраиваем по качественной модели: она самая тяжелая из тех, что обычно используются
+    const ModelInfo model = selectModel("quality", QSize());
+    if (!model.isValid()) return;
+    m_isAutotuning = true;
+
+    QThreadPool::globalInstance()->start([this, model]() {
+        InferenceProfile best;
+        const bool ok = runAutotune(model, best);
+        QMetaObject::invokeMethod(this, [this, ok, best]() {
+            m_isAutotuning = false;
+            SettingsManager &settings = SettingsManager::instance();
+            if (ok) {
+                settings.setUpscaleThreads(best.threads);
+                settings.setUpscalePooledAllocators(best.pooledAllocators);
+                settings.setUpscaleUseBf16(best.useBf16);
+            }
+            settings.setUpscaleAutotuned(true);
+            emit autotuneFinished(ok ? best.threads : 0);
+        }, Qt::QueuedConnection);
+    });
+}
+
+bool ModelsManager::runAutotune(const ModelInfo &model, InferenceProfile &best) {
+    {
+        QMutexLocker locker(&m_netMutex);
+        best = m_profile;
+    }
+
+    // Плавный градиент: на однотонной картинке часть слоев могла бы работать нетипично быстро
+    QImage image(2 * C_AUTOTUNE_TILE, 2 * C_AUTOTUNE_TILE, QImage::Format_RGBA8888);
+    for (int y = 0; y < image.height(); ++y) {
+        uchar *line = image.scanLine(y);
+        for (int x = 0; x < image.width(); ++x) {
+            line[x * 4 + 0] = uchar(x * 255 / image.width());
+            line[x * 4 + 1] = uchar(y * 255 / image.height());
+            line[x * 4 + 2] = uchar((x + y) * 127 / image.width());
+            line[x * 4 + 3] = 255;
+        }
+    }
+
+    // 1. Бюджет потоков: конвейер делит его между параллельными тайлами (не меньше двух потоков на тайл)
+    std::shared_ptr<ncnn::Net> net = acquireNet(model);
+    if (!net) return false;
+
+    const int cpuCount = ncnn::get_cpu_count();
+    std::vector<int> candidates = {1, qMax(1, cpuCount / 2), cpuCount, qMax(1, ncnn::get_big_cpu_count())};
+    std::sort(candidates.begin(), candidates.end());
+    candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+    qint64 bestTime = std::numeric_limits<qint64>::max();
+    for (int threads : candidates) {
+        const qint64 time = benchmarkPipeline(*net, model, image, threads);
+        if (time < 0) return false;
+
+        qCDebug(lcUpscale) << "Upscale autotune:" << threads << "threads," << time / 1000 << "us per image";
+        if (time < bestTime) {
+            bestTime = time;
+            best.threads = threads;
+        }
+    }
+    net.reset();
+
+    // 2. Опции, которые задаются при загрузке сети: каждый вариант грузит свой экземпляр вне общего пула.
+    // int8 здесь не проверяется — он работает только с квантованными весами, а модели в манифесте в fp32
+    auto tryVariant = [&](const char *name, const std::function<void(InferenceProfile &)> &change) {
+        InferenceProfile variant = best;
+        change(variant);
+
+        std::shared_ptr<ncnn::Net> variantNet = loadNet(model, variant);
+        if (!variantNet) return;
+        const qint64 time = benchmarkPipeline(*variantNet, model, image, best.threads);
+
+        qCDebug(lcUpscale) << "Upscale autotune:" << name << (time < 0 ? -1 : time / 1000) << "us per image";
+        if (time >= 0 && time < bestTime * C_AUTOTUNE_MIN_GAIN) {
+            bestTime = time;
+            best = variant;
+        }
+    };
+    tryVariant(best.pooledAllocators ? "without pooled allocators" : "with pooled allocators", [](InferenceProfile &profile) {
+        profile.pooledAllocators = !profile.pooledAllocators;
+    });
+    tryVariant(best.useBf16 ? "without bf16" : "with bf16", [](InferenceProfile &profile) {
+        profile.useBf16 = !profile.useBf16;
+    });
+    return true;
 }
 
 void ModelsManager::checkModelExists() {
-    bool exists = QFile::exists(getModelPath()) && QFile::exists(getParamPath());
+    bool exists = std::any_of(m_models.begin(), m_models.end(), [this](const ModelInfo &model) { return hasModelFiles(model); });
     if (m_isModelDownloaded != exists) {
         m_isModelDownloaded = exists;
         emit modelDownloadedChanged();
     }
+    emit modelsChanged();
+
+    // Первая настройка профиля под это железо
+    if (exists && !SettingsManager::instance().getUpscaleAutotuned()) {
+        QTimer::singleShot(C_AUTOTUNE_DELAY_MS, this, &ModelsManager::autotuneInference);
+    }
 }
 
-void ModelsManager::downloadModel() {
-    if (m_isDownloading || m_isModelDownloaded) return;
+void ModelsManager::downloadModel(const QString &modelId) {
+    if (m_isDownloading) return;
 
+    const ModelInfo model = getModel(modelId);
+    if (!model.isValid() || hasModelFiles(model)) return;
+
+    m_downloadModel = model;
     m_isDownloading = true;
     m_downloadProgress = 0.0;
-    m_totalProgress = 0.0;
     emit downloadingChanged();
     emit progressChanged();
 
     m_downloadQueue.clear();
-    m_downloadQueue << C_MODEL_BIN << C_MODEL_PARAM;
+    m_downloadQueue << model.binFile << model.paramFile;
     m_fileIndex = 0;
+    m_fileCount = m_downloadQueue.size();
 
     downloadNextFile();
 }
@@ -84,62 +532,167 @@ void ModelsManager::downloadNextFile() {
     }
 
     m_currentFileName = m_downloadQueue.takeFirst();
-    QString urlStr = C_BASE_MODEL_URL + m_currentFileName;
-    
-    QNetworkRequest request{(QUrl(urlStr))};
+    m_downloadAttempt = 0;
+
+    // Файл, скачанный раньше (например, .param при оборванной загрузке .bin), повторно не качаем
+    if (QFile::exists(getModelFilePath(m_currentFileName))) {
+        m_fileIndex++;
+        downloadNextFile();
+        return;
+    }
+
+    startFileDownload();
+}
+
+void ModelsManager::startFileDownload() {
+    m_downloadAttempt++;
+
+    m_downloadFile = new QFile(getModelFilePath(m_currentFileName + ".part"), this);
+    if (!m_downloadFile->open(QIODevice::ReadWrite | QIODevice::Append)) {
+        failDownload("Failed to save downloaded file " + m_currentFileName);
+        return;
+    }
+
+    // Докачка с того места, где оборвалась прошлая попытка; хэш досчитываем по уже лежащему куску
+    m_downloadHash.reset();
+    m_resumeOffset = m_downloadFile->size();
+    if (m_resumeOffset > 0) {
+        m_downloadFile->seek(0);
+        m_downloadHash.addData(m_downloadFile);
+        m_downloadFile->seek(m_resumeOffset);
+    }
+
+    QNetworkRequest request{QUrl(m_baseUrl + m_currentFileName)};
     request.setAttribute(QNetworkRequest::RedirectPolicyAttribute, QNetworkRequest::NoLessSafeRedirectPolicy);
-    
+    if (m_resumeOffset > 0) {
+        request.setRawHeader("Range", "bytes=" + QByteArray::number(m_resumeOffset) + "-");
+    }
+
     m_networkReply = m_networkManager->get(request);
+    connect(m_networkReply, &QNetworkReply::metaDataChanged, this, [this]() {
+        if (m_resumeOffset == 0) return;
+
+        // Сервер проигнорировал Range и отдает файл с начала
+        int status = m_networkReply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+        if (status == 200) {
+            m_downloadFile->resize(0);
+            m_downloadHash.reset();
+            m_resumeOffset = 0;
+        }
+    });
+    connect(m_networkReply, &QNetworkReply::readyRead, this, &ModelsManager::onDownloadReadyRead);
     connect(m_networkReply, &QNetworkReply::downloadProgress, this, &ModelsManager::onDownloadProgress);
     connect(m_networkReply, &QNetworkReply::finished, this, &ModelsManager::onDownloadFinished);
 }
 
-void ModelsManager::deleteModel() {
+void ModelsManager::failDownload(const QString &errorMsg) {
+    if (m_downloadFile) {
+        m_downloadFile->close();
+        m_downloadFile->deleteLater();
+        m_downloadFile = nullptr;
+    }
+    m_downloadQueue.clear();
+    m_isDownloading = false;
+    emit downloadingChanged();
+    emit downloadFinished(false, errorMsg);
+}
+
+void ModelsManager::deleteModel(const QString &modelId) {
     if (m_isDownloading) return;
-    
-    QFile::remove(getModelPath());
-    QFile::remove(getParamPath());
-    
+
+    // Без id удаляются все модели
+    for (const ModelInfo &model : std::as_const(m_models)) {
+        if (!modelId.isEmpty() && model.id != modelId) continue;
+
+        releaseNets(model.id);
+        QFile::remove(getModelFilePath(model.binFile));
+        QFile::remove(getModelFilePath(model.paramFile));
+    }
+
     checkModelExists();
 }
 
+void ModelsManager::onDownloadReadyRead() {
+    // Пишем на диск по мере прихода, в памяти держится только текущий кусок
+    const QByteArray chunk = m_networkReply->readAll();
+    if (m_downloadFile->write(chunk) != chunk.size()) {
+        m_networkReply->abort();
+        return;
+    }
+    m_downloadHash.addData(chunk);
+}
+
 void ModelsManager::onDownloadProgress(qint64 bytesReceived, qint64 bytesTotal) {
-    if (bytesTotal > 0) {
-        // Мы скачиваем 2 файла, поэтому каждый дает 50% прогресса
-        qreal currentFileProgress = static_cast<qreal>(bytesReceived) / static_cast<qreal>(bytesTotal);
-        m_downloadProgress = (m_fileIndex * 0.5) + (currentFileProgress * 0.5);
+    if (bytesTotal > 0 && m_fileCount > 0) {
+        // Каждый файл модели дает равную долю общего прогресса
+        qreal currentFileProgress = static_cast<qreal>(m_resumeOffset + bytesReceived) / static_cast<qreal>(m_resumeOffset + bytesTotal);
+        m_downloadProgress = (m_fileIndex + currentFileProgress) / m_fileCount;
         emit progressChanged();
     }
 }
 
 void ModelsManager::onDownloadFinished() {
-    if (m_networkReply->error() != QNetworkReply::NoError) {
-        QString errorMsg = m_networkReply->errorString();
-        m_networkReply->deleteLater();
-        m_networkReply = nullptr;
-        m_isDownloading = false;
-        emit downloadingChanged();
-        emit downloadFinished(false, errorMsg);
+    QNetworkReply *reply = m_networkReply;
+    m_networkReply = nullptr;
+    reply->deleteLater();
+
+    const int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    if (reply->error() != QNetworkReply::NoError) {
+        m_downloadFile->close();
+        m_downloadFile->deleteLater();
+
+        // 416: сохраненный кусок не соответствует файлу на сервере — начинаем заново
+        if (status == 416) {
+            m_downloadFile->remove();
+        }
+        m_downloadFile = nullptr;
+
+        // Сетевые сбои и ошибки сервера повторяем с паузой, недокачанный .part остается для докачки.
+        // Обрыв посреди тела приходит с уже полученным статусом 200, поэтому сначала смотрим на сетевую ошибку
+        const bool networkFailure = reply->error() <= QNetworkReply::UnknownNetworkError &&
+                                    reply->error() != QNetworkReply::OperationCanceledError;
+        const bool retryable = networkFailure || status == 0 || status == 416 || status >= 500;
+        if (retryable && m_downloadAttempt < C_DOWNLOAD_MAX_ATTEMPTS) {
+            qWarning() << "Model download failed, retrying:" << m_currentFileName << reply->errorString();
+            QTimer::singleShot(C_DOWNLOAD_RETRY_DELAY_MS << (m_downloadAttempt - 1), this, &ModelsManager::startFileDownload);
+            return;
+        }
+
+        failDownload(reply->errorString());
         return;
     }
 
-    QString savePath = QDir(m_modelsDir).filePath(m_currentFileName);
-    QFile targetFile(savePath);
-    if (targetFile.open(QIODevice::WriteOnly)) {
-        targetFile.write(m_networkReply->readAll());
-        targetFile.close();
-    } else {
-        m_networkReply->deleteLater();
-        m_networkReply = nullptr;
-        m_isDownloading = false;
-        emit downloadingChanged();
-        emit downloadFinished(false, "Failed to save downloaded file " + m_currentFileName);
+    onDownloadReadyRead();
+    m_downloadFile->close();
+
+    // Битый или обрезанный файл на место не ставим: иначе load_model упадет уже при апскейле
+    const QString expected = m_downloadModel.sha256.value(m_currentFileName);
+    const QString actual = QString(m_downloadHash.result().toHex());
+    if (!expected.isEmpty() && expected != actual) {
+        qWarning() << "Model checksum mismatch:" << m_currentFileName << actual << "expected" << expected;
+        m_downloadFile->remove();
+        failDownload("Checksum mismatch for " + m_currentFileName);
         return;
     }
+    if (expected.isEmpty()) {
+        // Файл принимается, но модель остается помеченной как непроверенная (isVerified, "verified" в списке для QML)
+        qWarning() << "No checksum in the manifest for" << m_currentFileName << "- saved unverified, sha256:" << actual;
+    }
+
+    // Заменяем итоговый файл одним rename: на POSIX это атомарно, на Windows — MoveFileEx с заменой.
+    // В отличие от remove + rename, нет момента, когда файла модели нет на диске, а при сбое остается старый файл
+    const QString savePath = getModelFilePath(m_currentFileName);
+    std::error_code renameError;
+    std::filesystem::rename(std::filesystem::path(m_downloadFile->fileName().toStdU16String()),
+                            std::filesystem::path(savePath.toStdU16String()), renameError);
+    if (renameError) {
+        qWarning() << "Failed to move downloaded model into place:" << savePath << QString::fromStdString(renameError.message());
+        failDownload("Failed to save downloaded file " + m_currentFileName);
+        return;
+    }
+    m_downloadFile->deleteLater();
+    m_downloadFile = nullptr;
 
-    m_networkReply->deleteLater();
-    m_networkReply = nullptr;
-    
     m_fileIndex++;
     downloadNextFile();
 }
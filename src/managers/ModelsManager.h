@@ -4,57 +4,165 @@
 #include <QNetworkAccessManager>
 #include <QNetworkReply>
 #include <QString>
+#include <QHash>
+#include <QSize>
+#include <QVector>
+#include <QVariantList>
+#include <QJsonObject>
 #include <QQmlEngine>
 #include <QJSEngine>
+#include <QMutex>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QCryptographicHash>
+#include <QLoggingCategory>
+#include <memory>
+
+namespace ncnn { class Net; }
+
+//подробный журнал апскейла (загрузка сетей, замеры); выключен, включается через QT_LOGGING_RULES="imagoref.upscale.debug=true"
+Q_DECLARE_LOGGING_CATEGORY(lcUpscale)
+
+//InferenceProfile — настройки ncnn для апскейла (копия значений из SettingsManager)
+struct InferenceProfile {
+    int threads = 0; //0 — автоматически
+    bool bigCoresOnly = false;
+    bool pooledAllocators = true;
+    bool useBf16 = false;
+    bool useInt8 = false;
+};
+
+//ModelInfo — описание одной модели апскейла из манифеста
+struct ModelInfo {
+    QString id;
+    QString name;
+    int scale = 4;
+    QString tier; //"light" — быстрая, "quality" — качественная
+    QString paramFile;
+    QString binFile;
+    QString inputBlob = "data";
+    QString outputBlob = "output";
+    float inputScale = 1 / 255.f; //множитель входа (пиксели 0..255 -> диапазон модели)
+    float outputScale = 255.f; //множитель выхода обратно в 0..255
+    int maxTileSize = 0; //верхняя граница размера тайла для этой модели, 0 — без ограничения
+    qint64 sizeBytes = 0;
+    QHash<QString, QString> sha256; //имя файла -> контрольная сумма
+    bool isDefault = false;
+
+    bool isValid() const { return !id.isEmpty(); }
+    static ModelInfo fromJson(const QJsonObject &obj);
+};
 
 class ModelsManager : public QObject {
     Q_OBJECT
     Q_PROPERTY(bool isModelDownloaded READ isModelDownloaded NOTIFY modelDownloadedChanged)
     Q_PROPERTY(bool isDownloading READ isDownloading NOTIFY downloadingChanged)
+    Q_PROPERTY(QString downloadingModelId READ downloadingModelId NOTIFY downloadingChanged)
     Q_PROPERTY(qreal downloadProgress READ downloadProgress NOTIFY progressChanged)
+    Q_PROPERTY(QVariantList models READ getModelsForQml NOTIFY modelsChanged)
 
 public:
     static ModelsManager& instance();
     static ModelsManager* create(QQmlEngine *qmlEngine, QJSEngine *jsEngine);
 
+    //true, если скачана хотя бы одна модель
     bool isModelDownloaded() const;
     bool isDownloading() const;
+    //id модели, которая сейчас скачивается; пустая строка, если загрузки нет
+    QString downloadingModelId() const;
     qreal downloadProgress() const;
+    QVariantList getModelsForQml() const;
+
+    //без id — модель по умолчанию из манифеста / все модели
+    Q_INVOKABLE void downloadModel(const QString &modelId = QString());
+    Q_INVOKABLE void deleteModel(const QString &modelId = QString());
+    // Замеряет апскейл небольшого изображения тем же тайловым конвейером при разном числе потоков,
+    // с пулом аллокаторов и без, с bf16 и без, и запоминает самый быстрый профиль
+    Q_INVOKABLE void autotuneInference();
 
-    Q_INVOKABLE void downloadModel();
-    Q_INVOKABLE void deleteModel();
-    
-    QString getModelPath() const;
-    QString getParamPath() const;
+    QVector<ModelInfo> getModels() const;
+    ModelInfo getModel(const QString &modelId) const;
+    bool hasModelFiles(const ModelInfo &model) const;
+    QString getModelFilePath(const QString &fileName) const;
+    // У всех файлов модели есть sha256 в манифесте; иначе скачанные файлы не проверены
+    static bool isVerified(const ModelInfo &model);
+
+    // Адрес каталога моделей (по умолчанию — сервер или IMAGOREF_MODELS_URL); манифест сразу запрашивается заново
+    void setBaseUrl(const QString &url);
+
+    // Выбор скачанной модели для задания: "quality", "fast" или "auto".
+    // В режиме "auto" для больших картинок берется легкая модель. Невалидная ModelInfo — моделей нет
+    ModelInfo selectModel(const QString &quality, const QSize &sourceSize) const;
+
+    // Общая загруженная сеть модели для всех заданий апскейла (по одной на модель). Веса читаются с диска один раз,
+    // потокобезопасно; каждое задание создает из нее свой Extractor. nullptr, если модель не загрузилась
+    std::shared_ptr<ncnn::Net> acquireNet(const ModelInfo &model, QString *error = nullptr);
 
 signals:
     void modelDownloadedChanged();
     void downloadingChanged();
     void progressChanged();
+    void modelsChanged();
     void downloadFinished(bool success, const QString &errorMsg);
+    void autotuneFinished(int threads);
 
 private slots:
+    void onDownloadReadyRead();
     void onDownloadProgress(qint64 bytesReceived, qint64 bytesTotal);
     void onDownloadFinished();
+    void releaseIdleNets();
 
 private:
     explicit ModelsManager(QObject *parent = nullptr);
     ModelsManager(const ModelsManager&) = delete;
     ModelsManager& operator=(const ModelsManager&) = delete;
 
+    void loadManifest();
+    void fetchRemoteManifest();
     void downloadNextFile();
+    void startFileDownload();
+    void failDownload(const QString &errorMsg);
     void checkModelExists();
+    void releaseNets(const QString &modelId = QString());
+    void updateInferenceProfile();
+    // Отдельный экземпляр сети с заданным профилем, вне общего пула
+    std::shared_ptr<ncnn::Net> loadNet(const ModelInfo &model, const InferenceProfile &profile, QString *error = nullptr) const;
+    // Подбирает профиль под это железо; false — модель не загрузилась или инференс не прошел
+    bool runAutotune(const ModelInfo &model, InferenceProfile &best);
+
+    QVector<ModelInfo> m_models;
 
     QStringList m_downloadQueue;
+    ModelInfo m_downloadModel;
     QString m_currentFileName;
-    qreal m_totalProgress = 0.0;
     int m_fileIndex = 0;
+    int m_fileCount = 0;
+
+    // Файл качается в <имя>.part, сразу на диск, с докачкой по Range; на место встает только после проверки SHA-256
+    QFile *m_downloadFile = nullptr;
+    QCryptographicHash m_downloadHash{QCryptographicHash::Sha256};
+    qint64 m_resumeOffset = 0;
+    int m_downloadAttempt = 0;
 
     bool m_isModelDownloaded = false;
     bool m_isDownloading = false;
     qreal m_downloadProgress = 0.0;
-    
+
     QNetworkAccessManager *m_networkManager;
     QNetworkReply *m_networkReply;
     QString m_modelsDir;
+    QString m_baseUrl; //можно подменить переменной IMAGOREF_MODELS_URL, например локальным сервером
+
+    // Загруженная сеть освобождается, если ею не пользуются дольше таймаута
+    struct LoadedNetEntry {
+        std::shared_ptr<ncnn::Net> net;
+        QElapsedTimer lastUsed;
+    };
+
+    QMutex m_netMutex;
+    QHash<QString, LoadedNetEntry> m_nets; //по id модели
+    QTimer m_netIdleTimer;
+    InferenceProfile m_profile; //защищен m_netMutex, читается из рабочих потоков
+    bool m_isAutotuning = false;
 };
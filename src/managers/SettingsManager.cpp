@@ -33,14 +33,25 @@ void SettingsManager::loadSettings()
     m_canvasPattern = m_settings.value("canvas/pattern", "dots").toString();
     m_labelFontSize = m_settings.value("label/fontSize", 14).toInt();
     m_arrangeSpacing = m_settings.value("arrange/spacing", 20).toInt();
+    m_arrangeAlgorithm = m_settings.value("arrange/algorithm", "maxrects").toString();
     m_hasPromptedUpscale = m_settings.value("models/hasPromptedUpscale", false).toBool();
     m_toolbarColumns = m_settings.value("toolbar/columns", 1).toInt();
     m_colorCopyMode = m_settings.value("colorCopyMode", 0).toInt();
+    m_eyedropperSampleSize = m_settings.value("eyedropper/sampleSize", 1).toInt();
     m_colorHistory = m_settings.value("colorHistory", QStringList()).toStringList();
     m_jwtToken = m_settings.value("auth/jwtToken", "").toString();
     m_userEmail = m_settings.value("auth/userEmail", "").toString();
     m_userNickname = m_settings.value("auth/userNickname", "").toString();
     m_userAvatarHash = m_settings.value("auth/userAvatarHash", "").toString();
+    m_maxParallelTransfers = m_settings.value("network/maxParallelTransfers", 4).toInt();
+    m_upscaleTileSize = m_settings.value("upscale/tileSize", 256).toInt();
+    m_upscaleQuality = m_settings.value("upscale/quality", "auto").toString();
+    m_upscaleThreads = m_settings.value("upscale/threads", 0).toInt();
+    m_upscaleBigCoresOnly = m_settings.value("upscale/bigCoresOnly", false).toBool();
+    m_upscalePooledAllocators = m_settings.value("upscale/pooledAllocators", true).toBool();
+    m_upscaleUseBf16 = m_settings.value("upscale/useBf16", false).toBool();
+    m_upscaleUseInt8 = m_settings.value("upscale/useInt8", false).toBool();
+    m_upscaleAutotuned = m_settings.value("upscale/autotuned", false).toBool();
     
     // Загрузка recentBoards из JSON строки
     m_recentBoards.clear();
@@ -79,14 +90,25 @@ void SettingsManager::saveSettings()
     m_settings.setValue("canvas/pattern", m_canvasPattern);
     m_settings.setValue("label/fontSize", m_labelFontSize);
     m_settings.setValue("arrange/spacing", m_arrangeSpacing);
+    m_settings.setValue("arrange/algorithm", m_arrangeAlgorithm);
     m_settings.setValue("models/hasPromptedUpscale", m_hasPromptedUpscale);
     m_settings.setValue("toolbar/columns", m_toolbarColumns);
     m_settings.setValue("colorCopyMode", m_colorCopyMode);
+    m_settings.setValue("eyedropper/sampleSize", m_eyedropperSampleSize);
     m_settings.setValue("colorHistory", m_colorHistory);
     m_settings.setValue("auth/jwtToken", m_jwtToken);
     m_settings.setValue("auth/userEmail", m_userEmail);
     m_settings.setValue("auth/userNickname", m_userNickname);
     m_settings.setValue("auth/userAvatarHash", m_userAvatarHash);
+    m_settings.setValue("network/maxParallelTransfers", m_maxParallelTransfers);
+    m_settings.setValue("upscale/tileSize", m_upscaleTileSize);
+    m_settings.setValue("upscale/quality", m_upscaleQuality);
+    m_settings.setValue("upscale/threads", m_upscaleThreads);
+    m_settings.setValue("upscale/bigCoresOnly", m_upscaleBigCoresOnly);
+    m_settings.setValue("upscale/pooledAllocators", m_upscalePooledAllocators);
+    m_settings.setValue("upscale/useBf16", m_upscaleUseBf16);
+    m_settings.setValue("upscale/useInt8", m_upscaleUseInt8);
+    m_settings.setValue("upscale/autotuned", m_upscaleAutotuned);
     
     // Сохранение recentBoards как JSON строка
     QJsonArray arr;
@@ -179,6 +201,21 @@ void SettingsManager::setArrangeSpacing(int spacing)
     }
 }
 
+QString SettingsManager::getArrangeAlgorithm() const
+{
+    return m_arrangeAlgorithm;
+}
+
+void SettingsManager::setArrangeAlgorithm(const QString &algorithm)
+{
+    QString value = (algorithm == "skyline" || algorithm == "shelf") ? algorithm : "maxrects";
+    if (m_arrangeAlgorithm != value) {
+        m_arrangeAlgorithm = value;
+        saveSettings();
+        emit arrangeAlgorithmChanged();
+    }
+}
+
 bool SettingsManager::getHasPromptedUpscale() const { return m_hasPromptedUpscale; }
 
 void SettingsManager::setHasPromptedUpscale(bool prompted)
@@ -215,6 +252,152 @@ void SettingsManager::setColorCopyMode(int mode)
     }
 }
 
+int SettingsManager::getEyedropperSampleSize() const
+{
+    return m_eyedropperSampleSize;
+}
+
+void SettingsManager::setEyedropperSampleSize(int size)
+{
+    size = qBound(1, size | 1, 15); //только нечетные, чтобы центр совпадал с курсором
+    if (m_eyedropperSampleSize != size) {
+        m_eyedropperSampleSize = size;
+        saveSettings();
+        emit eyedropperSampleSizeChanged();
+    }
+}
+
+int SettingsManager::getMaxParallelTransfers() const
+{
+    return m_maxParallelTransfers;
+}
+
+void SettingsManager::setMaxParallelTransfers(int count)
+{
+    count = qMax(1, count);
+    if (m_maxParallelTransfers != count) {
+        m_maxParallelTransfers = count;
+        saveSettings();
+        emit maxParallelTransfersChanged();
+    }
+}
+
+int SettingsManager::getUpscaleTileSize() const
+{
+    return m_upscaleTileSize;
+}
+
+void SettingsManager::setUpscaleTileSize(int size)
+{
+    //слишком маленькие тайлы тратят время на перекрытия, слишком большие — память
+    size = qBound(64, size, 2048);
+    if (m_upscaleTileSize != size) {
+        m_upscaleTileSize = size;
+        saveSettings();
+        emit upscaleTileSizeChanged();
+    }
+}
+
+QString SettingsManager::getUpscaleQuality() const
+{
+    return m_upscaleQuality;
+}
+
+void SettingsManager::setUpscaleQuality(const QString &quality)
+{
+    QString value = (quality == "fast" || quality == "quality") ? quality : "auto";
+    if (m_upscaleQuality != value) {
+        m_upscaleQuality = value;
+        saveSettings();
+        emit upscaleQualityChanged();
+    }
+}
+
+int SettingsManager::getUpscaleThreads() const
+{
+    return m_upscaleThreads;
+}
+
+void SettingsManager::setUpscaleThreads(int threads)
+{
+    threads = qMax(0, threads);
+    if (m_upscaleThreads != threads) {
+        m_upscaleThreads = threads;
+        saveSettings();
+        emit inferenceProfileChanged();
+    }
+}
+
+bool SettingsManager::getUpscaleBigCoresOnly() const
+{
+    return m_upscaleBigCoresOnly;
+}
+
+void SettingsManager::setUpscaleBigCoresOnly(bool bigCoresOnly)
+{
+    if (m_upscaleBigCoresOnly != bigCoresOnly) {
+        m_upscaleBigCoresOnly = bigCoresOnly;
+        saveSettings();
+        emit inferenceProfileChanged();
+    }
+}
+
+bool SettingsManager::getUpscalePooledAllocators() const
+{
+    return m_upscalePooledAllocators;
+}
+
+void SettingsManager::setUpscalePooledAllocators(bool pooled)
+{
+    if (m_upscalePooledAllocators != pooled) {
+        m_upscalePooledAllocators = pooled;
+        saveSettings();
+        emit inferenceProfileChanged();
+    }
+}
+
+bool SettingsManager::getUpscaleUseBf16() const
+{
+    return m_upscaleUseBf16;
+}
+
+void SettingsManager::setUpscaleUseBf16(bool use)
+{
+    if (m_upscaleUseBf16 != use) {
+        m_upscaleUseBf16 = use;
+        saveSettings();
+        emit inferenceProfileChanged();
+    }
+}
+
+bool SettingsManager::getUpscaleUseInt8() const
+{
+    return m_upscaleUseInt8;
+}
+
+void SettingsManager::setUpscaleUseInt8(bool use)
+{
+    if (m_upscaleUseInt8 != use) {
+        m_upscaleUseInt8 = use;
+        saveSettings();
+        emit inferenceProfileChanged();
+    }
+}
+
+bool SettingsManager::getUpscaleAutotuned() const
+{
+    return m_upscaleAutotuned;
+}
+
+void SettingsManager::setUpscaleAutotuned(bool autotuned)
+{
+    if (m_upscaleAutotuned != autotuned) {
+        m_upscaleAutotuned = autotuned;
+        saveSettings();
+        emit upscaleAutotunedChanged();
+    }
+}
+
 QStringList SettingsManager::getColorHistory() const
 {
     return m_colorHistory;
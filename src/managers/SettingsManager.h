@@ -19,15 +19,27 @@ class SettingsManager : public QObject {
     Q_PROPERTY(QString canvasPattern READ getCanvasPattern WRITE setCanvasPattern NOTIFY canvasPatternChanged)
     Q_PROPERTY(int labelFontSize READ getLabelFontSize WRITE setLabelFontSize NOTIFY labelFontSizeChanged)
     Q_PROPERTY(int arrangeSpacing READ getArrangeSpacing WRITE setArrangeSpacing NOTIFY arrangeSpacingChanged)
+    Q_PROPERTY(QString arrangeAlgorithm READ getArrangeAlgorithm WRITE setArrangeAlgorithm NOTIFY arrangeAlgorithmChanged)
     Q_PROPERTY(bool hasPromptedUpscale READ getHasPromptedUpscale WRITE setHasPromptedUpscale NOTIFY hasPromptedUpscaleChanged)
     Q_PROPERTY(int toolbarColumns READ getToolbarColumns WRITE setToolbarColumns NOTIFY toolbarColumnsChanged)
     Q_PROPERTY(int colorCopyMode READ getColorCopyMode WRITE setColorCopyMode NOTIFY colorCopyModeChanged)
+    Q_PROPERTY(int eyedropperSampleSize READ getEyedropperSampleSize WRITE setEyedropperSampleSize NOTIFY eyedropperSampleSizeChanged)
     Q_PROPERTY(QStringList colorHistory READ getColorHistory WRITE setColorHistory NOTIFY colorHistoryChanged)
     Q_PROPERTY(QString jwtToken READ getJwtToken WRITE setJwtToken NOTIFY jwtTokenChanged)
     Q_PROPERTY(QString userEmail READ getUserEmail WRITE setUserEmail NOTIFY userEmailChanged)
     Q_PROPERTY(QString userNickname READ getUserNickname WRITE setUserNickname NOTIFY userNicknameChanged)
     Q_PROPERTY(QString userAvatarHash READ getUserAvatarHash WRITE setUserAvatarHash NOTIFY userAvatarHashChanged)
     Q_PROPERTY(QVariantList recentBoards READ getRecentBoards WRITE setRecentBoards NOTIFY recentBoardsChanged)
+    Q_PROPERTY(int maxParallelTransfers READ getMaxParallelTransfers WRITE setMaxParallelTransfers NOTIFY maxParallelTransfersChanged)
+    Q_PROPERTY(int upscaleTileSize READ getUpscaleTileSize WRITE setUpscaleTileSize NOTIFY upscaleTileSizeChanged)
+    Q_PROPERTY(QString upscaleQuality READ getUpscaleQuality WRITE setUpscaleQuality NOTIFY upscaleQualityChanged)
+    //профиль инференса апскейла (ncnn)
+    Q_PROPERTY(int upscaleThreads READ getUpscaleThreads WRITE setUpscaleThreads NOTIFY inferenceProfileChanged)
+    Q_PROPERTY(bool upscaleBigCoresOnly READ getUpscaleBigCoresOnly WRITE setUpscaleBigCoresOnly NOTIFY inferenceProfileChanged)
+    Q_PROPERTY(bool upscalePooledAllocators READ getUpscalePooledAllocators WRITE setUpscalePooledAllocators NOTIFY inferenceProfileChanged)
+    Q_PROPERTY(bool upscaleUseBf16 READ getUpscaleUseBf16 WRITE setUpscaleUseBf16 NOTIFY inferenceProfileChanged)
+    Q_PROPERTY(bool upscaleUseInt8 READ getUpscaleUseInt8 WRITE setUpscaleUseInt8 NOTIFY inferenceProfileChanged)
+    Q_PROPERTY(bool upscaleAutotuned READ getUpscaleAutotuned WRITE setUpscaleAutotuned NOTIFY upscaleAutotunedChanged)
 
 public:
     static SettingsManager* create(QQmlEngine *qmlEngine, QJSEngine *jsEngine);
@@ -51,6 +63,10 @@ public:
     int getArrangeSpacing() const;
     void setArrangeSpacing(int spacing);
 
+    //"maxrects", "skyline" или "shelf"
+    QString getArrangeAlgorithm() const;
+    void setArrangeAlgorithm(const QString &algorithm);
+
     bool getHasPromptedUpscale() const;
     void setHasPromptedUpscale(bool prompted);
 
@@ -60,6 +76,10 @@ public:
     int getColorCopyMode() const;
     void setColorCopyMode(int mode);
 
+    //сторона квадрата усреднения пипетки в пикселях изображения (нечетная: 1, 3, 5...)
+    int getEyedropperSampleSize() const;
+    void setEyedropperSampleSize(int size);
+
     QStringList getColorHistory() const;
     void setColorHistory(const QStringList& history);
     Q_INVOKABLE void addColorToHistory(const QString& hexColor);
@@ -84,6 +104,30 @@ public:
     Q_INVOKABLE void removeRecentBoard(const QString& idOrPath);
     Q_INVOKABLE void renameRecentBoard(const QString& idOrPath, const QString& newName);
     
+    int getMaxParallelTransfers() const;
+    void setMaxParallelTransfers(int count);
+
+    int getUpscaleTileSize() const;
+    void setUpscaleTileSize(int size);
+
+    //"auto", "fast" или "quality" — какую модель апскейла выбирать
+    QString getUpscaleQuality() const;
+    void setUpscaleQuality(const QString &quality);
+
+    //0 — автоматически (все ядра или только производительные)
+    int getUpscaleThreads() const;
+    void setUpscaleThreads(int threads);
+    bool getUpscaleBigCoresOnly() const;
+    void setUpscaleBigCoresOnly(bool bigCoresOnly);
+    bool getUpscalePooledAllocators() const;
+    void setUpscalePooledAllocators(bool pooled);
+    bool getUpscaleUseBf16() const;
+    void setUpscaleUseBf16(bool use);
+    bool getUpscaleUseInt8() const;
+    void setUpscaleUseInt8(bool use);
+    bool getUpscaleAutotuned() const;
+    void setUpscaleAutotuned(bool autotuned);
+    
     Q_INVOKABLE bool isToolEnabled(const QString &toolName) const;
     Q_INVOKABLE void setToolEnabled(const QString &toolName, bool enabled);
 
@@ -93,15 +137,22 @@ signals:
     void canvasPatternChanged();
     void labelFontSizeChanged();
     void arrangeSpacingChanged();
+    void arrangeAlgorithmChanged();
     void hasPromptedUpscaleChanged();
     void toolbarColumnsChanged();
     void colorCopyModeChanged();
+    void eyedropperSampleSizeChanged();
     void colorHistoryChanged();
     void jwtTokenChanged();
     void userEmailChanged();
     void userNicknameChanged();
     void userAvatarHashChanged();
     void recentBoardsChanged();
+    void maxParallelTransfersChanged();
+    void upscaleTileSizeChanged();
+    void upscaleQualityChanged();
+    void inferenceProfileChanged();
+    void upscaleAutotunedChanged(); //отдельно от профиля: отметка о настройке не должна перезагружать сети
     
     void toolEnablementChanged(QString toolName, bool enabled);
 
@@ -116,14 +167,25 @@ private:
     QString m_canvasPattern;
     int m_labelFontSize;
     int m_arrangeSpacing;
+    QString m_arrangeAlgorithm;
     bool m_hasPromptedUpscale;
     int m_toolbarColumns;
     int m_colorCopyMode;
+    int m_eyedropperSampleSize;
     QStringList m_colorHistory;
     QString m_jwtToken;
     QString m_userEmail;
     QString m_userNickname;
     QString m_userAvatarHash;
     QVariantList m_recentBoards;
+    int m_maxParallelTransfers;
+    int m_upscaleTileSize;
+    QString m_upscaleQuality;
+    int m_upscaleThreads;
+    bool m_upscaleBigCoresOnly;
+    bool m_upscalePooledAllocators;
+    bool m_upscaleUseBf16;
+    bool m_upscaleUseInt8;
+    bool m_upscaleAutotuned;
     QHash<QString, bool> m_toolsEnablement;
 };
@@ -1,7 +1,9 @@
 #include "ImageModel.h"
 #include "CacheManager.h"
+#include "LayoutEngine.h"
 #include <QUuid>
 #include <QDateTime>
+#include <algorithm>
 
 ImagoImageModel::ImagoImageModel(QObject *parent) : QAbstractListModel(parent) {}
 
@@ -9,39 +11,39 @@ ImagoImageModel::ImagoImageModel(QObject *parent) : QAbstractListModel(parent) {
 QVariant ImagoImageModel::data(const QModelIndex &index, int role) const
 {
     //проверка существования индекса в массиве
-    if (!index.isValid() || index.row() >= m_items.count())
+    if (!index.isValid() || !isValidRow(index.row()))
         return QVariant();
 
-    //получаем нужную картинку
-    const ImagoImageData &item = m_items.at(index.row());
+    const int row = index.row();
+    const ColdData &cold = m_cold.at(row);
 
     switch (role) {
-    case IdRole: return item.id;
+    case IdRole: return cold.id;
     case SourceRole: //источник картинки
-        if (item.source.isEmpty() && !item.id.isEmpty() && !item.pixmap.isNull()) { //если картинка получена не по пути на диске (без файла)
+        if (cold.source.isEmpty() && !cold.id.isEmpty() && !cold.pixmap.isNull()) { //если картинка получена не по пути на диске (без файла)
             //возвращаем динамический URL из ImagoImageProvider
             //добавляем параметр версии, чтобы избежать кэширования старого изображения в QML
-            QString urlStr = QString("image://imago/%1?v=%2").arg(item.id).arg(item.version);
-            if (item.cropWidth > 0 && item.cropHeight > 0) {
+            QString urlStr = QString("image://imago/%1?v=%2").arg(cold.id).arg(cold.version);
+            if (cold.cropWidth > 0 && cold.cropHeight > 0) {
                 //пробрасываем параметры обрезки картинки в ImagoImageProvider
-                urlStr += QString("&cx=%1&cy=%2&cw=%3&ch=%4").arg(item.cropX).arg(item.cropY).arg(item.cropWidth).arg(item.cropHeight);
+                urlStr += QString("&cx=%1&cy=%2&cw=%3&ch=%4").arg(cold.cropX).arg(cold.cropY).arg(cold.cropWidth).arg(cold.cropHeight);
             }
             return QUrl(urlStr);
         }
-        return item.source;
-    case XRole: return item.x;
-    case YRole: return item.y;
-    case WidthRole: return item.width;
-    case HeightRole: return item.height;
-    case RotationRole: return item.rotation;
-    case ZValueRole: return item.zValue;
-    case SelectedRole: return item.selected;
-    case LabelRole: return item.label;
-    case CropXRole: return item.cropX;
-    case CropYRole: return item.cropY;
-    case CropWidthRole: return item.cropWidth;
-    case CropHeightRole: return item.cropHeight;
-    case OpacityRole: return item.opacity;
+        return cold.source;
+    case XRole: return m_x.at(row);
+    case YRole: return m_y.at(row);
+    case WidthRole: return m_width.at(row);
+    case HeightRole: return m_height.at(row);
+    case RotationRole: return m_rotation.at(row);
+    case ZValueRole: return m_zValue.at(row);
+    case SelectedRole: return m_selected.testBit(row);
+    case LabelRole: return cold.label;
+    case CropXRole: return cold.cropX;
+    case CropYRole: return cold.cropY;
+    case CropWidthRole: return cold.cropWidth;
+    case CropHeightRole: return cold.cropHeight;
+    case OpacityRole: return cold.opacity;
     default: return QVariant();
     }
 }
@@ -50,59 +52,43 @@ QVariant ImagoImageModel::data(const QModelIndex &index, int role) const
 bool ImagoImageModel::setData(const QModelIndex &index, const QVariant &value, int role)
 {
     //проверка существования индекса в массиве
-    if (!index.isValid() || index.row() >= m_items.count())
+    if (!index.isValid() || !isValidRow(index.row()))
         return false;
 
-    ImagoImageData &item = m_items[index.row()];
+    const int row = index.row();
+    ColdData &cold = m_cold[row];
     bool changed = false;
 
+    //присваивает значение полю, если оно отличается
+    auto assignReal = [&](qreal &field) {
+        if (field != value.toReal()) { field = value.toReal(); changed = true; }
+    };
+
     switch (role) {
-    case XRole:
-        if (item.x != value.toReal()) { item.x = value.toReal(); changed = true; }
-        break;
-    case YRole:
-        if (item.y != value.toReal()) { item.y = value.toReal(); changed = true; }
-        break;
-    case WidthRole:
-        if (item.width != value.toReal()) { item.width = value.toReal(); changed = true; }
-        break;
-    case HeightRole:
-        if (item.height != value.toReal()) { item.height = value.toReal(); changed = true; }
-        break;
-    case RotationRole:
-        if (item.rotation != value.toReal()) { item.rotation = value.toReal(); changed = true; }
-        break;
-    case ZValueRole:
-        if (item.zValue != value.toReal()) { item.zValue = value.toReal(); changed = true; }
-        break;
+    case XRole: assignReal(m_x[row]); break;
+    case YRole: assignReal(m_y[row]); break;
+    case WidthRole: assignReal(m_width[row]); break;
+    case HeightRole: assignReal(m_height[row]); break;
+    case RotationRole: assignReal(m_rotation[row]); break;
+    case ZValueRole: assignReal(m_zValue[row]); break;
     case SelectedRole:
-        if (item.selected != value.toBool()) { item.selected = value.toBool(); changed = true; }
+        changed = setSelectedBit(row, value.toBool());
         break;
     case LabelRole:
-        if (item.label != value.toString()) { item.label = value.toString(); changed = true; }
-        break;
-    case CropXRole:
-        if (item.cropX != value.toReal()) { item.cropX = value.toReal(); changed = true; }
-        break;
-    case CropYRole:
-        if (item.cropY != value.toReal()) { item.cropY = value.toReal(); changed = true; }
-        break;
-    case CropWidthRole:
-        if (item.cropWidth != value.toReal()) { item.cropWidth = value.toReal(); changed = true; }
-        break;
-    case CropHeightRole:
-        if (item.cropHeight != value.toReal()) { item.cropHeight = value.toReal(); changed = true; }
-        break;
-    case OpacityRole:
-        if (item.opacity != value.toReal()) { item.opacity = value.toReal(); changed = true; }
+        if (cold.label != value.toString()) { cold.label = value.toString(); changed = true; }
         break;
+    case CropXRole: assignReal(cold.cropX); break;
+    case CropYRole: assignReal(cold.cropY); break;
+    case CropWidthRole: assignReal(cold.cropWidth); break;
+    case CropHeightRole: assignReal(cold.cropHeight); break;
+    case OpacityRole: assignReal(cold.opacity); break;
     default:
         return false;
     }
 
-    //сигнал о том, что данные изменились
+    //сигнал о том, что данные изменились (внутри транзакции — вместе с остальными строками)
     if (changed) {
-        emit dataChanged(index, index, {role});
+        notifyChanged(row, {role});
     }
     return changed;
 }
@@ -139,14 +125,14 @@ Qt::ItemFlags ImagoImageModel::flags(const QModelIndex &index) const
 
 int ImagoImageModel::getCount() const
 {
-    return m_items.count();
+    return m_cold.count();
 }
 
 int ImagoImageModel::rowCount(const QModelIndex &parent) const
 {
     if (parent.isValid())
         return 0;
-    return m_items.count();
+    return m_cold.count();
 }
 
 QString ImagoImageModel::generateId()
@@ -154,16 +140,137 @@ QString ImagoImageModel::generateId()
     return QUuid::createUuid().toString(QUuid::WithoutBraces);
 }
 
+bool ImagoImageModel::isValidRow(int row) const
+{
+    return row >= 0 && row < m_cold.count();
+}
+
+bool ImagoImageModel::setSelectedBit(int row, bool selected)
+{
+    if (m_selected.testBit(row) == selected)
+        return false;
+
+    m_selected.setBit(row, selected);
+    m_selectedCount += selected ? 1 : -1;
+    m_selectedCacheValid = false;
+    return true;
+}
+
+//раскладывает запись по массивам (строка уже существует)
+void ImagoImageModel::storeItem(int row, const ImagoImageData &data)
+{
+    m_x[row] = data.x;
+    m_y[row] = data.y;
+    m_width[row] = data.width;
+    m_height[row] = data.height;
+    m_rotation[row] = data.rotation;
+    m_zValue[row] = data.zValue;
+    setSelectedBit(row, data.selected);
+
+    ColdData &cold = m_cold[row];
+    cold.id = data.id;
+    cold.source = data.source;
+    cold.pixmap = data.pixmap;
+    cold.label = data.label;
+    cold.imageHash = data.imageHash;
+    cold.cropX = data.cropX;
+    cold.cropY = data.cropY;
+    cold.cropWidth = data.cropWidth;
+    cold.cropHeight = data.cropHeight;
+    cold.opacity = data.opacity;
+    cold.version = data.version;
+}
+
+//пустая строка во всех массивах сразу
+void ImagoImageModel::insertRow(int row)
+{
+    m_x.insert(row, 0);
+    m_y.insert(row, 0);
+    m_width.insert(row, 0);
+    m_height.insert(row, 0);
+    m_rotation.insert(row, 0);
+    m_zValue.insert(row, 0);
+    m_cold.insert(row, ColdData());
+
+    //QBitArray не умеет вставку, сдвигаем хвост вручную
+    const int count = m_selected.size();
+    m_selected.resize(count + 1);
+    for (int i = count; i > row; --i) {
+        m_selected.setBit(i, m_selected.testBit(i - 1));
+    }
+    m_selected.clearBit(row);
+    m_selectedCacheValid = false; //индексы после row сдвинулись
+}
+
+void ImagoImageModel::removeRow(int row)
+{
+    m_x.removeAt(row);
+    m_y.removeAt(row);
+    m_width.removeAt(row);
+    m_height.removeAt(row);
+    m_rotation.removeAt(row);
+    m_zValue.removeAt(row);
+    m_cold.removeAt(row);
+
+    if (m_selected.testBit(row)) {
+        --m_selectedCount;
+    }
+    m_selectedCacheValid = false;
+
+    const int count = m_selected.size();
+    for (int i = row; i < count - 1; ++i) {
+        m_selected.setBit(i, m_selected.testBit(i + 1));
+    }
+    m_selected.resize(count - 1);
+}
+
+void ImagoImageModel::clearStorage()
+{
+    m_x.clear();
+    m_y.clear();
+    m_width.clear();
+    m_height.clear();
+    m_rotation.clear();
+    m_zValue.clear();
+    m_selected.clear();
+    m_selectedCount = 0;
+    m_selectedCacheValid = false;
+    m_cold.clear();
+    m_rowById.clear();
+}
+
+void ImagoImageModel::reindexFrom(int row)
+{
+    if (row == 0) {
+        m_rowById.clear();
+        m_rowById.reserve(m_cold.count());
+    }
+    for (int i = row; i < m_cold.count(); ++i) {
+        m_rowById.insert(m_cold.at(i).id, i);
+    }
+}
+
 //добавление объекта
 void ImagoImageModel::addImage(const ImagoImageData &data)
 {
-    beginInsertRows(QModelIndex(), m_items.count(), m_items.count());
+    insertImage(m_cold.count(), data);
+}
+
+//вставка объекта на строку row (сдвигает последующие)
+void ImagoImageModel::insertImage(int row, const ImagoImageData &data)
+{
+    row = qBound(0, row, int(m_cold.count()));
+    flushPendingChanges(); //накопленные строки должны уйти до сдвига индексов
+
+    beginInsertRows(QModelIndex(), row, row);
     ImagoImageData newItem = data;
     if (newItem.id.isEmpty()) {
         //создание ID, если новый объект
         newItem.id = generateId();
     }
-    m_items.append(newItem);
+    insertRow(row);
+    storeItem(row, newItem);
+    reindexFrom(row);
     endInsertRows();
     emit countChanged(); //сигнал о том, что количество объектов изменилось
 }
@@ -172,24 +279,30 @@ void ImagoImageModel::updateItemData(const QString& id, const ImagoImageData& da
 {
     int idx = getIndexById(id);
     if (idx >= 0) {
-        m_items[idx] = data;
-        QModelIndex modelIndex = createIndex(idx, 0);
-        QVector<int> roles;
+        storeItem(idx, data);
+        if (data.id != id) {
+            m_rowById.remove(id);
+            m_rowById.insert(data.id, idx);
+        }
+        QList<int> roles;
         for (int r = IdRole; r <= OpacityRole; ++r) {
             roles.append(r);
         }
-        emit dataChanged(modelIndex, modelIndex, roles);
+        notifyChanged(idx, roles);
     }
 }
 
 //удаление объекта
 void ImagoImageModel::removeImage(int index)
 {
-    if (index < 0 || index >= m_items.count())
+    if (!isValidRow(index))
         return;
 
+    flushPendingChanges();
     beginRemoveRows(QModelIndex(), index, index);
-    m_items.removeAt(index);
+    m_rowById.remove(m_cold.at(index).id);
+    removeRow(index);
+    reindexFrom(index);
     endRemoveRows();
     emit countChanged();
 }
@@ -206,42 +319,114 @@ void ImagoImageModel::removeImageById(const QString &id)
 //полное очистка всех объектов
 void ImagoImageModel::clear()
 {
-    if (m_items.isEmpty())
+    if (m_cold.isEmpty())
         return;
 
+    m_pendingRoles.clear();
     beginResetModel();
-    m_items.clear();
+    clearStorage();
     endResetModel();
     emit countChanged();
 }
 
-//получение копии объекта
+//получение копии объекта (собирается из массивов)
 ImagoImageData ImagoImageModel::getItem(int index) const
 {
-    if (index < 0 || index >= m_items.count())
+    if (!isValidRow(index))
         return ImagoImageData();
-    return m_items.at(index);
+
+    const ColdData &cold = m_cold.at(index);
+    ImagoImageData item;
+    item.id = cold.id;
+    item.source = cold.source;
+    item.pixmap = cold.pixmap;
+    item.x = m_x.at(index);
+    item.y = m_y.at(index);
+    item.width = m_width.at(index);
+    item.height = m_height.at(index);
+    item.rotation = m_rotation.at(index);
+    item.zValue = m_zValue.at(index);
+    item.selected = m_selected.testBit(index);
+    item.label = cold.label;
+    item.imageHash = cold.imageHash;
+    item.cropX = cold.cropX;
+    item.cropY = cold.cropY;
+    item.cropWidth = cold.cropWidth;
+    item.cropHeight = cold.cropHeight;
+    item.opacity = cold.opacity;
+    item.version = cold.version;
+    return item;
 }
 
 int ImagoImageModel::getIndexById(const QString &id) const
 {
-    for (int i = 0; i < m_items.count(); ++i) {
-        if (m_items.at(i).id == id) {
-            return i;
-        }
-    }
-    return -1;
+    return m_rowById.value(id, -1);
+}
+
+QString ImagoImageModel::getItemId(int index) const
+{
+    return isValidRow(index) ? m_cold.at(index).id : QString();
+}
+
+QRectF ImagoImageModel::getItemRect(int index) const
+{
+    if (!isValidRow(index))
+        return QRectF();
+    return QRectF(m_x.at(index), m_y.at(index), m_width.at(index), m_height.at(index));
+}
+
+qreal ImagoImageModel::getItemRotation(int index) const
+{
+    return isValidRow(index) ? m_rotation.at(index) : 0;
+}
+
+QRectF ImagoImageModel::getItemBounds(int index) const
+{
+    if (!isValidRow(index))
+        return QRectF();
+    return LayoutEngine::rotatedBoundingRect(getItemRect(index), m_rotation.at(index));
+}
+
+bool ImagoImageModel::isSelected(int index) const
+{
+    return isValidRow(index) && m_selected.testBit(index);
+}
+
+bool ImagoImageModel::hasPixmap(int index) const
+{
+    return isValidRow(index) && !m_cold.at(index).pixmap.isNull();
 }
 
 QVector<ImagoImageData> ImagoImageModel::getAllItems() const
 {
-    return m_items;
+    QVector<ImagoImageData> items;
+    items.reserve(m_cold.count());
+    for (int i = 0; i < m_cold.count(); ++i) {
+        items.append(getItem(i));
+    }
+    return items;
 }
 
 void ImagoImageModel::setAllItems(const QVector<ImagoImageData> &items)
 {
+    m_pendingRoles.clear();
     beginResetModel();
-    m_items = items;
+    clearStorage();
+
+    const int count = items.count();
+    m_x.resize(count);
+    m_y.resize(count);
+    m_width.resize(count);
+    m_height.resize(count);
+    m_rotation.resize(count);
+    m_zValue.resize(count);
+    m_selected.resize(count);
+    m_cold.resize(count);
+    for (int i = 0; i < count; ++i) {
+        storeItem(i, items.at(i));
+    }
+
+    reindexFrom(0);
     endResetModel();
     emit countChanged();
 }
@@ -249,145 +434,218 @@ void ImagoImageModel::setAllItems(const QVector<ImagoImageData> &items)
 //методы изменения параметров объекта
 void ImagoImageModel::setPosition(int index, qreal x, qreal y)
 {
-    if (index < 0 || index >= m_items.count())
+    if (!isValidRow(index))
         return;
 
-    m_items[index].x = x;
-    m_items[index].y = y;
-    QModelIndex modelIndex = createIndex(index, 0);
-    emit dataChanged(modelIndex, modelIndex, {XRole, YRole});
+    m_x[index] = x;
+    m_y[index] = y;
+    notifyChanged(index, {XRole, YRole});
 }
 
 void ImagoImageModel::setSize(int index, qreal width, qreal height)
 {
-    if (index < 0 || index >= m_items.count())
+    if (!isValidRow(index))
         return;
 
-    m_items[index].width = width;
-    m_items[index].height = height;
-    QModelIndex modelIndex = createIndex(index, 0);
-    emit dataChanged(modelIndex, modelIndex, {WidthRole, HeightRole});
+    m_width[index] = width;
+    m_height[index] = height;
+    notifyChanged(index, {WidthRole, HeightRole});
 }
 
 void ImagoImageModel::setRotation(int index, qreal rotation)
 {
-    if (index < 0 || index >= m_items.count())
+    if (!isValidRow(index))
         return;
 
-    m_items[index].rotation = rotation;
-    QModelIndex modelIndex = createIndex(index, 0);
-    emit dataChanged(modelIndex, modelIndex, {RotationRole});
+    m_rotation[index] = rotation;
+    notifyChanged(index, {RotationRole});
 }
 
 void ImagoImageModel::setSelected(int index, bool selected)
 {
-    if (index < 0 || index >= m_items.count())
+    if (!isValidRow(index))
         return;
 
-    if (m_items[index].selected != selected) {
-        m_items[index].selected = selected;
-        QModelIndex modelIndex = createIndex(index, 0);
-        emit dataChanged(modelIndex, modelIndex, {SelectedRole});
+    if (setSelectedBit(index, selected)) {
+        notifyChanged(index, {SelectedRole});
     }
 }
 
 void ImagoImageModel::clearSelection()
 {
-    for (int i = 0; i < m_items.count(); ++i) {
-        if (m_items[i].selected) {
-            m_items[i].selected = false;
-            QModelIndex modelIndex = createIndex(i, 0);
-            emit dataChanged(modelIndex, modelIndex, {SelectedRole});
-        }
+    if (m_selectedCount == 0)
+        return;
+
+    //проходим только по выделенным строкам; соседние сольются в один dataChanged при фиксации
+    const QVariantList selected = getSelectedIndices();
+    beginTransaction();
+    for (const QVariant &v : selected) {
+        setSelectedBit(v.toInt(), false);
+        notifyChanged(v.toInt(), {SelectedRole});
     }
+    commitTransaction();
 }
 
 void ImagoImageModel::setCrop(int index, qreal x, qreal y, qreal width, qreal height)
 {
-    if (index < 0 || index >= m_items.count())
+    if (!isValidRow(index))
         return;
 
-    m_items[index].cropX = x;
-    m_items[index].cropY = y;
-    m_items[index].cropWidth = width;
-    m_items[index].cropHeight = height;
-    
-    QModelIndex modelIndex = createIndex(index, 0);
+    ColdData &cold = m_cold[index];
+    cold.cropX = x;
+    cold.cropY = y;
+    cold.cropWidth = width;
+    cold.cropHeight = height;
+
     QList<int> roles = {CropXRole, CropYRole, CropWidthRole, CropHeightRole};
-    if (m_items[index].source.isEmpty()) {
+    if (cold.source.isEmpty()) {
         roles.append(SourceRole);
     }
-    emit dataChanged(modelIndex, modelIndex, roles);
+    notifyChanged(index, roles);
 }
 
 void ImagoImageModel::setLabel(int index, const QString &label)
 {
-    if (index < 0 || index >= m_items.count())
+    if (!isValidRow(index))
         return;
 
-    if (m_items[index].label != label) {
-        m_items[index].label = label;
-        QModelIndex modelIndex = createIndex(index, 0);
-        emit dataChanged(modelIndex, modelIndex, {LabelRole});
+    if (m_cold[index].label != label) {
+        m_cold[index].label = label;
+        notifyChanged(index, {LabelRole});
     }
 }
 
 void ImagoImageModel::setOpacity(int index, qreal opacity)
 {
-    if (index < 0 || index >= m_items.count())
+    if (!isValidRow(index))
         return;
 
-    if (m_items[index].opacity != opacity) {
-        m_items[index].opacity = opacity;
-        QModelIndex modelIndex = createIndex(index, 0);
-        emit dataChanged(modelIndex, modelIndex, {OpacityRole});
+    if (m_cold[index].opacity != opacity) {
+        m_cold[index].opacity = opacity;
+        notifyChanged(index, {OpacityRole});
     }
 }
 
 QVariantList ImagoImageModel::getSelectedIndices() const
 {
-    QVariantList result;
-    for (int i = 0; i < m_items.count(); ++i) {
-        if (m_items[i].selected) {
-            result.append(i);
+    if (!m_selectedCacheValid) {
+        m_selectedCache.clear();
+        m_selectedCache.reserve(m_selectedCount);
+        for (int i = 0; i < m_selected.size() && m_selectedCache.size() < m_selectedCount; ++i) {
+            if (m_selected.testBit(i)) {
+                m_selectedCache.append(i);
+            }
         }
+        m_selectedCacheValid = true;
     }
-    return result;
+    return m_selectedCache;
+}
+
+int ImagoImageModel::getSelectedCount() const
+{
+    return m_selectedCount;
+}
+
+bool ImagoImageModel::hasSelection() const
+{
+    return m_selectedCount > 0;
 }
 
 void ImagoImageModel::setPixmap(int index, const QPixmap &pixmap)
 {
-    if (index < 0 || index >= m_items.count())
+    if (!isValidRow(index))
         return;
 
-    m_items[index].pixmap = pixmap;
-    m_items[index].source = QUrl(); //очищаем локальный путь, чтобы QML брал пиксели из ImagoImageProvider
-    m_items[index].version = QDateTime::currentMSecsSinceEpoch(); //обновляем версию для сброса кэша QML
-    
+    ColdData &cold = m_cold[index];
+    cold.pixmap = pixmap;
+    cold.source = QUrl(); //очищаем локальный путь, чтобы QML брал пиксели из ImagoImageProvider
+    cold.version = QDateTime::currentMSecsSinceEpoch(); //обновляем версию для сброса кэша QML
+
     //pixmap не привязан к роли в QML, но можно оповестить об изменении source
-    QModelIndex modelIndex = createIndex(index, 0);
-    emit dataChanged(modelIndex, modelIndex, {SourceRole});
+    notifyChanged(index, {SourceRole});
 }
 
 void ImagoImageModel::setImageHash(int index, const QString &hash) {
-    if (index < 0 || index >= m_items.size()) return;
-    m_items[index].imageHash = hash;
-    
-    // Оповещаем QML (если у тебя есть роль ImageHashRole, подставь ее)
-    QModelIndex modelIndex = createIndex(index, 0);
-    emit dataChanged(modelIndex, modelIndex); 
+    if (!isValidRow(index)) return;
+    m_cold[index].imageHash = hash;
+
+    //своей роли у хэша нет; он описывает картинку, поэтому оповещаем как об изменении source
+    notifyChanged(index, {SourceRole});
+}
+
+void ImagoImageModel::beginTransaction()
+{
+    ++m_transactionDepth;
+}
+
+void ImagoImageModel::commitTransaction()
+{
+    if (m_transactionDepth == 0) return;
+    if (--m_transactionDepth == 0) {
+        flushPendingChanges();
+    }
+}
+
+void ImagoImageModel::notifyChanged(int row, const QList<int> &roles)
+{
+    if (m_transactionDepth == 0) {
+        QModelIndex modelIndex = createIndex(row, 0);
+        emit dataChanged(modelIndex, modelIndex, roles);
+        return;
+    }
+
+    //роли копятся по каждой строке отдельно: по ним BoardController помечает измененные поля именно этой строки
+    auto it = m_pendingRoles.find(row);
+    if (it == m_pendingRoles.end()) {
+        m_pendingRoles.insert(row, roles);
+    } else if (!it->isEmpty()) {
+        if (roles.isEmpty()) {
+            it->clear();
+        } else {
+            for (int role : roles) {
+                if (!it->contains(role)) it->append(role);
+            }
+        }
+    }
+}
+
+void ImagoImageModel::flushPendingChanges()
+{
+    if (m_pendingRoles.isEmpty()) return;
+
+    QHash<int, QList<int>> pending;
+    pending.swap(m_pendingRoles);
+    QList<int> rows = pending.keys();
+    std::sort(rows.begin(), rows.end());
+    for (QList<int> &roles : pending) {
+        std::sort(roles.begin(), roles.end());
+    }
+
+    //соседние строки с одинаковым набором ролей объединяются в один диапазон
+    int first = rows.first();
+    int last = first;
+    for (int i = 1; i <= rows.size(); ++i) {
+        if (i < rows.size() && rows[i] == last + 1 && pending[rows[i]] == pending[first]) {
+            last = rows[i];
+            continue;
+        }
+        emit dataChanged(createIndex(first, 0), createIndex(last, 0), pending[first]);
+        if (i < rows.size()) {
+            first = last = rows[i];
+        }
+    }
 }
 
 void ImagoImageModel::loadPixmapFromCache(int index)
 {
-    if (index < 0 || index >= m_items.count())
+    if (!isValidRow(index))
         return;
 
-    const ImagoImageData &item = m_items.at(index);
-    if (!item.imageHash.isEmpty()) {
-        QPixmap cached = CacheManager::instance().loadFromCache(item.imageHash);
+    const QString hash = m_cold.at(index).imageHash;
+    if (!hash.isEmpty()) {
+        QPixmap cached = CacheManager::instance().loadFromCache(hash);
         if (!cached.isNull()) {
             setPixmap(index, cached);
         }
     }
-}
\ No newline at end of file
+}
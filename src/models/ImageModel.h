@@ -5,6 +5,9 @@
 #include <QAbstractListModel> //умные списки в Qt, через которые QML автоматически перерисует элемент при изменении свойств
 #include <QPixmap> //изображения в Qt
 #include <QUrl> //класс для работы с путями
+#include <QHash> //роли измененных строк в транзакции
+#include <QBitArray> //флаги выделения
+#include <QRectF>
 #include <QtQml/qqml.h> //работа с QML
 
 //ImagoImageData - структура данных для хранения информации об одном изображении
@@ -76,11 +79,20 @@ public:
     //методы для управления
     int getCount() const;
     void addImage(const ImagoImageData &data);
+    void insertImage(int row, const ImagoImageData &data); //вставка на заданную строку (отмена удаления)
     void removeImage(int index);
     void removeImageById(const QString &id);
     void clear();
     Q_INVOKABLE ImagoImageData getItem(int index) const;
     int getIndexById(const QString &id) const;
+
+    //быстрый доступ к отдельным полям без сборки всей записи (для проходов по тысячам элементов)
+    QString getItemId(int index) const;
+    QRectF getItemRect(int index) const;
+    qreal getItemRotation(int index) const;
+    QRectF getItemBounds(int index) const; //габариты на холсте с учетом поворота (выравнивание, направляющие)
+    bool isSelected(int index) const;
+    bool hasPixmap(int index) const;
     
     //работа со всеми объектами сразу (StorageController)
     void updateItemData(const QString& id, const ImagoImageData& data);
@@ -95,19 +107,65 @@ public:
     Q_INVOKABLE void setLabel(int index, const QString &label);
     Q_INVOKABLE void setSelected(int index, bool selected);
     Q_INVOKABLE void clearSelection();
-    Q_INVOKABLE QVariantList getSelectedIndices() const;
+    Q_INVOKABLE QVariantList getSelectedIndices() const; //возвращает закэшированный список, пересобирается только после изменений
+    int getSelectedCount() const;
+    bool hasSelection() const;
     Q_INVOKABLE void setOpacity(int index, qreal opacity);
     Q_INVOKABLE void loadPixmapFromCache(int index);
 
     void setPixmap(int index, const QPixmap &pixmap);
     void setImageHash(int index, const QString &hash);
 
+    //пакетное изменение: между beginTransaction и commitTransaction сеттеры только копят измененные строки,
+    //dataChanged уходит один раз на каждый непрерывный диапазон строк с одинаковым набором ролей. Вызовы могут быть вложенными
+    void beginTransaction();
+    void commitTransaction();
+
 signals:
     //изменение количества объектов
     void countChanged();
 
 private:
-    QVector<ImagoImageData> m_items; //вектор всех объектов программы 
+    //"холодные" поля элемента: нужны при отрисовке и сохранении, но не при проходах по геометрии
+    struct ColdData {
+        QString id;
+        QUrl source;
+        QPixmap pixmap;
+        QString label;
+        QString imageHash;
+        qreal cropX = 0;
+        qreal cropY = 0;
+        qreal cropWidth = 0;
+        qreal cropHeight = 0;
+        qreal opacity = 1.0;
+        qint64 version = 0;
+    };
+
+    //структура массивов: "горячая" геометрия лежит плотно, строка — индекс во всех массивах
+    QVector<qreal> m_x;
+    QVector<qreal> m_y;
+    QVector<qreal> m_width;
+    QVector<qreal> m_height;
+    QVector<qreal> m_rotation;
+    QVector<qreal> m_zValue;
+    QBitArray m_selected;
+    int m_selectedCount = 0; //число установленных бит в m_selected
+    mutable QVariantList m_selectedCache; //отсортированные выделенные строки
+    mutable bool m_selectedCacheValid = false;
+    QVector<ColdData> m_cold;
+    QHash<QString, int> m_rowById; //id -> строка для поиска за O(1)
+    
+    int m_transactionDepth = 0;
+    QHash<int, QList<int>> m_pendingRoles; //строка, измененная внутри транзакции -> ее роли; пустой список — все роли
     
     QString generateId(); //генерация уникального ID объекта
+    void notifyChanged(int row, const QList<int> &roles); //dataChanged сразу или по завершении транзакции
+    void flushPendingChanges();
+    void reindexFrom(int row); //пересчет m_rowById для строк начиная с row
+    bool isValidRow(int row) const;
+    bool setSelectedBit(int row, bool selected); //меняет бит с учетом счетчика и кэша, true — если изменился
+    void storeItem(int row, const ImagoImageData &data); //раскладывает запись по массивам
+    void insertRow(int row);
+    void removeRow(int row);
+    void clearStorage();
 };
@@ -53,6 +53,12 @@ Item {
         flickable.contentY = scenePos.y * zoomLevel - center.y
     }
 
+    //видимая область в координатах рабочей области
+    function visibleSceneRect() {
+        return Qt.rect(flickable.contentX / zoomLevel, flickable.contentY / zoomLevel,
+                       width / zoomLevel, height / zoomLevel)
+    }
+
     //функция перевода экранных координат в координаты рабочей области
     function mapToScene(point) {
         return Qt.point(
@@ -261,8 +267,10 @@ Item {
                     required property bool modelSelected
 
                     //применяем свойства
-                    x: imgDelegate.modelX
-                    y: imgDelegate.modelY
+                    //во время группового перетаскивания выделенные сдвигаются общим смещением, модель не меняется до отпускания
+                    property bool groupDragged: imgDelegate.modelSelected && root.controller.groupDragActive
+                    x: imgDelegate.modelX + (groupDragged ? root.controller.groupDragOffset.x : 0)
+                    y: imgDelegate.modelY + (groupDragged ? root.controller.groupDragOffset.y : 0)
                     itemWidth: imgDelegate.modelWidth
                     itemHeight: imgDelegate.modelHeight
                     rotation: imgDelegate.modelRotation
@@ -284,6 +292,23 @@ Item {
                     onExitCropMode: root.cropMode = false
                 }
             }
+
+            //умные направляющие при перетаскивании выделения
+            Repeater {
+                model: controller.snapGuides
+
+                delegate: Rectangle {
+                    required property var modelData
+                    readonly property real lineWidth: 1 / root.zoomLevel
+
+                    x: modelData.vertical ? modelData.position - lineWidth / 2 : 0
+                    y: modelData.vertical ? 0 : modelData.position - lineWidth / 2
+                    width: modelData.vertical ? lineWidth : root.sceneSize
+                    height: modelData.vertical ? root.sceneSize : lineWidth
+                    color: ThemeManager.colors.accentColor
+                    z: 100000
+                }
+            }
         }
 
     //рамка выделения поверх Flickable
@@ -11,6 +11,12 @@ Rectangle {
 
     // История цветов берется из настроек
     property var colorHistory: SettingsManager.colorHistory
+
+    // Доминирующие цвета доски, считаются в фоне
+    property var boardPalette: controller.paletteController.boardPalette
+
+    // Цвета выделенного изображения, если выделено ровно одно
+    property var selectionPalette: controller.paletteController.selectionPalette
     
     // Скрыто по умолчанию
     property bool isPanelVisible: false
@@ -77,5 +83,75 @@ Rectangle {
             font.pixelSize: 13
             opacity: 0.6
         }
+
+        // Разделитель между историей и палитрой доски
+        Rectangle {
+            visible: root.boardPalette.length > 0
+            width: 1
+            height: 24
+            color: ThemeManager.colors.borderColor
+        }
+
+        Repeater {
+            model: root.boardPalette
+
+            delegate: Rectangle {
+                width: 24
+                height: 24
+                radius: 12
+                color: modelData
+                border.color: ThemeManager.colors.borderColor
+                border.width: 1
+
+                MouseArea {
+                    anchors.fill: parent
+                    hoverEnabled: true
+                    cursorShape: Qt.PointingHandCursor
+
+                    onClicked: {
+                        controller.toolController.copyColorToClipboard(modelData)
+                    }
+
+                    ToolTip.visible: containsMouse
+                    ToolTip.text: "Цвет доски " + modelData
+                    ToolTip.delay: 400
+                }
+            }
+        }
+
+        // Разделитель перед палитрой выделенного изображения
+        Rectangle {
+            visible: root.selectionPalette.length > 0
+            width: 1
+            height: 24
+            color: ThemeManager.colors.borderColor
+        }
+
+        Repeater {
+            model: root.selectionPalette
+
+            delegate: Rectangle {
+                width: 24
+                height: 24
+                radius: 4
+                color: modelData
+                border.color: ThemeManager.colors.borderColor
+                border.width: 1
+
+                MouseArea {
+                    anchors.fill: parent
+                    hoverEnabled: true
+                    cursorShape: Qt.PointingHandCursor
+
+                    onClicked: {
+                        controller.toolController.copyColorToClipboard(modelData)
+                    }
+
+                    ToolTip.visible: containsMouse
+                    ToolTip.text: "Цвет изображения " + modelData
+                    ToolTip.delay: 400
+                }
+            }
+        }
     }
 }
@@ -8,6 +8,8 @@ Item {
     
     // Получаем контроллер
     required property BoardController controller
+    // Холст, в координаты сцены которого переводится курсор
+    required property Item canvasView
     
     // Видимость привязана к свойству в ToolController
     visible: controller.toolController.isEyedropperActive
@@ -17,23 +19,21 @@ Item {
     property color currentColor: "#000000"
     property string colorText: "#000000"
 
-    // Таймер для тротлинга захвата цвета экрана
-    Timer {
-        id: colorUpdateTimer
-        interval: 16 // ~60fps
-        repeat: false
-        property int lastGlobalX: 0
-        property int lastGlobalY: 0
-        onTriggered: {
-            currentColor = controller.toolController.getColorAtPoint(lastGlobalX, lastGlobalY)
-            var mode = SettingsManager.colorCopyMode
-            if (mode === 0) { // HEX
-                colorText = currentColor.toString().toUpperCase()
-            } else { // RGB
-                colorText = "RGB(" + Math.round(currentColor.r * 255) + ", " + 
-                            Math.round(currentColor.g * 255) + ", " + 
-                            Math.round(currentColor.b * 255) + ")"
-            }
+    // Цвет берется из пикселей изображений на доске, без снимка экрана, поэтому обновляется на каждое движение
+    function updateColor(x, y) {
+        var canvasPos = root.mapToItem(canvasView, x, y)
+        var scenePos = canvasView.mapToScene(canvasPos)
+        var sampled = controller.toolController.getColorAtScenePoint(scenePos.x, scenePos.y)
+        // Вне изображений — цвет фона холста
+        currentColor = sampled.valid ? sampled : ThemeManager.colors.backgroundColor
+
+        var mode = SettingsManager.colorCopyMode
+        if (mode === 0) { // HEX
+            colorText = currentColor.toString().toUpperCase()
+        } else { // RGB
+            colorText = "RGB(" + Math.round(currentColor.r * 255) + ", " + 
+                        Math.round(currentColor.g * 255) + ", " + 
+                        Math.round(currentColor.b * 255) + ")"
         }
     }
 
@@ -44,11 +44,7 @@ Item {
         cursorShape: Qt.CrossCursor //Крестообразный курсор
         
         onPositionChanged: (mouse) => {
-            // Конвертируем локальные координаты в глобальные экранные
-            var globalPos = root.mapToGlobal(mouse.x, mouse.y)
-            colorUpdateTimer.lastGlobalX = globalPos.x
-            colorUpdateTimer.lastGlobalY = globalPos.y
-            colorUpdateTimer.restart()
+            root.updateColor(mouse.x, mouse.y)
             
             // Двигаем виджет пипетки за курсором
             // Центрируем с отступом чуть левее и выше, чтобы курсор не перекрывал
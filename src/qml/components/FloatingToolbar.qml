@@ -28,6 +28,9 @@ Rectangle {
     property bool cropModeActive: false
     property bool opacityModeActive: false
     property bool labelModeActive: false
+
+    //видимая часть сцены: картинки в ней увеличиваются в первую очередь
+    property rect visibleSceneRect: Qt.rect(0, 0, 0, 0)
     
     // Cвойства для отслеживания состояния кнопок
     property bool btnZoomInVisible: true
@@ -130,16 +133,47 @@ Rectangle {
         }
         
         // Увеличить разрешение
+        // Во время работы кнопка показывает прогресс и отменяет очередь.
+        // Правый клик или долгое нажатие — выбор качества только для этого задания, настройка по умолчанию не меняется
         ToolbarButton {
             iconSource: ThemeManager.icons.upscaleIcon
-            tooltip: "Увеличить разрешение"
+            tooltip: controller.upscaleController.busy
+                     ? "Отменить увеличение разрешения: " + Math.round(controller.upscaleController.progress * 100) + "%"
+                     : "Увеличить разрешение (правый клик — выбрать качество)"
             shortcutText: "U"
+            active: controller.upscaleController.busy
             visible: ModelsManager.isModelDownloaded && root.btnUpscaleVisible
-            enabled: controller.selectionController.hasSelection
+            enabled: controller.selectionController.hasSelection || controller.upscaleController.busy
             onClicked: {
-                var selectedIndices = controller.model.getSelectedIndices()
-                for (var i = 0; i < selectedIndices.length; ++i) {
-                    controller.upscaleController.upscaleImage(selectedIndices[i])
+                if (controller.upscaleController.busy) {
+                    controller.upscaleController.cancelAll()
+                } else {
+                    controller.upscaleController.upscaleSelection(root.visibleSceneRect)
+                }
+            }
+            onPressAndHold: {
+                if (!controller.upscaleController.busy) upscaleQualityMenu.popup()
+            }
+            
+            TapHandler {
+                acceptedButtons: Qt.RightButton
+                enabled: !controller.upscaleController.busy
+                onTapped: upscaleQualityMenu.popup()
+            }
+            
+            Menu {
+                id: upscaleQualityMenu
+                MenuItem {
+                    text: "Автоматически"
+                    onTriggered: controller.upscaleController.upscaleSelection(root.visibleSceneRect, "auto")
+                }
+                MenuItem {
+                    text: "Быстро"
+                    onTriggered: controller.upscaleController.upscaleSelection(root.visibleSceneRect, "fast")
+                }
+                MenuItem {
+                    text: "Качественно"
+                    onTriggered: controller.upscaleController.upscaleSelection(root.visibleSceneRect, "quality")
                 }
             }
         }
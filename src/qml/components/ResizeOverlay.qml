@@ -178,8 +178,7 @@ Item {
                     var newX = newCx - newW / 2
                     var newY = newCy - newH / 2
                     
-                    controller.model.setPosition(itemIndex, newX, newY)
-                    controller.model.setSize(itemIndex, newW, newH)
+                    controller.updateResize(itemIndex, newX, newY, newW, newH)
                 }
                 
                 onReleased: {
@@ -189,10 +188,8 @@ Item {
                     var finalW = controller.selectionController.getItemWidth(itemIndex)
                     var finalH = controller.selectionController.getItemHeight(itemIndex)
                     
-                    if (finalX !== startPos.x || finalY !== startPos.y ||
-                        finalW !== startSize.width || finalH !== startSize.height) {
-                        controller.endResize(itemIndex, finalX, finalY, finalW, finalH)
-                    }
+                    // endResize сам проверяет, изменилось ли что-то, и завершает трансляцию ресайза
+                    controller.endResize(itemIndex, finalX, finalY, finalW, finalH)
                 }
             }
         }
@@ -104,6 +104,7 @@ Item {
         controller: root.controller
         visible: !root.isPinnedAndInactive
         z: 100
+        visibleSceneRect: canvasView.visibleSceneRect()
         x: 15
         y: 15
         
@@ -140,7 +141,7 @@ Item {
         onArrangeClicked: {
             var center = Qt.point(canvasView.width / 2, canvasView.height / 2)
             var scenePos = canvasView.mapToScene(center)
-            controller.toolController.arrangeAll(scenePos.x, scenePos.y)
+            controller.toolController.arrangeAll(scenePos.x, scenePos.y, canvasView.width / canvasView.height)
         }
 
         resizeModeActive: canvasView.resizeMode
@@ -182,6 +183,7 @@ Item {
     EyedropperOverlay {
         id: eyedropperOverlay
         controller: root.controller
+        canvasView: canvasView
         z: 9999
     }
     
@@ -331,10 +333,59 @@ Item {
         onActivated: {
             var center = Qt.point(canvasView.width / 2, canvasView.height / 2)
             var scenePos = canvasView.mapToScene(center)
-            controller.toolController.arrangeAll(scenePos.x, scenePos.y)
+            controller.toolController.arrangeAll(scenePos.x, scenePos.y, canvasView.width / canvasView.height)
         }
     }
     
+    //расположить только выделенные
+    Shortcut {
+        sequence: "Shift+A"
+        enabled: !root.isWorkspaceLocked && root.toolArrangeEnabled
+        onActivated: controller.toolController.arrangeSelected(canvasView.width / canvasView.height)
+    }
+    
+    //выравнивание и распределение выделенных
+    Shortcut {
+        sequence: "Alt+A"
+        enabled: !root.isWorkspaceLocked
+        onActivated: controller.toolController.alignSelected("left")
+    }
+    Shortcut {
+        sequence: "Alt+H"
+        enabled: !root.isWorkspaceLocked
+        onActivated: controller.toolController.alignSelected("hcenter")
+    }
+    Shortcut {
+        sequence: "Alt+D"
+        enabled: !root.isWorkspaceLocked
+        onActivated: controller.toolController.alignSelected("right")
+    }
+    Shortcut {
+        sequence: "Alt+W"
+        enabled: !root.isWorkspaceLocked
+        onActivated: controller.toolController.alignSelected("top")
+    }
+    Shortcut {
+        sequence: "Alt+V"
+        enabled: !root.isWorkspaceLocked
+        onActivated: controller.toolController.alignSelected("vcenter")
+    }
+    Shortcut {
+        sequence: "Alt+S"
+        enabled: !root.isWorkspaceLocked
+        onActivated: controller.toolController.alignSelected("bottom")
+    }
+    Shortcut {
+        sequence: "Alt+Shift+H"
+        enabled: !root.isWorkspaceLocked
+        onActivated: controller.toolController.distributeSelected("horizontal")
+    }
+    Shortcut {
+        sequence: "Alt+Shift+V"
+        enabled: !root.isWorkspaceLocked
+        onActivated: controller.toolController.distributeSelected("vertical")
+    }
+    
     // Пипетка
     Shortcut {
         sequence: "I"
@@ -95,7 +95,10 @@ Dialog {
         SettingsManager.canvasPattern = patternComboBox.currentValue
         SettingsManager.labelFontSize = labelFontSizeSpinBox.value
         SettingsManager.arrangeSpacing = arrangeSpacingSpinBox.value
+        SettingsManager.arrangeAlgorithm = arrangeAlgorithmComboBox.currentValue
         SettingsManager.colorCopyMode = colorCopyModeComboBox.currentIndex
+        SettingsManager.eyedropperSampleSize = eyedropperSampleComboBox.currentValue
+        SettingsManager.upscaleQuality = upscaleQualityComboBox.currentValue
         ThemeManager.applyTheme(themeComboBox.currentValue)
     }
     
@@ -497,6 +500,50 @@ Dialog {
                         }
                     }
                     
+                    // Алгоритм автоматического расположения
+                    RowLayout {
+                        spacing: 0
+                        
+                        Label {
+                            text: "Алгоритм расположения"
+                            color: ThemeManager.colors.textColor
+                            Layout.preferredWidth: 160
+                        }
+                        
+                        ComboBox {
+                            id: arrangeAlgorithmComboBox
+                            Layout.preferredWidth: 180
+                            
+                            model: ListModel {
+                                ListElement { text: "Плотно (MaxRects)"; value: "maxrects" }
+                                ListElement { text: "Быстро (Skyline)"; value: "skyline" }
+                                ListElement { text: "Рядами"; value: "shelf" }
+                            }
+                            
+                            textRole: "text"
+                            valueRole: "value"
+                            
+                            background: Rectangle {
+                                color: ThemeManager.colors.controlBackground
+                                border.color: ThemeManager.colors.borderColor
+                                border.width: 1
+                                radius: 6
+                            }
+                            
+                            contentItem: Text {
+                                text: arrangeAlgorithmComboBox.displayText
+                                font.pixelSize: 13
+                                color: ThemeManager.colors.textColor
+                                verticalAlignment: Text.AlignVCenter
+                                leftPadding: 10
+                            }
+                            
+                            Component.onCompleted: {
+                                currentIndex = indexOfValue(SettingsManager.arrangeAlgorithm)
+                            }
+                        }
+                    }
+                    
                     // Режим копирования цвета (HEX / RGB)
                     RowLayout {
                         spacing: 0
@@ -540,31 +587,144 @@ Dialog {
                         }
                     }
                     
-                    // Управление моделью Upscale
+                    // Область усреднения пипетки
                     RowLayout {
                         spacing: 0
                         
                         Label {
-                            text: "Модель Upscale"
+                            text: "Усреднение пипетки"
                             color: ThemeManager.colors.textColor
                             Layout.preferredWidth: 160
                         }
                         
-                        // Кнопка скачивания или удаления
-                        Button {
+                        ComboBox {
+                            id: eyedropperSampleComboBox
                             Layout.preferredWidth: 180
-                            text: ModelsManager.isDownloading ? "Скачивание (" + Math.round(ModelsManager.downloadProgress * 100) + "%)" 
-                                                              : (ModelsManager.isModelDownloaded ? "Удалить модель" : "Скачать модель (35 МБ)")
-                            enabled: !ModelsManager.isDownloading
+                            
+                            model: ListModel {
+                                ListElement { text: "1 пиксель"; value: 1 }
+                                ListElement { text: "3 × 3"; value: 3 }
+                                ListElement { text: "5 × 5"; value: 5 }
+                                ListElement { text: "11 × 11"; value: 11 }
+                            }
+                            
+                            textRole: "text"
+                            valueRole: "value"
+                            
+                            background: Rectangle {
+                                color: ThemeManager.colors.controlBackground
+                                border.color: ThemeManager.colors.borderColor
+                                border.width: 1
+                                radius: 6
+                            }
                             
                             contentItem: Text {
-                                text: parent.text
+                                text: eyedropperSampleComboBox.displayText
                                 font.pixelSize: 13
                                 color: ThemeManager.colors.textColor
-                                horizontalAlignment: Text.AlignHCenter
                                 verticalAlignment: Text.AlignVCenter
+                                leftPadding: 10
+                            }
+                            
+                            Component.onCompleted: {
+                                currentIndex = indexOfValue(SettingsManager.eyedropperSampleSize)
+                            }
+                        }
+                    }
+                    
+                    // Модели Upscale: каждую можно скачать или удалить отдельно
+                    RowLayout {
+                        spacing: 0
+                        
+                        Label {
+                            text: "Модели Upscale"
+                            color: ThemeManager.colors.textColor
+                            Layout.preferredWidth: 160
+                            Layout.alignment: Qt.AlignTop
+                            topPadding: 8
+                        }
+                        
+                        ColumnLayout {
+                            spacing: 6
+                            
+                            Repeater {
+                                model: ModelsManager.models
+                                
+                                delegate: RowLayout {
+                                    id: modelRow
+                                    required property var modelData
+                                    readonly property bool isDownloadingThis: ModelsManager.downloadingModelId === modelData.id
+                                    spacing: 8
+                                    
+                                    Label {
+                                        text: modelRow.modelData.name + " ×" + modelRow.modelData.scale
+                                              + (modelRow.modelData.tier === "light" ? " · быстрая" : " · качественная")
+                                              + (modelRow.modelData.verified ? "" : " · без проверки")
+                                        color: ThemeManager.colors.textColor
+                                        font.pixelSize: 13
+                                        elide: Text.ElideRight
+                                        Layout.preferredWidth: 200
+                                    }
+                                    
+                                    // Кнопка скачивания или удаления
+                                    Button {
+                                        Layout.preferredWidth: 150
+                                        text: modelRow.isDownloadingThis ? "Скачивание (" + Math.round(ModelsManager.downloadProgress * 100) + "%)"
+                                                                         : (modelRow.modelData.downloaded ? "Удалить"
+                                                                                                          : "Скачать (" + Math.round(modelRow.modelData.sizeBytes / 1000000) + " МБ)")
+                                        enabled: !ModelsManager.isDownloading
+                                        
+                                        contentItem: Text {
+                                            text: parent.text
+                                            font.pixelSize: 13
+                                            color: ThemeManager.colors.textColor
+                                            horizontalAlignment: Text.AlignHCenter
+                                            verticalAlignment: Text.AlignVCenter
+                                        }
+                                        
+                                        background: Rectangle {
+                                            color: ThemeManager.colors.controlBackground
+                                            border.color: ThemeManager.colors.borderColor
+                                            border.width: 1
+                                            radius: 6
+                                        }
+                                        
+                                        onClicked: {
+                                            if (modelRow.modelData.downloaded) {
+                                                ModelsManager.deleteModel(modelRow.modelData.id)
+                                            } else {
+                                                ModelsManager.downloadModel(modelRow.modelData.id)
+                                            }
+                                        }
+                                    }
+                                }
+                            }
+                        }
+                    }
+                    
+                    // Выбор модели Upscale под задание
+                    RowLayout {
+                        spacing: 0
+                        
+                        Label {
+                            text: "Качество Upscale"
+                            color: ThemeManager.colors.textColor
+                            Layout.preferredWidth: 160
+                        }
+                        
+                        ComboBox {
+                            id: upscaleQualityComboBox
+                            Layout.preferredWidth: 180
+                            
+                            model: ListModel {
+                                ListElement { text: "Автоматически"; value: "auto" }
+                                ListElement { text: "Быстро"; value: "fast" }
+                                ListElement { text: "Качественно"; value: "quality" }
                             }
                             
+                            textRole: "text"
+                            valueRole: "value"
+                            
                             background: Rectangle {
                                 color: ThemeManager.colors.controlBackground
                                 border.color: ThemeManager.colors.borderColor
@@ -572,12 +732,16 @@ Dialog {
                                 radius: 6
                             }
                             
-                            onClicked: {
-                                if (ModelsManager.isModelDownloaded) {
-                                    ModelsManager.deleteModel()
-                                } else {
-                                    ModelsManager.downloadModel()
-                                }
+                            contentItem: Text {
+                                text: upscaleQualityComboBox.displayText
+                                font.pixelSize: 13
+                                color: ThemeManager.colors.textColor
+                                verticalAlignment: Text.AlignVCenter
+                                leftPadding: 10
+                            }
+                            
+                            Component.onCompleted: {
+                                currentIndex = indexOfValue(SettingsManager.upscaleQuality)
                             }
                         }
                     }
@@ -642,6 +806,10 @@ Dialog {
                     HotkeyRow { description: "Непрозрачность:"; keys: "O" }
                     HotkeyRow { description: "Подписать:"; keys: "L" }
                     HotkeyRow { description: "Расположить:"; keys: "A" }
+                    HotkeyRow { description: "Расположить выделенные:"; keys: "Shift+A" }
+                    HotkeyRow { description: "Выровнять влево / по центру / вправо:"; keys: "Alt+A / Alt+H / Alt+D" }
+                    HotkeyRow { description: "Выровнять вверх / по середине / вниз:"; keys: "Alt+W / Alt+V / Alt+S" }
+                    HotkeyRow { description: "Распределить по горизонтали / вертикали:"; keys: "Alt+Shift+H / Alt+Shift+V" }
                     HotkeyRow { description: "Пипетка:"; keys: "I" }
                     HotkeyRow { description: "Панель истории цветов:"; keys: "P" }
                     HotkeyRow { description: "Вращать по часовой:"; keys: "R" }
@@ -0,0 +1,186 @@
+#include "ColorQuantizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+constexpr int C_KMEANS_ITERATIONS = 10;
+constexpr float C_CONVERGED_DISTANCE = 0.25f; //центры сдвинулись меньше чем на полшага канала — дальше не уточняем
+constexpr int C_MIN_ALPHA = 128; //более прозрачные пиксели в палитру не попадают
+constexpr int C_HISTOGRAM_BITS = 4;
+constexpr int C_HISTOGRAM_SIZE = 1 << (3 * C_HISTOGRAM_BITS);
+
+//точки для кластеризации — отдельные плотные плоскости каналов и весов (SoA), чтобы циклы по точкам векторизовались
+struct Points {
+    QVector<float> r;
+    QVector<float> g;
+    QVector<float> b;
+    QVector<float> w;
+
+    void append(float red, float green, float blue, float weight)
+    {
+        r.append(red);
+        g.append(green);
+        b.append(blue);
+        w.append(weight);
+    }
+    int size() const { return r.size(); }
+};
+
+//квадрат расстояния от всех точек до центра с обновлением ближайшего; без ветвлений, компилятор разворачивает в SIMD
+void nearestToCenter(const float *r, const float *g, const float *b, int count,
+                     float cr, float cg, float cb, int center, float *best, int *labels)
+{
+    for (int i = 0; i < count; ++i) {
+        const float dr = r[i] - cr;
+        const float dg = g[i] - cg;
+        const float db = b[i] - cb;
+        const float d = dr * dr + dg * dg + db * db;
+        const float previous = best[i];
+        const int label = labels[i];
+        const int closer = -int(d < previous); //маска из единиц или нулей: с ней цикл векторизуется и без SSE4 blend
+        best[i] = std::min(d, previous);
+        labels[i] = (center & closer) | (label & ~closer);
+    }
+}
+
+QVector<ColorQuantizer::Swatch> kmeans(const Points &points, int colorCount)
+{
+    const int n = points.size();
+    if (n == 0 || colorCount <= 0) return {};
+
+    const float *r = points.r.constData();
+    const float *g = points.g.constData();
+    const float *b = points.b.constData();
+    const float *w = points.w.constData();
+
+    //детерминированная инициализация: самая "тяжелая" точка, затем каждый раз точка с наибольшим вес × расстояние
+    QVector<float> cr, cg, cb;
+    QVector<float> best(n, std::numeric_limits<float>::max());
+    QVector<int> labels(n, 0);
+
+    const int first = int(std::max_element(points.w.cbegin(), points.w.cend()) - points.w.cbegin());
+    cr.append(r[first]);
+    cg.append(g[first]);
+    cb.append(b[first]);
+    while (cr.size() < colorCount) {
+        const int last = cr.size() - 1;
+        nearestToCenter(r, g, b, n, cr[last], cg[last], cb[last], last, best.data(), labels.data());
+
+        int next = -1;
+        float nextScore = 0;
+        for (int i = 0; i < n; ++i) {
+            const float score = w[i] * best[i];
+            if (score > nextScore) {
+                nextScore = score;
+                next = i;
+            }
+        }
+        if (next < 0) break; //все точки уже совпадают с центрами
+        cr.append(r[next]);
+        cg.append(g[next]);
+        cb.append(b[next]);
+    }
+
+    const int k = cr.size();
+    QVector<double> sumR(k), sumG(k), sumB(k), sumW(k);
+    for (int iteration = 0; iteration < C_KMEANS_ITERATIONS; ++iteration) {
+        std::fill(best.begin(), best.end(), std::numeric_limits<float>::max());
+        for (int c = 0; c < k; ++c) {
+            nearestToCenter(r, g, b, n, cr[c], cg[c], cb[c], c, best.data(), labels.data());
+        }
+
+        std::fill(sumR.begin(), sumR.end(), 0.0);
+        std::fill(sumG.begin(), sumG.end(), 0.0);
+        std::fill(sumB.begin(), sumB.end(), 0.0);
+        std::fill(sumW.begin(), sumW.end(), 0.0);
+        for (int i = 0; i < n; ++i) {
+            const int c = labels[i];
+            sumR[c] += double(r[i]) * w[i];
+            sumG[c] += double(g[i]) * w[i];
+            sumB[c] += double(b[i]) * w[i];
+            sumW[c] += w[i];
+        }
+
+        float maxShift = 0;
+        for (int c = 0; c < k; ++c) {
+            if (sumW[c] <= 0) continue; //пустой кластер сохраняет прежний центр
+            const float nr = float(sumR[c] / sumW[c]);
+            const float ng = float(sumG[c] / sumW[c]);
+            const float nb = float(sumB[c] / sumW[c]);
+            maxShift = std::max({maxShift, std::abs(nr - cr[c]), std::abs(ng - cg[c]), std::abs(nb - cb[c])});
+            cr[c] = nr;
+            cg[c] = ng;
+            cb[c] = nb;
+        }
+        if (maxShift < C_CONVERGED_DISTANCE) break;
+    }
+
+    double totalWeight = 0;
+    for (double weight : std::as_const(sumW)) totalWeight += weight;
+
+    QVector<ColorQuantizer::Swatch> result;
+    for (int c = 0; c < k; ++c) {
+        if (sumW[c] <= 0) continue;
+        ColorQuantizer::Swatch swatch;
+        swatch.color = qRgb(qBound(0, qRound(cr[c]), 255), qBound(0, qRound(cg[c]), 255), qBound(0, qRound(cb[c]), 255));
+        swatch.weight = float(sumW[c] / totalWeight);
+        result.append(swatch);
+    }
+    std::sort(result.begin(), result.end(), [](const ColorQuantizer::Swatch &a, const ColorQuantizer::Swatch &b) {
+        return a.weight > b.weight;
+    });
+    return result;
+}
+}
+
+namespace ColorQuantizer {
+
+QVector<Swatch> extract(const QImage &image, int colorCount, int maxSide)
+{
+    if (image.isNull()) return {};
+
+    QImage small = image;
+    if (image.width() > maxSide || image.height() > maxSide) {
+        small = image.scaled(maxSide, maxSide, Qt::KeepAspectRatio, Qt::FastTransformation);
+    }
+    small = small.convertToFormat(QImage::Format_ARGB32);
+
+    //гистограмма 16×16×16: пиксели сводятся к нескольким сотням точек, в каждой ячейке — средний цвет и число пикселей
+    QVector<quint32> binR(C_HISTOGRAM_SIZE), binG(C_HISTOGRAM_SIZE), binB(C_HISTOGRAM_SIZE), binCount(C_HISTOGRAM_SIZE);
+    constexpr int shift = 8 - C_HISTOGRAM_BITS;
+    for (int y = 0; y < small.height(); ++y) {
+        const QRgb *line = reinterpret_cast<const QRgb *>(small.constScanLine(y));
+        for (int x = 0; x < small.width(); ++x) {
+            const QRgb pixel = line[x];
+            if (qAlpha(pixel) < C_MIN_ALPHA) continue;
+            const int red = qRed(pixel), green = qGreen(pixel), blue = qBlue(pixel);
+            const int bin = ((red >> shift) << (2 * C_HISTOGRAM_BITS)) | ((green >> shift) << C_HISTOGRAM_BITS) | (blue >> shift);
+            binR[bin] += red;
+            binG[bin] += green;
+            binB[bin] += blue;
+            binCount[bin]++;
+        }
+    }
+
+    Points points;
+    for (int bin = 0; bin < C_HISTOGRAM_SIZE; ++bin) {
+        const quint32 count = binCount[bin];
+        if (count == 0) continue;
+        points.append(float(binR[bin]) / count, float(binG[bin]) / count, float(binB[bin]) / count, float(count));
+    }
+    return kmeans(points, colorCount);
+}
+
+QVector<Swatch> merge(const QVector<Swatch> &swatches, int colorCount)
+{
+    Points points;
+    for (const Swatch &swatch : swatches) {
+        if (swatch.weight <= 0) continue;
+        points.append(qRed(swatch.color), qGreen(swatch.color), qBlue(swatch.color), swatch.weight);
+    }
+    return kmeans(points, colorCount);
+}
+
+}
@@ -0,0 +1,23 @@
+//ColorQuantizer — выделение доминирующих цветов: гистограмма 4 бита на канал, затем взвешенный k-means по плотным float-плоскостям (внутренний цикл векторизуется компилятором)
+
+#pragma once
+
+#include <QImage>
+#include <QRgb>
+#include <QVector>
+
+namespace ColorQuantizer {
+
+struct Swatch {
+    QRgb color = 0;
+    float weight = 0; //доля пикселей (для палитры изображения) или произвольный вес при слиянии
+};
+
+//палитра из не более чем colorCount цветов, по убыванию веса. Картинка сначала уменьшается до maxSide по большей стороне,
+//почти прозрачные пиксели не учитываются. Потокобезопасно, вызывается из рабочих потоков
+QVector<Swatch> extract(const QImage &image, int colorCount, int maxSide = 96);
+
+//сводит взвешенные цвета (например, палитры всех изображений доски) к colorCount цветам
+QVector<Swatch> merge(const QVector<Swatch> &swatches, int colorCount);
+
+}
@@ -0,0 +1,49 @@
+#include "EdgeIndex.h"
+
+#include <algorithm>
+#include <cmath>
+
+void EdgeIndex::clear()
+{
+    m_values.clear();
+}
+
+void EdgeIndex::add(qreal value)
+{
+    m_values.append(value);
+}
+
+void EdgeIndex::build()
+{
+    std::sort(m_values.begin(), m_values.end());
+    m_values.erase(std::unique(m_values.begin(), m_values.end()), m_values.end());
+}
+
+bool EdgeIndex::isEmpty() const
+{
+    return m_values.isEmpty();
+}
+
+bool EdgeIndex::findNearest(qreal value, qreal maxDistance, qreal *found) const
+{
+    if (m_values.isEmpty()) return false;
+
+    //кандидаты — первый не меньший value и предыдущий перед ним
+    auto it = std::lower_bound(m_values.cbegin(), m_values.cend(), value);
+    qreal best = 0;
+    qreal bestDistance = maxDistance;
+    bool hasBest = false;
+
+    if (it != m_values.cend() && std::abs(*it - value) <= bestDistance) {
+        best = *it;
+        bestDistance = std::abs(*it - value);
+        hasBest = true;
+    }
+    if (it != m_values.cbegin() && std::abs(*(it - 1) - value) <= bestDistance) {
+        best = *(it - 1);
+        hasBest = true;
+    }
+
+    if (hasBest && found) *found = best;
+    return hasBest;
+}
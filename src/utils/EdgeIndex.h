@@ -0,0 +1,21 @@
+//EdgeIndex — отсортированный список координат краев (левый/центр/правый или верх/центр/низ) для быстрого поиска ближайшей направляющей
+
+#pragma once
+
+#include <QVector>
+#include <QtGlobal>
+
+class EdgeIndex {
+public:
+    void clear();
+    void add(qreal value);
+    void build(); //сортировка после серии add(); до нее поиск не работает
+
+    bool isEmpty() const;
+
+    //ближайшая к value координата не дальше maxDistance; false, если такой нет. Поиск бинарный, O(log n)
+    bool findNearest(qreal value, qreal maxDistance, qreal *found) const;
+
+private:
+    QVector<qreal> m_values;
+};
@@ -0,0 +1,273 @@
+#include "LayoutEngine.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+namespace {
+//погрешность сравнения координат, чтобы не терять места из-за ошибок округления
+constexpr qreal C_EPSILON = 1e-6;
+//выше этого числа элементов MaxRects заменяется более быстрыми алгоритмами: перебор свободных областей растет квадратично
+constexpr int C_MAX_RECTS_LIMIT = 1000;
+
+//порядок обхода: сначала высокие (при равной высоте — широкие)
+QVector<int> orderByHeight(const QVector<QSizeF> &sizes)
+{
+    QVector<int> order(sizes.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+        if (sizes[a].height() != sizes[b].height()) return sizes[a].height() > sizes[b].height();
+        return sizes[a].width() > sizes[b].width();
+    });
+    return order;
+}
+
+void packShelf(const QVector<QSizeF> &sizes, qreal binWidth, QVector<QPointF> &positions)
+{
+    qreal x = 0, y = 0, rowHeight = 0;
+    for (int i : orderByHeight(sizes)) {
+        const QSizeF &size = sizes[i];
+        if (x + size.width() > binWidth + C_EPSILON && x > 0) {
+            x = 0;
+            y += rowHeight;
+            rowHeight = 0;
+        }
+        positions[i] = QPointF(x, y);
+        x += size.width();
+        rowHeight = std::max(rowHeight, size.height());
+    }
+}
+
+//Skyline: верхняя граница уже уложенного описывается отрезками, новый прямоугольник ставится туда, где его верх окажется ниже всего
+void packSkyline(const QVector<QSizeF> &sizes, qreal binWidth, QVector<QPointF> &positions)
+{
+    struct Segment {
+        qreal x;
+        qreal y;
+        qreal width;
+    };
+    QVector<Segment> skyline;
+    skyline.append({0, 0, binWidth});
+
+    for (int i : orderByHeight(sizes)) {
+        const qreal w = sizes[i].width();
+        const qreal h = sizes[i].height();
+
+        int bestIndex = -1;
+        qreal bestTop = std::numeric_limits<qreal>::max();
+        qreal bestY = 0;
+
+        for (int s = 0; s < skyline.size(); ++s) {
+            const qreal x = skyline[s].x;
+            if (x + w > binWidth + C_EPSILON) break; //отрезки идут слева направо, дальше только хуже
+
+            //высота опоры — максимум по отрезкам, которые накрывает прямоугольник
+            qreal y = 0;
+            qreal widthLeft = w;
+            for (int j = s; j < skyline.size() && widthLeft > C_EPSILON; ++j) {
+                y = std::max(y, skyline[j].y);
+                widthLeft -= skyline[j].width;
+            }
+
+            if (y + h < bestTop - C_EPSILON) {
+                bestTop = y + h;
+                bestY = y;
+                bestIndex = s;
+            }
+        }
+
+        const qreal x = skyline[bestIndex].x;
+        positions[i] = QPointF(x, bestY);
+
+        //новый отрезок поверх прямоугольника, перекрытые справа обрезаются
+        skyline.insert(bestIndex, {x, bestY + h, w});
+        const qreal right = x + w;
+        int next = bestIndex + 1;
+        while (next < skyline.size() && skyline[next].x < right - C_EPSILON) {
+            const qreal overlap = right - skyline[next].x;
+            if (overlap >= skyline[next].width - C_EPSILON) {
+                skyline.removeAt(next);
+            } else {
+                skyline[next].x += overlap;
+                skyline[next].width -= overlap;
+                break;
+            }
+        }
+
+        //соседние отрезки одной высоты сливаются, чтобы список не разрастался
+        for (int s = 0; s + 1 < skyline.size();) {
+            if (std::abs(skyline[s].y - skyline[s + 1].y) < C_EPSILON) {
+                skyline[s].width += skyline[s + 1].width;
+                skyline.removeAt(s + 1);
+            } else {
+                ++s;
+            }
+        }
+    }
+}
+
+//MaxRects: хранится набор максимальных свободных прямоугольников; выбирается самое низкое положение (затем самое левое)
+void packMaxRects(const QVector<QSizeF> &sizes, qreal binWidth, QVector<QPointF> &positions)
+{
+    qreal binHeight = 0;
+    for (const QSizeF &size : sizes) {
+        binHeight += size.height(); //столбик из всех элементов помещается всегда
+    }
+
+    QVector<QRectF> freeRects;
+    freeRects.append(QRectF(0, 0, binWidth, binHeight));
+
+    QVector<int> order(sizes.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+        return std::max(sizes[a].width(), sizes[a].height()) > std::max(sizes[b].width(), sizes[b].height());
+    });
+
+    QVector<QRectF> created;
+    for (int i : order) {
+        const qreal w = sizes[i].width();
+        const qreal h = sizes[i].height();
+
+        int bestIndex = -1;
+        qreal bestTop = std::numeric_limits<qreal>::max();
+        qreal bestX = std::numeric_limits<qreal>::max();
+        for (int f = 0; f < freeRects.size(); ++f) {
+            const QRectF &free = freeRects[f];
+            if (free.width() + C_EPSILON < w || free.height() + C_EPSILON < h) continue;
+
+            const qreal top = free.y() + h;
+            if (top < bestTop - C_EPSILON || (std::abs(top - bestTop) < C_EPSILON && free.x() < bestX)) {
+                bestTop = top;
+                bestX = free.x();
+                bestIndex = f;
+            }
+        }
+
+        const QRectF placed(freeRects[bestIndex].topLeft(), QSizeF(w, h));
+        positions[i] = placed.topLeft();
+
+        //каждая свободная область, задетая новым прямоугольником, распадается на до четырех остатков
+        created.clear();
+        for (int f = freeRects.size() - 1; f >= 0; --f) {
+            const QRectF free = freeRects[f];
+            if (placed.left() >= free.right() - C_EPSILON || placed.right() <= free.left() + C_EPSILON ||
+                placed.top() >= free.bottom() - C_EPSILON || placed.bottom() <= free.top() + C_EPSILON) {
+                continue;
+            }
+
+            if (placed.left() > free.left() + C_EPSILON)
+                created.append(QRectF(free.left(), free.top(), placed.left() - free.left(), free.height()));
+            if (placed.right() < free.right() - C_EPSILON)
+                created.append(QRectF(placed.right(), free.top(), free.right() - placed.right(), free.height()));
+            if (placed.top() > free.top() + C_EPSILON)
+                created.append(QRectF(free.left(), free.top(), free.width(), placed.top() - free.top()));
+            if (placed.bottom() < free.bottom() - C_EPSILON)
+                created.append(QRectF(free.left(), placed.bottom(), free.width(), free.bottom() - placed.bottom()));
+
+            freeRects.removeAt(f);
+        }
+
+        //старые области друг друга не содержат, поэтому достаточно сравнить новые со всеми
+        auto contains = [](const QRectF &outer, const QRectF &inner) {
+            return inner.left() >= outer.left() - C_EPSILON && inner.top() >= outer.top() - C_EPSILON &&
+                   inner.right() <= outer.right() + C_EPSILON && inner.bottom() <= outer.bottom() + C_EPSILON;
+        };
+        for (int c = 0; c < created.size(); ++c) {
+            bool redundant = false;
+            for (const QRectF &free : std::as_const(freeRects)) {
+                if (contains(free, created[c])) { redundant = true; break; }
+            }
+            for (int other = 0; !redundant && other < created.size(); ++other) {
+                //из двух одинаковых остается первый
+                if (other != c && contains(created[other], created[c]) && !(other > c && contains(created[c], created[other]))) {
+                    redundant = true;
+                }
+            }
+            if (redundant) continue;
+
+            freeRects.erase(std::remove_if(freeRects.begin(), freeRects.end(), [&](const QRectF &free) {
+                return contains(created[c], free);
+            }), freeRects.end());
+            freeRects.append(created[c]);
+        }
+    }
+}
+}
+
+namespace LayoutEngine {
+
+Result pack(const QVector<QSizeF> &sizes, const Options &options)
+{
+    if (sizes.isEmpty()) return Result();
+
+    //зазор добавляется к каждому прямоугольнику справа и снизу, а в конце вычитается из габаритов
+    const qreal spacing = std::max<qreal>(0, options.spacing);
+    QVector<QSizeF> padded;
+    padded.reserve(sizes.size());
+    qreal paddedArea = 0;
+    qreal itemsArea = 0;
+    qreal maxWidth = 0;
+    for (const QSizeF &size : sizes) {
+        const QSizeF paddedSize(std::max<qreal>(0, size.width()) + spacing, std::max<qreal>(0, size.height()) + spacing);
+        padded.append(paddedSize);
+        paddedArea += paddedSize.width() * paddedSize.height();
+        itemsArea += std::max<qreal>(0, size.width()) * std::max<qreal>(0, size.height());
+        maxWidth = std::max(maxWidth, paddedSize.width());
+    }
+
+    const qreal aspect = options.aspectRatio > 0 ? options.aspectRatio : 1.0;
+    const qreal binWidth = std::max(maxWidth, std::sqrt(paddedArea * aspect));
+
+    auto run = [&](Algorithm algorithm) {
+        Result packed;
+        packed.positions.resize(sizes.size());
+        switch (algorithm) {
+        case Algorithm::Shelf: packShelf(padded, binWidth, packed.positions); break;
+        case Algorithm::Skyline: packSkyline(padded, binWidth, packed.positions); break;
+        case Algorithm::MaxRects: packMaxRects(padded, binWidth, packed.positions); break;
+        }
+
+        qreal right = 0, bottom = 0;
+        for (int i = 0; i < padded.size(); ++i) {
+            right = std::max(right, packed.positions[i].x() + padded[i].width());
+            bottom = std::max(bottom, packed.positions[i].y() + padded[i].height());
+        }
+        packed.size = QSizeF(std::max<qreal>(0, right - spacing), std::max<qreal>(0, bottom - spacing));
+
+        const qreal boundsArea = packed.size.width() * packed.size.height();
+        packed.density = boundsArea > 0 ? itemsArea / boundsArea : 0;
+        return packed;
+    };
+
+    //на тысячах элементов полки по убыванию высоты бывают плотнее Skyline, поэтому считаются оба и берется лучший
+    if (options.algorithm == Algorithm::MaxRects && sizes.size() > C_MAX_RECTS_LIMIT) {
+        Result skyline = run(Algorithm::Skyline);
+        Result shelf = run(Algorithm::Shelf);
+        return shelf.density > skyline.density ? shelf : skyline;
+    }
+    return run(options.algorithm);
+}
+
+QSizeF rotatedBounds(const QSizeF &size, qreal rotation)
+{
+    const qreal rad = std::fabs(rotation) * M_PI / 180.0;
+    const qreal cosA = std::fabs(std::cos(rad));
+    const qreal sinA = std::fabs(std::sin(rad));
+    return QSizeF(size.width() * cosA + size.height() * sinA, size.width() * sinA + size.height() * cosA);
+}
+
+QRectF rotatedBoundingRect(const QRectF &rect, qreal rotation)
+{
+    const QSizeF size = rotatedBounds(rect.size(), rotation);
+    return QRectF(rect.center().x() - size.width() / 2.0, rect.center().y() - size.height() / 2.0, size.width(), size.height());
+}
+
+Algorithm algorithmFromString(const QString &name)
+{
+    if (name == "shelf") return Algorithm::Shelf;
+    if (name == "maxrects") return Algorithm::MaxRects;
+    return Algorithm::Skyline;
+}
+
+}
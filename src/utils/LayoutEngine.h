@@ -0,0 +1,42 @@
+//LayoutEngine — упаковка прямоугольников для автоматического расположения элементов: полки (старый алгоритм), Skyline и MaxRects
+
+#pragma once
+
+#include <QVector>
+#include <QSizeF>
+#include <QPointF>
+#include <QRectF>
+#include <QString>
+
+namespace LayoutEngine {
+
+enum class Algorithm {
+    Shelf, //ряды по убыванию высоты
+    Skyline, //нижний-левый по линии горизонта, быстрый и плотный
+    MaxRects //нижний-левый по максимальным свободным областям, самый плотный, но квадратичный по их числу
+};
+
+struct Options {
+    Algorithm algorithm = Algorithm::Skyline;
+    qreal spacing = 0; //зазор между элементами
+    qreal aspectRatio = 1.0; //желаемое отношение ширины раскладки к высоте
+};
+
+struct Result {
+    QVector<QPointF> positions; //левый верхний угол каждого прямоугольника, в порядке входа; раскладка начинается в (0, 0)
+    QSizeF size; //габариты всей раскладки
+    qreal density = 0; //доля площади раскладки, занятая прямоугольниками
+};
+
+//раскладывает прямоугольники без пересечений
+Result pack(const QVector<QSizeF> &sizes, const Options &options);
+
+//габариты прямоугольника после поворота на rotation градусов вокруг центра
+QSizeF rotatedBounds(const QSizeF &size, qreal rotation);
+//то же для прямоугольника на холсте: центр сохраняется
+QRectF rotatedBoundingRect(const QRectF &rect, qreal rotation);
+
+//"shelf", "skyline", "maxrects"; неизвестное имя — Skyline
+Algorithm algorithmFromString(const QString &name);
+
+}
@@ -0,0 +1,171 @@
+#include "PixelKernels.h"
+
+#include <algorithm>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PIXEL_KERNELS_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define PIXEL_KERNELS_NEON
+#include <arm_neon.h>
+#endif
+
+namespace PixelKernels {
+
+namespace {
+//точность весов интерполяции: 8 бит на ось, 16 бит после двух проходов
+constexpr int C_WEIGHT_BITS = 8;
+constexpr int C_WEIGHT_ONE = 1 << C_WEIGHT_BITS;
+
+//индекс левого (верхнего) соседа и вес правого для каждой выходной координаты
+struct Tap {
+    int index;
+    int weight;
+};
+
+std::vector<Tap> buildTaps(int srcSize, int dstSize)
+{
+    std::vector<Tap> taps(dstSize);
+    const double scale = double(srcSize) / dstSize;
+
+    for (int i = 0; i < dstSize; ++i) {
+        double pos = (i + 0.5) * scale - 0.5;
+        pos = std::clamp(pos, 0.0, double(srcSize - 1));
+
+        int index = std::min(int(pos), srcSize - 1);
+        int weight = int((pos - index) * C_WEIGHT_ONE + 0.5);
+        //правый сосед за краем — весь вес у левого
+        if (index + 1 >= srcSize) weight = 0;
+
+        taps[i] = {index, weight};
+    }
+    return taps;
+}
+
+//горизонтальный проход одной строки в 16-битный буфер (значение * 256)
+void resizeRow(const uint8_t *src, uint16_t *row, const std::vector<Tap> &taps)
+{
+    const int count = int(taps.size());
+    for (int x = 0; x < count; ++x) {
+        const Tap &tap = taps[x];
+        const int a = src[tap.index];
+        const int b = tap.weight ? src[tap.index + 1] : a;
+        row[x] = uint16_t(a * (C_WEIGHT_ONE - tap.weight) + b * tap.weight);
+    }
+}
+}
+
+void extractAlpha(const uint8_t *rgba, uint8_t *alpha, int count)
+{
+    int i = 0;
+
+#if defined(PIXEL_KERNELS_SSE2)
+    //16 пикселей за итерацию: сдвигаем альфу в младший байт и упаковываем 32 -> 16 -> 8 бит
+    for (; i + 16 <= count; i += 16) {
+        const __m128i *p = reinterpret_cast<const __m128i *>(rgba + i * 4);
+        __m128i a0 = _mm_srli_epi32(_mm_loadu_si128(p + 0), 24);
+        __m128i a1 = _mm_srli_epi32(_mm_loadu_si128(p + 1), 24);
+        __m128i a2 = _mm_srli_epi32(_mm_loadu_si128(p + 2), 24);
+        __m128i a3 = _mm_srli_epi32(_mm_loadu_si128(p + 3), 24);
+        __m128i lo = _mm_packs_epi32(a0, a1);
+        __m128i hi = _mm_packs_epi32(a2, a3);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(alpha + i), _mm_packus_epi16(lo, hi));
+    }
+#elif defined(PIXEL_KERNELS_NEON)
+    //vld4 сразу раскладывает 16 пикселей по каналам
+    for (; i + 16 <= count; i += 16) {
+        uint8x16x4_t px = vld4q_u8(rgba + i * 4);
+        vst1q_u8(alpha + i, px.val[3]);
+    }
+#endif
+
+    for (; i < count; ++i) {
+        alpha[i] = rgba[i * 4 + 3];
+    }
+}
+
+void mergeAlpha(uint8_t *rgba, const uint8_t *alpha, int count)
+{
+    int i = 0;
+
+#if defined(PIXEL_KERNELS_SSE2)
+    //16 пикселей за итерацию: расширяем альфу до 32 бит, сдвигаем в старший байт и смешиваем по маске
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i rgbMask = _mm_set1_epi32(0x00FFFFFF);
+    for (; i + 16 <= count; i += 16) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(alpha + i));
+        __m128i a16lo = _mm_unpacklo_epi8(a, zero);
+        __m128i a16hi = _mm_unpackhi_epi8(a, zero);
+        __m128i a32[4] = {
+            _mm_slli_epi32(_mm_unpacklo_epi16(a16lo, zero), 24),
+            _mm_slli_epi32(_mm_unpackhi_epi16(a16lo, zero), 24),
+            _mm_slli_epi32(_mm_unpacklo_epi16(a16hi, zero), 24),
+            _mm_slli_epi32(_mm_unpackhi_epi16(a16hi, zero), 24)
+        };
+
+        __m128i *p = reinterpret_cast<__m128i *>(rgba + i * 4);
+        for (int k = 0; k < 4; ++k) {
+            __m128i px = _mm_loadu_si128(p + k);
+            _mm_storeu_si128(p + k, _mm_or_si128(_mm_and_si128(px, rgbMask), a32[k]));
+        }
+    }
+#elif defined(PIXEL_KERNELS_NEON)
+    for (; i + 16 <= count; i += 16) {
+        uint8x16x4_t px = vld4q_u8(rgba + i * 4);
+        px.val[3] = vld1q_u8(alpha + i);
+        vst4q_u8(rgba + i * 4, px);
+    }
+#endif
+
+    for (; i < count; ++i) {
+        rgba[i * 4 + 3] = alpha[i];
+    }
+}
+
+void resizePlaneBilinear(const uint8_t *src, int srcWidth, int srcHeight, int srcStride,
+                         uint8_t *dst, int dstWidth, int dstHeight, int dstStride)
+{
+    if (srcWidth <= 0 || srcHeight <= 0 || dstWidth <= 0 || dstHeight <= 0) return;
+
+    const std::vector<Tap> xTaps = buildTaps(srcWidth, dstWidth);
+    const std::vector<Tap> yTaps = buildTaps(srcHeight, dstHeight);
+
+    //держим только две горизонтально отмасштабированные строки источника;
+    //при увеличении соседние выходные строки переиспользуют их
+    std::vector<uint16_t> rowA(dstWidth);
+    std::vector<uint16_t> rowB(dstWidth);
+    int rowAIndex = -1;
+    int rowBIndex = -1;
+
+    for (int y = 0; y < dstHeight; ++y) {
+        const Tap &tap = yTaps[y];
+        const int top = tap.index;
+        const int bottom = tap.weight ? top + 1 : top;
+
+        if (rowAIndex != top) {
+            if (rowBIndex == top) {
+                std::swap(rowA, rowB);
+                std::swap(rowAIndex, rowBIndex);
+            } else {
+                resizeRow(src + top * srcStride, rowA.data(), xTaps);
+                rowAIndex = top;
+            }
+        }
+        if (rowBIndex != bottom) {
+            resizeRow(src + bottom * srcStride, rowB.data(), xTaps);
+            rowBIndex = bottom;
+        }
+
+        uint8_t *out = dst + y * dstStride;
+        const int wTop = C_WEIGHT_ONE - tap.weight;
+        const int wBottom = tap.weight;
+        constexpr int shift = C_WEIGHT_BITS * 2;
+        constexpr int round = 1 << (shift - 1);
+        for (int x = 0; x < dstWidth; ++x) {
+            out[x] = uint8_t((rowA[x] * wTop + rowB[x] * wBottom + round) >> shift);
+        }
+    }
+}
+
+}
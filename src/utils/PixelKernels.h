@@ -0,0 +1,20 @@
+//PixelKernels — быстрые попиксельные операции над RGBA8888 для апскейла: разделение и слияние альфа-канала (SSE2/NEON с скалярным запасным вариантом) и сепарабельное билинейное масштабирование 8-битной плоскости
+
+#pragma once
+
+#include <cstdint>
+
+namespace PixelKernels {
+
+//копирует альфа-байты count пикселей RGBA8888 в плотный массив
+void extractAlpha(const uint8_t *rgba, uint8_t *alpha, int count);
+
+//записывает альфа-байты в count пикселей RGBA8888, не трогая RGB
+void mergeAlpha(uint8_t *rgba, const uint8_t *alpha, int count);
+
+//билинейное масштабирование 8-битной плоскости: сначала по горизонтали, затем по вертикали,
+//с выравниванием по центрам пикселей (как QImage::scaled с SmoothTransformation)
+void resizePlaneBilinear(const uint8_t *src, int srcWidth, int srcHeight, int srcStride,
+                         uint8_t *dst, int dstWidth, int dstHeight, int dstStride);
+
+}
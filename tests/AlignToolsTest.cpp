@@ -0,0 +1,195 @@
+//AlignToolsTest — поиск направляющих в EdgeIndex (пустой индекс, граница maxDistance, равноудаленные соседи)
+//и равные промежутки после distributeSelected для элементов разных размеров с поворотом
+
+#include <QTest>
+#include <algorithm>
+
+#include "TestRegistry.h"
+#include "EdgeIndex.h"
+#include "ImageModel.h"
+#include "StackController.h"
+#include "ToolController.h"
+
+namespace {
+constexpr qreal C_EPSILON = 1e-6;
+
+EdgeIndex makeIndex(const QVector<qreal> &values)
+{
+    EdgeIndex index;
+    for (qreal value : values) {
+        index.add(value);
+    }
+    index.build();
+    return index;
+}
+
+//разные пропорции и углы: габариты повернутых элементов отличаются от их прямоугольников.
+//Промежутки по обеим осям положительные, так что порядок элементов после распределения не меняется
+QVector<ImagoImageData> mixedItems()
+{
+    struct Geometry { qreal x, y, width, height, rotation; };
+    const QVector<Geometry> geometry = {
+        {0, 0, 100, 50, 0},
+        {300, 400, 60, 200, 90},
+        {150, 150, 80, 80, 45},
+        {700, 700, 40, 120, 30},
+        {500, 300, 200, 30, 0},
+    };
+
+    QVector<ImagoImageData> items;
+    for (int i = 0; i < geometry.size(); ++i) {
+        ImagoImageData item;
+        item.id = QString("item-%1").arg(i);
+        item.x = geometry[i].x;
+        item.y = geometry[i].y;
+        item.width = geometry[i].width;
+        item.height = geometry[i].height;
+        item.rotation = geometry[i].rotation;
+        item.selected = true;
+        items.append(item);
+    }
+    return items;
+}
+
+//габариты всех элементов по возрастанию начала вдоль оси
+QVector<QRectF> sortedBounds(const ImagoImageModel &model, bool horizontal)
+{
+    QVector<QRectF> bounds;
+    for (int i = 0; i < model.getCount(); ++i) {
+        bounds.append(model.getItemBounds(i));
+    }
+    std::sort(bounds.begin(), bounds.end(), [horizontal](const QRectF &a, const QRectF &b) {
+        return horizontal ? a.left() < b.left() : a.top() < b.top();
+    });
+    return bounds;
+}
+}
+
+class AlignToolsTest : public QObject {
+    Q_OBJECT
+
+private slots:
+    void emptyIndexFindsNothing();
+    void maxDistanceIsInclusive();
+    void tiePrefersPredecessor();
+    void findsAcrossWholeRange();
+    void distributeEqualizesGaps_data();
+    void distributeEqualizesGaps();
+    void distributeNeedsThreeItems();
+};
+
+void AlignToolsTest::emptyIndexFindsNothing()
+{
+    EdgeIndex index;
+    qreal found = 42;
+    QVERIFY(index.isEmpty());
+    QVERIFY(!index.findNearest(0, 1e9, &found));
+    QCOMPARE(found, qreal(42)); //при промахе результат не трогается
+
+    index = makeIndex({});
+    QVERIFY(!index.findNearest(0, 1e9, &found));
+}
+
+void AlignToolsTest::maxDistanceIsInclusive()
+{
+    const EdgeIndex index = makeIndex({100});
+    qreal found = 0;
+    QVERIFY(index.findNearest(106, 6, &found));
+    QCOMPARE(found, qreal(100));
+    QVERIFY(index.findNearest(94, 6, &found));
+    QVERIFY(!index.findNearest(106.001, 6, &found));
+    QVERIFY(!index.findNearest(93.999, 6, &found));
+    QVERIFY(index.findNearest(100, 0, &found)); //точное совпадение находится и при нулевом радиусе
+}
+
+void AlignToolsTest::tiePrefersPredecessor()
+{
+    //lower_bound указывает на 10, предшественник 0 на том же расстоянии — выигрывает меньшая координата
+    const EdgeIndex index = makeIndex({10, 0, 10, 20});
+    qreal found = -1;
+    QVERIFY(index.findNearest(5, 6, &found));
+    QCOMPARE(found, qreal(0));
+    QVERIFY(index.findNearest(15, 6, &found));
+    QCOMPARE(found, qreal(10));
+
+    //без ничьей выбирается действительно ближайший из двух кандидатов
+    QVERIFY(index.findNearest(14, 6, &found));
+    QCOMPARE(found, qreal(10));
+    QVERIFY(index.findNearest(16, 6, &found));
+    QCOMPARE(found, qreal(20));
+}
+
+void AlignToolsTest::findsAcrossWholeRange()
+{
+    //за краями массива кандидат только один
+    const EdgeIndex index = makeIndex({-50, 0, 50});
+    qreal found = 0;
+    QVERIFY(index.findNearest(-53, 5, &found));
+    QCOMPARE(found, qreal(-50));
+    QVERIFY(index.findNearest(52, 5, &found));
+    QCOMPARE(found, qreal(50));
+    QVERIFY(!index.findNearest(25, 5, &found));
+}
+
+void AlignToolsTest::distributeEqualizesGaps_data()
+{
+    QTest::addColumn<bool>("horizontal");
+    QTest::newRow("horizontal") << true;
+    QTest::newRow("vertical") << false;
+}
+
+void AlignToolsTest::distributeEqualizesGaps()
+{
+    QFETCH(bool, horizontal);
+    ImagoImageModel model;
+    UndoHistory history;
+    ToolController tools(&model, &history);
+    model.setAllItems(mixedItems());
+
+    const QVector<QRectF> before = sortedBounds(model, horizontal);
+    tools.distributeSelected(horizontal ? "horizontal" : "vertical");
+    const QVector<QRectF> after = sortedBounds(model, horizontal);
+    QCOMPARE(history.count(), 1);
+
+    //крайние элементы остаются на месте, промежутки между соседними габаритами равны
+    auto start = [horizontal](const QRectF &r) { return horizontal ? r.left() : r.top(); };
+    auto end = [horizontal](const QRectF &r) { return horizontal ? r.right() : r.bottom(); };
+    QVERIFY(qAbs(start(after.first()) - start(before.first())) < C_EPSILON);
+    qreal span = 0;
+    for (const QRectF &r : before) span = std::max(span, end(r));
+    QVERIFY(qAbs(end(after.last()) - span) < C_EPSILON);
+
+    const qreal gap = start(after[1]) - end(after[0]);
+    for (int i = 1; i < after.size(); ++i) {
+        const qreal current = start(after[i]) - end(after[i - 1]);
+        QVERIFY2(qAbs(current - gap) < C_EPSILON, qPrintable(QString("gap %1 is %2, expected %3").arg(i).arg(current).arg(gap)));
+    }
+
+    //по другой оси ничего не сдвинулось, размеры и углы те же
+    for (int i = 0; i < model.getCount(); ++i) {
+        const ImagoImageData original = mixedItems().at(i);
+        QCOMPARE(horizontal ? model.getItemRect(i).y() : model.getItemRect(i).x(), horizontal ? original.y : original.x);
+        QCOMPARE(model.getItemRect(i).size(), QSizeF(original.width, original.height));
+        QCOMPARE(model.getItemRotation(i), original.rotation);
+    }
+
+    history.undo();
+    for (int i = 0; i < model.getCount(); ++i) {
+        QCOMPARE(model.getItemRect(i).topLeft(), QPointF(mixedItems().at(i).x, mixedItems().at(i).y));
+    }
+}
+
+void AlignToolsTest::distributeNeedsThreeItems()
+{
+    ImagoImageModel model;
+    UndoHistory history;
+    ToolController tools(&model, &history);
+    model.setAllItems(mixedItems().mid(0, 2));
+
+    tools.distributeSelected("horizontal");
+    QCOMPARE(history.count(), 0);
+    QCOMPARE(model.getItemRect(1).topLeft(), QPointF(300, 400));
+}
+
+IMAGOREF_TEST(AlignToolsTest)
+#include "AlignToolsTest.moc"
@@ -0,0 +1,165 @@
+//ColorQuantizerTest — палитры изображений и доски: цвета и доли на картинках из однотонных блоков, пропуск прозрачных
+//пикселей, сведение палитр и время extract на фотографиях разного размера и merge палитр большой доски
+
+#include <QTest>
+#include <QPainter>
+#include <QRandomGenerator>
+
+#include "TestRegistry.h"
+#include "ColorQuantizer.h"
+
+namespace {
+constexpr int C_SIDE = 96; //равно maxSide по умолчанию, чтобы блоки не смешивались при уменьшении
+constexpr float C_WEIGHT_TOLERANCE = 0.01f;
+
+//шум поверх плавного градиента: много заполненных ячеек гистограммы, как на настоящей фотографии
+QImage photoLike(int width, int height, quint32 seed)
+{
+    QRandomGenerator random(seed);
+    QImage image(width, height, QImage::Format_ARGB32);
+    for (int y = 0; y < height; ++y) {
+        QRgb *line = reinterpret_cast<QRgb *>(image.scanLine(y));
+        for (int x = 0; x < width; ++x) {
+            const int noise = int(random.bounded(48)) - 24;
+            line[x] = qRgb(qBound(0, x * 255 / width + noise, 255), qBound(0, y * 255 / height + noise, 255),
+                           qBound(0, 128 + noise, 255));
+        }
+    }
+    return image;
+}
+
+bool sortedByWeight(const QVector<ColorQuantizer::Swatch> &swatches)
+{
+    for (int i = 1; i < swatches.size(); ++i) {
+        if (swatches[i - 1].weight < swatches[i].weight) return false;
+    }
+    return true;
+}
+}
+
+class ColorQuantizerTest : public QObject {
+    Q_OBJECT
+
+private slots:
+    void extractsBlockColors();
+    void skipsTransparentPixels();
+    void mergeReducesToColorCount();
+    void benchmarkExtract_data();
+    void benchmarkExtract();
+    void benchmarkMergeBoard_data();
+    void benchmarkMergeBoard();
+};
+
+void ColorQuantizerTest::extractsBlockColors()
+{
+    //красная верхняя половина, зеленая и синяя четверти снизу
+    QImage image(C_SIDE, C_SIDE, QImage::Format_ARGB32);
+    QPainter painter(&image);
+    painter.fillRect(0, 0, C_SIDE, C_SIDE / 2, QColor(255, 0, 0));
+    painter.fillRect(0, C_SIDE / 2, C_SIDE / 2, C_SIDE / 2, QColor(0, 255, 0));
+    painter.fillRect(C_SIDE / 2, C_SIDE / 2, C_SIDE / 2, C_SIDE / 2, QColor(0, 0, 255));
+    painter.end();
+
+    const QVector<ColorQuantizer::Swatch> swatches = ColorQuantizer::extract(image, 6);
+    QCOMPARE(swatches.size(), 3); //цветов меньше, чем запрошено: лишних центров нет
+    QVERIFY(sortedByWeight(swatches));
+
+    QCOMPARE(swatches[0].color, qRgb(255, 0, 0));
+    QVERIFY(qAbs(swatches[0].weight - 0.5f) < C_WEIGHT_TOLERANCE);
+    for (int i = 1; i < 3; ++i) {
+        QVERIFY(swatches[i].color == qRgb(0, 255, 0) || swatches[i].color == qRgb(0, 0, 255));
+        QVERIFY(qAbs(swatches[i].weight - 0.25f) < C_WEIGHT_TOLERANCE);
+    }
+    QVERIFY(swatches[1].color != swatches[2].color);
+}
+
+void ColorQuantizerTest::skipsTransparentPixels()
+{
+    QImage image(C_SIDE, C_SIDE, QImage::Format_ARGB32);
+    image.fill(Qt::transparent);
+    QPainter painter(&image);
+    painter.fillRect(0, 0, C_SIDE / 2, C_SIDE / 2, QColor(255, 255, 0));
+    painter.end();
+
+    const QVector<ColorQuantizer::Swatch> swatches = ColorQuantizer::extract(image, 6);
+    QCOMPARE(swatches.size(), 1);
+    QCOMPARE(swatches[0].color, qRgb(255, 255, 0));
+    QVERIFY(qAbs(swatches[0].weight - 1.0f) < C_WEIGHT_TOLERANCE);
+
+    image.fill(Qt::transparent);
+    QVERIFY(ColorQuantizer::extract(image, 6).isEmpty());
+    QVERIFY(ColorQuantizer::extract(QImage(), 6).isEmpty());
+}
+
+void ColorQuantizerTest::mergeReducesToColorCount()
+{
+    //две группы близких цветов: темно-синие тяжелее светло-оранжевых
+    const QVector<ColorQuantizer::Swatch> swatches = {
+        {qRgb(20, 30, 120), 0.3f}, {qRgb(24, 34, 124), 0.2f}, {qRgb(16, 26, 116), 0.1f},
+        {qRgb(250, 180, 90), 0.15f}, {qRgb(246, 176, 86), 0.15f}, {qRgb(0, 0, 0), 0.0f},
+    };
+
+    const QVector<ColorQuantizer::Swatch> merged = ColorQuantizer::merge(swatches, 2);
+    QCOMPARE(merged.size(), 2);
+    QVERIFY(sortedByWeight(merged));
+    QVERIFY(qAbs(merged[0].weight - 0.6f / 0.9f) < C_WEIGHT_TOLERANCE);
+    QVERIFY(qAbs(qBlue(merged[0].color) - 120) <= 2 && qRed(merged[0].color) < 30);
+    QVERIFY(qAbs(qRed(merged[1].color) - 248) <= 2 && qBlue(merged[1].color) < 100);
+
+    QVERIFY(ColorQuantizer::merge({}, 8).isEmpty());
+    QCOMPARE(ColorQuantizer::merge(swatches, 8).size(), 5); //нулевой вес отбрасывается
+}
+
+void ColorQuantizerTest::benchmarkExtract_data()
+{
+    QTest::addColumn<int>("width");
+    QTest::addColumn<int>("height");
+    QTest::addColumn<int>("maxSide");
+    QTest::addRow("1920x1080, maxSide 96") << 1920 << 1080 << 96;
+    QTest::addRow("4000x3000, maxSide 96") << 4000 << 3000 << 96;
+    QTest::addRow("1920x1080, maxSide 256") << 1920 << 1080 << 256;
+}
+
+void ColorQuantizerTest::benchmarkExtract()
+{
+    QFETCH(int, width);
+    QFETCH(int, height);
+    QFETCH(int, maxSide);
+    const QImage image = photoLike(width, height, 1);
+
+    QVector<ColorQuantizer::Swatch> swatches;
+    QBENCHMARK {
+        swatches = ColorQuantizer::extract(image, 6, maxSide);
+    }
+    QCOMPARE(swatches.size(), 6);
+    QVERIFY(sortedByWeight(swatches));
+}
+
+void ColorQuantizerTest::benchmarkMergeBoard_data()
+{
+    QTest::addColumn<int>("images");
+    for (int images : {100, 1000, 10000}) {
+        QTest::addRow("%d images", images) << images;
+    }
+}
+
+void ColorQuantizerTest::benchmarkMergeBoard()
+{
+    //палитра доски при rebuild: по шесть цветов с каждого изображения, веса умножены на площадь
+    QFETCH(int, images);
+    QRandomGenerator random(2);
+    QVector<ColorQuantizer::Swatch> swatches;
+    swatches.reserve(images * 6);
+    for (int i = 0; i < images * 6; ++i) {
+        swatches.append({qRgb(random.bounded(256), random.bounded(256), random.bounded(256)), float(random.bounded(1.0))});
+    }
+
+    QVector<ColorQuantizer::Swatch> merged;
+    QBENCHMARK {
+        merged = ColorQuantizer::merge(swatches, 8);
+    }
+    QCOMPARE(merged.size(), 8);
+}
+
+IMAGOREF_TEST(ColorQuantizerTest)
+#include "ColorQuantizerTest.moc"
@@ -0,0 +1,198 @@
+//ImageModelScanBench — проходы по 10k и 50k элементам: попадание курсором, габариты доски и список выделенных.
+//Сравниваются прежний путь через getItem (копия всей записи с pixmap и строками), обычный массив ImagoImageData
+//и массивы геометрии модели с битовым выделением
+
+#include <QTest>
+#include <QTransform>
+
+#include "TestRegistry.h"
+#include "ImageModel.h"
+#include "SelectionController.h"
+
+namespace {
+constexpr int C_SELECTED_EVERY = 7; //каждый седьмой элемент выделен
+
+enum class Layout { GetItemCopy, ArrayOfStructs, ModelArrays };
+
+ImagoImageData makeItem(int i, const QPixmap &pixmap)
+{
+    ImagoImageData item;
+    item.id = QString("item-%1").arg(i);
+    item.pixmap = pixmap;
+    item.x = (i % 200) * 120;
+    item.y = (i / 200) * 90;
+    item.width = 100;
+    item.height = 70;
+    item.rotation = i % 5 == 0 ? 30 : 0;
+    item.selected = i % C_SELECTED_EVERY == 0;
+    item.label = QString("label %1").arg(i);
+    item.imageHash = QString("hash-%1").arg(i, 64, 10, QChar('0'));
+    return item;
+}
+
+//прежняя проверка попадания: та же геометрия, но по записи целиком
+bool containsPoint(const ImagoImageData &item, const QPointF &point)
+{
+    const QRectF rect(item.x, item.y, item.width, item.height);
+    if (item.rotation == 0) return rect.contains(point);
+
+    QTransform transform;
+    transform.translate(rect.center().x(), rect.center().y());
+    transform.rotate(item.rotation);
+    transform.translate(-rect.center().x(), -rect.center().y());
+    return transform.map(rect).containsPoint(point, Qt::OddEvenFill);
+}
+
+void addLayoutRows()
+{
+    QTest::addColumn<int>("count");
+    QTest::addColumn<Layout>("layout");
+    for (int count : {10000, 50000}) {
+        QTest::addRow("%d items, getItem copy", count) << count << Layout::GetItemCopy;
+        QTest::addRow("%d items, ImagoImageData array", count) << count << Layout::ArrayOfStructs;
+        QTest::addRow("%d items, model arrays", count) << count << Layout::ModelArrays;
+    }
+}
+}
+
+Q_DECLARE_METATYPE(Layout)
+
+class ImageModelScanBench : public QObject {
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+
+    void hitTestMiss_data() { addLayoutRows(); }
+    void hitTestMiss();
+    void boardBounds_data() { addLayoutRows(); }
+    void boardBounds();
+    void selectedIndices_data() { addLayoutRows(); }
+    void selectedIndices();
+
+private:
+    void fill(int count);
+
+    QPixmap m_pixmap;
+    ImagoImageModel m_model;
+    QVector<ImagoImageData> m_items;
+};
+
+void ImageModelScanBench::initTestCase()
+{
+    QImage image(64, 64, QImage::Format_ARGB32);
+    image.fill(Qt::darkCyan);
+    m_pixmap = QPixmap::fromImage(image);
+}
+
+void ImageModelScanBench::fill(int count)
+{
+    if (m_items.size() == count) return;
+
+    m_items.clear();
+    m_items.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        m_items.append(makeItem(i, m_pixmap));
+    }
+    m_model.setAllItems(m_items);
+    QCOMPARE(m_model.getCount(), count);
+}
+
+void ImageModelScanBench::hitTestMiss()
+{
+    QFETCH(int, count);
+    QFETCH(Layout, layout);
+    fill(count);
+
+    //точка вне всех элементов: проход идет до конца, как при клике по пустому холсту
+    const QPointF point(-50, -50);
+    SelectionController selection(&m_model);
+    int hit = 0;
+
+    QBENCHMARK {
+        hit = -1;
+        switch (layout) {
+        case Layout::GetItemCopy:
+            for (int i = m_model.getCount() - 1; i >= 0 && hit < 0; --i) {
+                if (containsPoint(m_model.getItem(i), point)) hit = i;
+            }
+            break;
+        case Layout::ArrayOfStructs:
+            for (int i = m_items.size() - 1; i >= 0 && hit < 0; --i) {
+                if (containsPoint(m_items[i], point)) hit = i;
+            }
+            break;
+        case Layout::ModelArrays:
+            hit = selection.hitTest(point.x(), point.y());
+            break;
+        }
+    }
+    QCOMPARE(hit, -1);
+}
+
+void ImageModelScanBench::boardBounds()
+{
+    QFETCH(int, count);
+    QFETCH(Layout, layout);
+    fill(count);
+
+    QRectF bounds;
+    QBENCHMARK {
+        bounds = QRectF();
+        switch (layout) {
+        case Layout::GetItemCopy:
+            for (int i = 0; i < m_model.getCount(); ++i) {
+                const ImagoImageData item = m_model.getItem(i);
+                bounds = bounds.united(QRectF(item.x, item.y, item.width, item.height));
+            }
+            break;
+        case Layout::ArrayOfStructs:
+            for (const ImagoImageData &item : std::as_const(m_items)) {
+                bounds = bounds.united(QRectF(item.x, item.y, item.width, item.height));
+            }
+            break;
+        case Layout::ModelArrays:
+            for (int i = 0; i < m_model.getCount(); ++i) {
+                bounds = bounds.united(m_model.getItemRect(i));
+            }
+            break;
+        }
+    }
+    QCOMPARE(bounds.topLeft(), QPointF(0, 0));
+}
+
+void ImageModelScanBench::selectedIndices()
+{
+    QFETCH(int, count);
+    QFETCH(Layout, layout);
+    fill(count);
+
+    const int expected = (count + C_SELECTED_EVERY - 1) / C_SELECTED_EVERY;
+    int found = 0;
+    QBENCHMARK {
+        QVariantList indices;
+        switch (layout) {
+        case Layout::GetItemCopy:
+            for (int i = 0; i < m_model.getCount(); ++i) {
+                if (m_model.getItem(i).selected) indices.append(i);
+            }
+            break;
+        case Layout::ArrayOfStructs:
+            for (int i = 0; i < m_items.size(); ++i) {
+                if (m_items[i].selected) indices.append(i);
+            }
+            break;
+        case Layout::ModelArrays:
+            //переключение выделения сбрасывает кэш списка, так что каждый замер пересобирает его по битам
+            m_model.setSelected(1, true);
+            m_model.setSelected(1, false);
+            indices = m_model.getSelectedIndices();
+            break;
+        }
+        found = indices.size();
+    }
+    QCOMPARE(found, expected);
+}
+
+IMAGOREF_TEST(ImageModelScanBench)
+#include "ImageModelScanBench.moc"
@@ -0,0 +1,169 @@
+//LayoutEngineBench — упаковка для «Расположить»: раскладки без пересечений, плотность против прежнего полочного
+//упаковщика из arrangeAll и время на 100, 1000 и 10000 элементах со смешанными пропорциями
+
+#include <QTest>
+#include <QRandomGenerator>
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+#include "TestRegistry.h"
+#include "LayoutEngine.h"
+
+namespace {
+constexpr qreal C_SPACING = 10;
+constexpr int C_VALIDITY_COUNT = 300; //проверка пересечений квадратичная
+
+enum class Packer { Previous, Shelf, Skyline, MaxRects };
+
+//референсы с доски: альбомные, книжные, узкие панорамы и мелкие иконки вперемешку
+QVector<QSizeF> mixedSizes(int count, quint32 seed)
+{
+    QRandomGenerator random(seed);
+    QVector<QSizeF> sizes;
+    sizes.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        const qreal base = 60 + random.bounded(400);
+        switch (random.bounded(4)) {
+        case 0: sizes.append(QSizeF(base * 1.5, base)); break;
+        case 1: sizes.append(QSizeF(base, base * 1.4)); break;
+        case 2: sizes.append(QSizeF(base * 3, base * 0.6)); break;
+        default: sizes.append(QSizeF(base * 0.3, base * 0.3)); break;
+        }
+    }
+    return sizes;
+}
+
+//прежний arrangeAll: ряды по убыванию высоты шириной sqrt(площади) * 1.3, но не уже 800
+LayoutEngine::Result packPrevious(const QVector<QSizeF> &sizes, qreal spacing)
+{
+    qreal totalArea = 0;
+    qreal itemsArea = 0;
+    for (const QSizeF &size : sizes) {
+        totalArea += (size.width() + spacing) * (size.height() + spacing);
+        itemsArea += size.width() * size.height();
+    }
+    QVector<int> order(sizes.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](int a, int b) { return sizes[a].height() > sizes[b].height(); });
+
+    const qreal maxRowWidth = std::max<qreal>(800, std::sqrt(totalArea) * 1.3);
+
+    LayoutEngine::Result result;
+    result.positions.resize(sizes.size());
+    qreal x = 0, y = 0, rowHeight = 0, right = 0;
+    for (int i : order) {
+        if (x + sizes[i].width() > maxRowWidth && x > 0) {
+            x = 0;
+            y += rowHeight + spacing;
+            rowHeight = 0;
+        }
+        result.positions[i] = QPointF(x, y);
+        right = std::max(right, x + sizes[i].width());
+        x += sizes[i].width() + spacing;
+        rowHeight = std::max(rowHeight, sizes[i].height());
+    }
+    result.size = QSizeF(right, y + rowHeight);
+    result.density = itemsArea / (result.size.width() * result.size.height());
+    return result;
+}
+
+LayoutEngine::Result runPacker(Packer packer, const QVector<QSizeF> &sizes)
+{
+    if (packer == Packer::Previous) return packPrevious(sizes, C_SPACING);
+
+    LayoutEngine::Options options;
+    options.spacing = C_SPACING;
+    options.algorithm = packer == Packer::Shelf ? LayoutEngine::Algorithm::Shelf
+                      : packer == Packer::Skyline ? LayoutEngine::Algorithm::Skyline
+                                                  : LayoutEngine::Algorithm::MaxRects;
+    return LayoutEngine::pack(sizes, options);
+}
+
+void addPackerRows(const QVector<int> &counts)
+{
+    QTest::addColumn<int>("count");
+    QTest::addColumn<Packer>("packer");
+    for (int count : counts) {
+        QTest::addRow("%d items, previous arrangeAll", count) << count << Packer::Previous;
+        QTest::addRow("%d items, Shelf", count) << count << Packer::Shelf;
+        QTest::addRow("%d items, Skyline", count) << count << Packer::Skyline;
+        QTest::addRow("%d items, MaxRects", count) << count << Packer::MaxRects;
+    }
+}
+}
+
+Q_DECLARE_METATYPE(Packer)
+
+class LayoutEngineBench : public QObject {
+    Q_OBJECT
+
+private slots:
+    void layoutHasNoOverlaps_data() { addPackerRows({C_VALIDITY_COUNT}); }
+    void layoutHasNoOverlaps();
+    void denserThanPrevious_data();
+    void denserThanPrevious();
+    void benchmarkPack_data() { addPackerRows({100, 1000, 10000}); }
+    void benchmarkPack();
+};
+
+void LayoutEngineBench::layoutHasNoOverlaps()
+{
+    QFETCH(int, count);
+    QFETCH(Packer, packer);
+    const QVector<QSizeF> sizes = mixedSizes(count, 1);
+    const LayoutEngine::Result result = runPacker(packer, sizes);
+    QCOMPARE(result.positions.size(), sizes.size());
+
+    const QRectF bounds(QPointF(0, 0), result.size);
+    QVector<QRectF> rects;
+    for (int i = 0; i < sizes.size(); ++i) {
+        const QRectF rect(result.positions[i], sizes[i]);
+        QVERIFY2(bounds.adjusted(-1e-6, -1e-6, 1e-6, 1e-6).contains(rect), qPrintable(QString("item %1 outside the layout").arg(i)));
+        rects.append(rect);
+    }
+    //между соседями остается зазор: прямоугольники, расширенные на половину зазора, все еще не пересекаются
+    const qreal half = C_SPACING / 2 - 1e-6;
+    for (int i = 0; i < rects.size(); ++i) {
+        for (int j = i + 1; j < rects.size(); ++j) {
+            QVERIFY2(!rects[i].adjusted(-half, -half, half, half).intersects(rects[j].adjusted(-half, -half, half, half)),
+                     qPrintable(QString("items %1 and %2 overlap").arg(i).arg(j)));
+        }
+    }
+}
+
+void LayoutEngineBench::denserThanPrevious_data()
+{
+    QTest::addColumn<int>("count");
+    QTest::newRow("100 items") << 100;
+    QTest::newRow("1000 items") << 1000;
+}
+
+void LayoutEngineBench::denserThanPrevious()
+{
+    QFETCH(int, count);
+    const QVector<QSizeF> sizes = mixedSizes(count, 2);
+    const qreal previous = runPacker(Packer::Previous, sizes).density;
+    const qreal skyline = runPacker(Packer::Skyline, sizes).density;
+    const qreal maxRects = runPacker(Packer::MaxRects, sizes).density;
+    qInfo("%d items: density previous %.3f, Skyline %.3f, MaxRects %.3f", count, previous, skyline, maxRects);
+    //MaxRects — алгоритм по умолчанию. Skyline быстрее, но на сотнях элементов бывает и реже полок, поэтому только в отчете
+    QVERIFY2(maxRects > previous, qPrintable(QString("MaxRects %1, previous %2").arg(maxRects).arg(previous)));
+}
+
+void LayoutEngineBench::benchmarkPack()
+{
+    QFETCH(int, count);
+    QFETCH(Packer, packer);
+    const QVector<QSizeF> sizes = mixedSizes(count, 3);
+
+    LayoutEngine::Result result;
+    QBENCHMARK {
+        result = runPacker(packer, sizes);
+    }
+    qInfo("Density %.3f, layout %.0f x %.0f (aspect %.2f)", result.density, result.size.width(), result.size.height(),
+          result.size.width() / result.size.height());
+}
+
+IMAGOREF_TEST(LayoutEngineBench)
+#include "LayoutEngineBench.moc"
@@ -0,0 +1,204 @@
+//LiveSyncTest — бинарные сообщения WebSocket через локальный сервер: дельты доски и живые перемещения проходят
+//туда и обратно, серия дельт схлопывается в одно обновление, а дельта без элементов все равно сдвигает курсор
+
+#include <QTest>
+#include <QSignalSpy>
+#include <QWebSocketServer>
+#include <QWebSocket>
+#include <QHostAddress>
+#include <QUuid>
+#include <memory>
+
+#include "TestRegistry.h"
+#include "MockHttpServer.h"
+#include "BoardController.h"
+#include "StorageController.h"
+#include "NetworkController.h"
+#include "SyncProtocol.h"
+
+namespace {
+constexpr qint64 C_START_VERSION = 10;
+constexpr int C_BURST_SIZE = 5;
+constexpr int C_TIMEOUT_MS = 5000;
+constexpr int C_SETTLE_MS = 200; //заметно дольше окна склейки дельт
+
+QJsonObject remoteItem(const QString &boardId, int x, qint64 version)
+{
+    QJsonObject item;
+    item["id"] = "remote-item";
+    item["board_id"] = boardId;
+    item["type"] = "image";
+    item["x"] = x;
+    item["y"] = 0;
+    item["width"] = 100;
+    item["height"] = 50;
+    item["z_index"] = 0;
+    item["version"] = version;
+    item["payload"] = QJsonObject{{"rotation", 0}, {"label", "Remote"}, {"opacity", 1}};
+    return item;
+}
+}
+
+class LiveSyncTest : public QObject {
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void init();
+    void cleanup();
+
+    void liveTransformRoundTrip();
+    void deltaBurstIsCoalesced();
+    void versionOnlyDeltaAdvancesCursor();
+
+private:
+    void sendDelta(qint64 baseVersion, qint64 version, const QJsonArray &items);
+
+    MockHttpServer m_http;
+    QWebSocketServer m_wsServer{"ImagoRefTests", QWebSocketServer::NonSecureMode};
+    QWebSocket *m_peer = nullptr; //серверная сторона соединения клиента
+    std::unique_ptr<BoardController> m_board;
+    QString m_boardId;
+};
+
+void LiveSyncTest::initTestCase()
+{
+    QVERIFY(m_http.listen());
+    QVERIFY(m_wsServer.listen(QHostAddress::LocalHost, 0));
+
+    //снимок /metadata здесь не нужен: ошибка просто пропускается, изменения приходят только через сокет
+    m_http.setHandler([](const MockHttpServer::Request &) { return MockHttpServer::status(500); });
+
+    qputenv("IMAGOREF_API_URL", m_http.url("/api").toEncoded());
+    qputenv("IMAGOREF_WS_URL", QByteArray("ws://127.0.0.1:") + QByteArray::number(m_wsServer.serverPort()) + "/ws");
+
+    StorageController::initDatabase();
+}
+
+void LiveSyncTest::init()
+{
+    m_boardId = QUuid::createUuid().toString(QUuid::WithoutBraces);
+    StorageController::createLocalBoard(m_boardId, "Live sync test");
+
+    m_board = std::make_unique<BoardController>();
+    m_board->getStorageController()->setBoardServerVersion(m_boardId, C_START_VERSION);
+
+    QSignalSpy connected(&m_wsServer, &QWebSocketServer::newConnection);
+    m_board->openCloudBoard(m_boardId);
+    QVERIFY(connected.wait(C_TIMEOUT_MS));
+    m_peer = m_wsServer.nextPendingConnection();
+    QVERIFY(m_peer);
+}
+
+void LiveSyncTest::cleanup()
+{
+    m_board->getNetworkController()->disconnectFromBoard();
+    m_board->getModel()->clear();
+    m_board.reset();
+    StorageController::deleteLocalBoard(m_boardId);
+
+    delete m_peer;
+    m_peer = nullptr;
+}
+
+void LiveSyncTest::sendDelta(qint64 baseVersion, qint64 version, const QJsonArray &items)
+{
+    SyncProtocol::BoardDeltaMessage delta;
+    delta.boardId = m_boardId;
+    delta.baseVersion = baseVersion;
+    delta.version = version;
+    delta.items = items;
+    m_peer->sendBinaryMessage(SyncProtocol::encodeBoardDelta(delta));
+}
+
+void LiveSyncTest::liveTransformRoundTrip()
+{
+    NetworkController *network = m_board->getNetworkController();
+    QSignalSpy received(network, &NetworkController::liveTransformsReceived);
+
+    //эхо-сервер: все, что прислал клиент, возвращается ему же
+    QVector<QByteArray> serverFrames;
+    connect(m_peer, &QWebSocket::binaryMessageReceived, this, [this, &serverFrames](const QByteArray &message) {
+        serverFrames.append(message);
+        m_peer->sendBinaryMessage(message);
+    });
+
+    QVector<SyncProtocol::LiveTransformFrame> frames;
+    for (int i = 0; i < 3; ++i) {
+        SyncProtocol::LiveTransformFrame frame;
+        frame.itemId = QString("item-%1").arg(i);
+        frame.rect = QRectF(10.5 * i, 20.25 * i, 100 + i, 50 + i);
+        frame.rotation = 15 * i;
+        frames.append(frame);
+    }
+
+    //сначала сервер -> клиент: заодно дожидаемся, пока рукопожатие завершится и на стороне клиента
+    m_peer->sendBinaryMessage(SyncProtocol::encodeLiveTransform(m_boardId, frames));
+    QVERIFY(received.wait(C_TIMEOUT_MS));
+
+    //затем клиент -> сервер -> клиент
+    network->sendLiveTransforms(frames);
+    QTRY_COMPARE_WITH_TIMEOUT(received.size(), 2, C_TIMEOUT_MS);
+    QCOMPARE(serverFrames.size(), 1);
+
+    QString boardId;
+    QVector<SyncProtocol::LiveTransformFrame> decoded;
+    QVERIFY(SyncProtocol::decodeLiveTransform(serverFrames.first(), boardId, decoded));
+    QCOMPARE(boardId, m_boardId);
+    QCOMPARE(decoded.size(), frames.size());
+
+    for (const QList<QVariant> &args : std::as_const(received)) {
+        const auto echoed = args.first().value<QVector<SyncProtocol::LiveTransformFrame>>();
+        QCOMPARE(echoed.size(), frames.size());
+        for (int i = 0; i < frames.size(); ++i) {
+            QCOMPARE(echoed[i].itemId, frames[i].itemId);
+            QCOMPARE(echoed[i].rect, frames[i].rect);
+            QCOMPARE(echoed[i].rotation, frames[i].rotation);
+        }
+    }
+    qInfo("LiveTransform frame: %lld bytes for %d items", qint64(serverFrames.first().size()), int(frames.size()));
+}
+
+void LiveSyncTest::deltaBurstIsCoalesced()
+{
+    NetworkController *network = m_board->getNetworkController();
+    QSignalSpy applied(network, &NetworkController::remoteChangesApplied);
+
+    //соавтор тащит элемент: пять дельт подряд, каждая на следующей версии
+    for (int i = 1; i <= C_BURST_SIZE; ++i) {
+        const qint64 version = C_START_VERSION + i;
+        sendDelta(version - 1, version, QJsonArray{remoteItem(m_boardId, i * 10, version)});
+    }
+
+    QVERIFY(applied.wait(C_TIMEOUT_MS));
+    QTest::qWait(C_SETTLE_MS);
+
+    //вся серия пришла в одном окне склейки и применилась одним обновлением с итоговым состоянием
+    QCOMPARE(applied.size(), 1);
+    QCOMPARE(applied.first().first().toStringList(), QStringList{"remote-item"});
+    QCOMPARE(m_board->getStorageController()->getBoardServerVersion(m_boardId), C_START_VERSION + C_BURST_SIZE);
+
+    const int index = m_board->getModel()->getIndexById("remote-item");
+    QVERIFY(index >= 0);
+    QCOMPARE(m_board->getModel()->getItem(index).x, qreal(C_BURST_SIZE * 10));
+}
+
+void LiveSyncTest::versionOnlyDeltaAdvancesCursor()
+{
+    NetworkController *network = m_board->getNetworkController();
+    QSignalSpy applied(network, &NetworkController::remoteChangesApplied);
+
+    sendDelta(C_START_VERSION, C_START_VERSION + 1, QJsonArray());
+    QTRY_COMPARE_WITH_TIMEOUT(m_board->getStorageController()->getBoardServerVersion(m_boardId), C_START_VERSION + 1, C_TIMEOUT_MS);
+    QVERIFY(applied.isEmpty());
+
+    //следующая дельта опирается на новый курсор и применяется без повторного запроса /metadata
+    m_http.clearRequests();
+    sendDelta(C_START_VERSION + 1, C_START_VERSION + 2, QJsonArray{remoteItem(m_boardId, 42, C_START_VERSION + 2)});
+    QVERIFY(applied.wait(C_TIMEOUT_MS));
+    QCOMPARE(m_board->getStorageController()->getBoardServerVersion(m_boardId), C_START_VERSION + 2);
+    QVERIFY(m_http.requests().isEmpty());
+}
+
+IMAGOREF_TEST(LiveSyncTest)
+#include "LiveSyncTest.moc"
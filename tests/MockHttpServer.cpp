@@ -0,0 +1,175 @@
+#include "MockHttpServer.h"
+
+#include <QTcpSocket>
+#include <QHostAddress>
+#include <QPointer>
+#include <QTimer>
+
+namespace {
+QByteArray reasonPhrase(int status)
+{
+    switch (status) {
+    case 200: return "OK";
+    case 206: return "Partial Content";
+    case 404: return "Not Found";
+    case 416: return "Range Not Satisfiable";
+    case 500: return "Internal Server Error";
+    case 503: return "Service Unavailable";
+    default: return "Status";
+    }
+}
+}
+
+MockHttpServer::MockHttpServer(QObject *parent) : QObject(parent)
+{
+    connect(&m_server, &QTcpServer::newConnection, this, &MockHttpServer::onNewConnection);
+}
+
+bool MockHttpServer::listen()
+{
+    return m_server.listen(QHostAddress::LocalHost, 0);
+}
+
+QUrl MockHttpServer::url(const QString &path) const
+{
+    return QUrl(QString("http://127.0.0.1:%1%2").arg(m_server.serverPort()).arg(path));
+}
+
+void MockHttpServer::setHandler(const Handler &handler)
+{
+    m_handler = handler;
+}
+
+const QVector<MockHttpServer::Request>& MockHttpServer::requests() const
+{
+    return m_requests;
+}
+
+void MockHttpServer::clearRequests()
+{
+    m_requests.clear();
+    m_bytesReceived = 0;
+    m_bytesSent = 0;
+    m_maxPending = m_pending;
+}
+
+qint64 MockHttpServer::bytesReceived() const { return m_bytesReceived; }
+qint64 MockHttpServer::bytesSent() const { return m_bytesSent; }
+int MockHttpServer::maxConcurrentRequests() const { return m_maxPending; }
+
+MockHttpServer::Response MockHttpServer::json(const QByteArray &body, int status)
+{
+    Response response;
+    response.status = status;
+    response.body = body;
+    response.headers.append({"Content-Type", "application/json"});
+    return response;
+}
+
+MockHttpServer::Response MockHttpServer::status(int code)
+{
+    Response response;
+    response.status = code;
+    return response;
+}
+
+MockHttpServer::Response MockHttpServer::file(const Request &request, const QByteArray &content)
+{
+    Response response;
+    const QByteArray range = request.headers.value("range");
+    if (!range.startsWith("bytes=")) {
+        response.body = content;
+        return response;
+    }
+
+    const qint64 start = range.mid(6, range.indexOf('-') - 6).toLongLong();
+    if (start >= content.size()) return status(416);
+
+    response.status = 206;
+    response.body = content.mid(start);
+    response.headers.append({"Content-Range", "bytes " + QByteArray::number(start) + "-" +
+                             QByteArray::number(content.size() - 1) + "/" + QByteArray::number(content.size())});
+    return response;
+}
+
+void MockHttpServer::onNewConnection()
+{
+    while (QTcpSocket *socket = m_server.nextPendingConnection()) {
+        connect(socket, &QTcpSocket::readyRead, this, [this, socket]() {
+            m_buffers[socket] += socket->readAll();
+            processBuffer(socket);
+        });
+        connect(socket, &QTcpSocket::disconnected, this, [this, socket]() {
+            m_buffers.remove(socket);
+            socket->deleteLater();
+        });
+    }
+}
+
+void MockHttpServer::processBuffer(QTcpSocket *socket)
+{
+    QByteArray &buffer = m_buffers[socket];
+
+    //запросов в буфере может быть несколько (keep-alive), разбираем по одному
+    while (true) {
+        const int headerEnd = buffer.indexOf("\r\n\r\n");
+        if (headerEnd < 0) return;
+
+        const QList<QByteArray> lines = buffer.left(headerEnd).split('\n');
+        const QList<QByteArray> requestLine = lines.first().trimmed().split(' ');
+        if (requestLine.size() < 2) {
+            socket->abort();
+            return;
+        }
+
+        Request request;
+        request.method = requestLine.at(0);
+        request.path = requestLine.at(1);
+        for (int i = 1; i < lines.size(); ++i) {
+            const int colon = lines.at(i).indexOf(':');
+            if (colon <= 0) continue;
+            request.headers.insert(lines.at(i).left(colon).trimmed().toLower(), lines.at(i).mid(colon + 1).trimmed());
+        }
+
+        const qint64 contentLength = request.headers.value("content-length", "0").toLongLong();
+        const qint64 bodyStart = headerEnd + 4;
+        if (buffer.size() < bodyStart + contentLength) return; //тело еще не пришло целиком
+
+        request.body = buffer.mid(bodyStart, contentLength);
+        buffer.remove(0, bodyStart + contentLength);
+
+        m_requests.append(request);
+        m_bytesReceived += request.body.size();
+        m_maxPending = qMax(m_maxPending, ++m_pending);
+
+        const Response response = m_handler ? m_handler(request) : status(404);
+        if (response.delayMs > 0) {
+            QTimer::singleShot(response.delayMs, this, [this, socket = QPointer<QTcpSocket>(socket), response]() {
+                m_pending--;
+                if (socket) respond(socket, response);
+            });
+            return;
+        }
+        m_pending--;
+        respond(socket, response);
+        if (socket->state() != QAbstractSocket::ConnectedState) return;
+    }
+}
+
+void MockHttpServer::respond(QTcpSocket *socket, const Response &response)
+{
+    QByteArray head = "HTTP/1.1 " + QByteArray::number(response.status) + ' ' + reasonPhrase(response.status) + "\r\n";
+    for (const auto &header : response.headers) {
+        head += header.first + ": " + header.second + "\r\n";
+    }
+    head += "Content-Length: " + QByteArray::number(response.body.size()) + "\r\n";
+    head += "Connection: close\r\n\r\n";
+
+    const QByteArray body = response.dropAfter >= 0 ? response.body.left(response.dropAfter) : response.body;
+    socket->write(head);
+    socket->write(body);
+    m_bytesSent += body.size();
+
+    //после ответа соединение закрывается; при dropAfter клиент увидит обрыв посреди тела
+    socket->disconnectFromHost();
+}
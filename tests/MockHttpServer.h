@@ -0,0 +1,71 @@
+//MockHttpServer — локальный HTTP/1.1 сервер для тестов сетевого кода. Слушает 127.0.0.1 на свободном порту,
+//каждый запрос отдает обработчику теста и запоминает. Тела запросов ожидаются с Content-Length (так их отправляет QNetworkAccessManager)
+
+#pragma once
+
+#include <QObject>
+#include <QTcpServer>
+#include <QHash>
+#include <QList>
+#include <QPair>
+#include <QUrl>
+#include <QVector>
+#include <functional>
+
+class QTcpSocket;
+
+class MockHttpServer : public QObject {
+    Q_OBJECT
+
+public:
+    struct Request {
+        QByteArray method;
+        QByteArray path; //путь вместе со строкой запроса
+        QHash<QByteArray, QByteArray> headers; //имена в нижнем регистре
+        QByteArray body;
+    };
+
+    struct Response {
+        int status = 200;
+        QByteArray body;
+        QList<QPair<QByteArray, QByteArray>> headers;
+        qint64 dropAfter = -1; //оборвать соединение после стольких байт тела, заявив полный Content-Length
+        int delayMs = 0; //задержка ответа, чтобы запросы успели накопиться
+    };
+
+    using Handler = std::function<Response(const Request &request)>;
+
+    explicit MockHttpServer(QObject *parent = nullptr);
+
+    bool listen();
+    QUrl url(const QString &path = QString()) const;
+
+    void setHandler(const Handler &handler);
+    const QVector<Request>& requests() const;
+    void clearRequests();
+
+    //сумма тел запросов и ответов — объем полезных данных, прошедших через сервер
+    qint64 bytesReceived() const;
+    qint64 bytesSent() const;
+    //наибольшее число запросов, одновременно ожидавших ответа
+    int maxConcurrentRequests() const;
+
+    static Response json(const QByteArray &body, int status = 200);
+    static Response status(int code);
+    //файл целиком или с места из "Range: bytes=N-" (206), 416 — если N за концом файла
+    static Response file(const Request &request, const QByteArray &content);
+
+private:
+    void onNewConnection();
+    void processBuffer(QTcpSocket *socket);
+    void respond(QTcpSocket *socket, const Response &response);
+
+    QTcpServer m_server;
+    Handler m_handler;
+    QHash<QTcpSocket*, QByteArray> m_buffers;
+    QVector<Request> m_requests;
+    qint64 m_bytesReceived = 0;
+    qint64 m_bytesSent = 0;
+    int m_pending = 0;
+    int m_maxPending = 0;
+};
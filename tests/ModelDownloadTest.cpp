@@ -0,0 +1,243 @@
+//ModelDownloadTest — скачивание моделей апскейла с локального сервера: докачка через Range после обрыва,
+//сервер без поддержки Range, 416 на устаревший кусок, несовпадение SHA-256 и модели без контрольных сумм
+
+#include <QTest>
+#include <QSignalSpy>
+#include <QCryptographicHash>
+#include <QJsonDocument>
+#include <QJsonArray>
+#include <QFile>
+#include <QRegularExpression>
+
+#include "TestRegistry.h"
+#include "MockHttpServer.h"
+#include "ModelsManager.h"
+
+namespace {
+constexpr int C_BIN_SIZE = 300 * 1024;
+constexpr qint64 C_DROP_AT = 100 * 1024;
+constexpr int C_TIMEOUT_MS = 20000; //повтор загрузки идет через 2 с, после 416 — еще один
+const QString C_MODEL = "test-model";
+const QString C_UNHASHED_MODEL = "unhashed-model";
+
+QByteArray makeContent(int size, int seed)
+{
+    QByteArray content(size, Qt::Uninitialized);
+    for (int i = 0; i < size; ++i) {
+        content[i] = char((i * 13 + seed + i / 97) & 0xFF);
+    }
+    return content;
+}
+
+QString sha256(const QByteArray &data)
+{
+    return QString(QCryptographicHash::hash(data, QCryptographicHash::Sha256).toHex());
+}
+
+QByteArray readFile(const QString &path)
+{
+    QFile file(path);
+    return file.open(QIODevice::ReadOnly) ? file.readAll() : QByteArray();
+}
+
+bool writeFile(const QString &path, const QByteArray &data)
+{
+    QFile file(path);
+    return file.open(QIODevice::WriteOnly) && file.write(data) == data.size();
+}
+}
+
+class ModelDownloadTest : public QObject {
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void init();
+    void cleanup();
+
+    void downloadsAndVerifies();
+    void resumesAfterDroppedConnection();
+    void restartsWhenServerIgnoresRange();
+    void restartsAfter416();
+    void rejectsChecksumMismatch();
+    void marksUnhashedModelUnverified();
+
+private:
+    MockHttpServer::Response handle(const MockHttpServer::Request &request);
+    bool download(const QString &modelId, QString *error = nullptr);
+    QVariantMap modelEntry(const QString &modelId) const;
+    QList<MockHttpServer::Request> binRequests() const;
+
+    MockHttpServer m_server;
+    QByteArray m_manifest;
+    QByteArray m_param;
+    QByteArray m_bin;
+    QByteArray m_servedBin; //что сервер отдает вместо .bin; отличается от m_bin в тесте контрольной суммы
+    std::function<void(MockHttpServer::Response &)> m_tweakBin;
+};
+
+void ModelDownloadTest::initTestCase()
+{
+    QVERIFY(m_server.listen());
+    m_param = makeContent(512, 7); //содержимое не загружается в ncnn, важна только контрольная сумма
+    m_bin = makeContent(C_BIN_SIZE, 1);
+
+    QJsonObject model;
+    model["id"] = C_MODEL;
+    model["param"] = "test-model.param";
+    model["bin"] = "test-model.bin";
+    model["size"] = C_BIN_SIZE;
+    model["sha256"] = QJsonObject{{"test-model.param", sha256(m_param)}, {"test-model.bin", sha256(m_bin)}};
+
+    QJsonObject unhashed;
+    unhashed["id"] = C_UNHASHED_MODEL;
+    unhashed["param"] = "unhashed-model.param";
+    unhashed["bin"] = "unhashed-model.bin";
+
+    m_manifest = QJsonDocument(QJsonObject{{"models", QJsonArray{model, unhashed}}}).toJson(QJsonDocument::Compact);
+    m_server.setHandler([this](const MockHttpServer::Request &request) { return handle(request); });
+
+    ModelsManager &models = ModelsManager::instance();
+    models.setBaseUrl(m_server.url("/models/").toString());
+    QTRY_VERIFY_WITH_TIMEOUT(models.getModel(C_MODEL).isValid(), C_TIMEOUT_MS);
+}
+
+void ModelDownloadTest::init()
+{
+    m_servedBin = m_bin;
+    m_tweakBin = nullptr;
+    m_server.clearRequests();
+}
+
+void ModelDownloadTest::cleanup()
+{
+    ModelsManager &models = ModelsManager::instance();
+    models.deleteModel(C_MODEL);
+    models.deleteModel(C_UNHASHED_MODEL);
+    for (const QString &file : {"test-model.param", "test-model.bin", "unhashed-model.param", "unhashed-model.bin"}) {
+        QFile::remove(models.getModelFilePath(file + ".part"));
+    }
+}
+
+MockHttpServer::Response ModelDownloadTest::handle(const MockHttpServer::Request &request)
+{
+    const QByteArray name = request.path.mid(request.path.lastIndexOf('/') + 1);
+    if (name == "manifest.json") return MockHttpServer::json(m_manifest);
+    if (name.endsWith(".param")) return MockHttpServer::file(request, m_param);
+    if (name.endsWith(".bin")) {
+        MockHttpServer::Response response = MockHttpServer::file(request, m_servedBin);
+        if (m_tweakBin) m_tweakBin(response);
+        return response;
+    }
+    return MockHttpServer::status(404);
+}
+
+bool ModelDownloadTest::download(const QString &modelId, QString *error)
+{
+    QSignalSpy finished(&ModelsManager::instance(), &ModelsManager::downloadFinished);
+    ModelsManager::instance().downloadModel(modelId);
+    if (!finished.wait(C_TIMEOUT_MS)) return false;
+    if (error) *error = finished.first().at(1).toString();
+    return finished.first().first().toBool();
+}
+
+QVariantMap ModelDownloadTest::modelEntry(const QString &modelId) const
+{
+    for (const QVariant &entry : ModelsManager::instance().getModelsForQml()) {
+        if (entry.toMap().value("id").toString() == modelId) return entry.toMap();
+    }
+    return QVariantMap();
+}
+
+QList<MockHttpServer::Request> ModelDownloadTest::binRequests() const
+{
+    QList<MockHttpServer::Request> result;
+    for (const MockHttpServer::Request &request : m_server.requests()) {
+        if (request.path.endsWith("test-model.bin")) result.append(request);
+    }
+    return result;
+}
+
+void ModelDownloadTest::downloadsAndVerifies()
+{
+    QVERIFY(download(C_MODEL));
+
+    ModelsManager &models = ModelsManager::instance();
+    QCOMPARE(readFile(models.getModelFilePath("test-model.bin")), m_bin);
+    QCOMPARE(readFile(models.getModelFilePath("test-model.param")), m_param);
+    QVERIFY(!QFile::exists(models.getModelFilePath("test-model.bin.part")));
+    QCOMPARE(modelEntry(C_MODEL).value("downloaded").toBool(), true);
+    QCOMPARE(modelEntry(C_MODEL).value("verified").toBool(), true);
+}
+
+void ModelDownloadTest::resumesAfterDroppedConnection()
+{
+    //первый ответ обрывается посреди тела, при этом статус 200 уже получен
+    m_tweakBin = [this](MockHttpServer::Response &response) {
+        if (binRequests().size() == 1) response.dropAfter = C_DROP_AT;
+    };
+    QVERIFY(download(C_MODEL));
+
+    const QList<MockHttpServer::Request> requests = binRequests();
+    QCOMPARE(requests.size(), 2);
+    QCOMPARE(requests.at(1).headers.value("range"), "bytes=" + QByteArray::number(C_DROP_AT) + "-");
+    QCOMPARE(readFile(ModelsManager::instance().getModelFilePath("test-model.bin")), m_bin);
+}
+
+void ModelDownloadTest::restartsWhenServerIgnoresRange()
+{
+    //кусок от прошлой загрузки, но сервер Range не поддерживает и отдает 200 с начала
+    QVERIFY(writeFile(ModelsManager::instance().getModelFilePath("test-model.bin.part"), m_bin.left(C_DROP_AT)));
+    m_tweakBin = [this](MockHttpServer::Response &response) {
+        response.status = 200;
+        response.body = m_servedBin;
+        response.headers.clear();
+    };
+    QVERIFY(download(C_MODEL));
+
+    QCOMPARE(binRequests().size(), 1);
+    QVERIFY(binRequests().first().headers.contains("range"));
+    QCOMPARE(readFile(ModelsManager::instance().getModelFilePath("test-model.bin")), m_bin);
+}
+
+void ModelDownloadTest::restartsAfter416()
+{
+    //кусок длиннее файла на сервере: его выбрасываем и качаем заново
+    QVERIFY(writeFile(ModelsManager::instance().getModelFilePath("test-model.bin.part"), makeContent(C_BIN_SIZE + 10, 2)));
+    QVERIFY(download(C_MODEL));
+
+    const QList<MockHttpServer::Request> requests = binRequests();
+    QCOMPARE(requests.size(), 2);
+    QVERIFY(requests.at(0).headers.contains("range"));
+    QVERIFY(!requests.at(1).headers.contains("range"));
+    QCOMPARE(readFile(ModelsManager::instance().getModelFilePath("test-model.bin")), m_bin);
+}
+
+void ModelDownloadTest::rejectsChecksumMismatch()
+{
+    m_servedBin = makeContent(C_BIN_SIZE, 3);
+
+    QString error;
+    QVERIFY(!download(C_MODEL, &error));
+    QVERIFY2(error.contains("Checksum"), qPrintable(error));
+
+    //битый файл не встает на место и не остается для докачки
+    ModelsManager &models = ModelsManager::instance();
+    QVERIFY(!QFile::exists(models.getModelFilePath("test-model.bin")));
+    QVERIFY(!QFile::exists(models.getModelFilePath("test-model.bin.part")));
+    QCOMPARE(modelEntry(C_MODEL).value("downloaded").toBool(), false);
+}
+
+void ModelDownloadTest::marksUnhashedModelUnverified()
+{
+    QTest::ignoreMessage(QtWarningMsg, QRegularExpression("No checksum in the manifest for \"unhashed-model.*"));
+    QTest::ignoreMessage(QtWarningMsg, QRegularExpression("No checksum in the manifest for \"unhashed-model.*"));
+    QVERIFY(download(C_UNHASHED_MODEL));
+
+    QCOMPARE(modelEntry(C_UNHASHED_MODEL).value("downloaded").toBool(), true);
+    QCOMPARE(modelEntry(C_UNHASHED_MODEL).value("verified").toBool(), false);
+    QVERIFY(!ModelsManager::isVerified(ModelsManager::instance().getModel(C_UNHASHED_MODEL)));
+}
+
+IMAGOREF_TEST(ModelDownloadTest)
+#include "ModelDownloadTest.moc"
@@ -0,0 +1,265 @@
+//PixelKernelsTest — векторные ядра альфа-канала и билинейное масштабирование против простых скалярных версий,
+//плюс замеры против прежних попиксельных циклов и QImage::scaled
+
+#include <QTest>
+#include <QImage>
+#include <QRandomGenerator>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "TestRegistry.h"
+#include "PixelKernels.h"
+
+namespace {
+constexpr int C_MAX_LENGTH = 69; //несколько полных блоков по 16 пикселей и все варианты хвоста
+constexpr uint8_t C_GUARD = 0xA5; //байты за концом буфера, которые ядра не должны трогать
+constexpr int C_BENCH_SIDE = 1024;
+constexpr int C_BENCH_SCALE = 4; //как у моделей апскейла
+
+std::vector<uint8_t> randomBytes(int count, quint32 seed)
+{
+    QRandomGenerator random(seed);
+    std::vector<uint8_t> bytes(count);
+    for (uint8_t &byte : bytes) byte = uint8_t(random.bounded(256));
+    return bytes;
+}
+
+//прежние циклы из апскейла, по байту за шаг
+void extractAlphaScalar(const uint8_t *rgba, uint8_t *alpha, int count)
+{
+    for (int i = 0; i < count; ++i) alpha[i] = rgba[i * 4 + 3];
+}
+
+void mergeAlphaScalar(uint8_t *rgba, const uint8_t *alpha, int count)
+{
+    for (int i = 0; i < count; ++i) rgba[i * 4 + 3] = alpha[i];
+}
+
+//эталон билинейного масштабирования в double с той же выборкой по центрам пикселей
+double samplePosition(int i, int srcSize, int dstSize)
+{
+    const double pos = (i + 0.5) * srcSize / dstSize - 0.5;
+    return std::clamp(pos, 0.0, double(srcSize - 1));
+}
+
+std::vector<uint8_t> resizeReference(const std::vector<uint8_t> &src, int srcWidth, int srcHeight, int dstWidth, int dstHeight)
+{
+    std::vector<uint8_t> dst(size_t(dstWidth) * dstHeight);
+    for (int y = 0; y < dstHeight; ++y) {
+        const double py = samplePosition(y, srcHeight, dstHeight);
+        const int y0 = int(py);
+        const int y1 = std::min(y0 + 1, srcHeight - 1);
+        const double fy = py - y0;
+        for (int x = 0; x < dstWidth; ++x) {
+            const double px = samplePosition(x, srcWidth, dstWidth);
+            const int x0 = int(px);
+            const int x1 = std::min(x0 + 1, srcWidth - 1);
+            const double fx = px - x0;
+
+            auto at = [&](int sx, int sy) { return double(src[size_t(sy) * srcWidth + sx]); };
+            const double top = at(x0, y0) * (1 - fx) + at(x1, y0) * fx;
+            const double bottom = at(x0, y1) * (1 - fx) + at(x1, y1) * fx;
+            dst[size_t(y) * dstWidth + x] = uint8_t(std::lround(top * (1 - fy) + bottom * fy));
+        }
+    }
+    return dst;
+}
+
+QImage randomPlane(int width, int height, quint32 seed)
+{
+    QImage image(width, height, QImage::Format_Grayscale8);
+    QRandomGenerator random(seed);
+    for (int y = 0; y < height; ++y) {
+        uchar *line = image.scanLine(y);
+        for (int x = 0; x < width; ++x) line[x] = uchar(random.bounded(256));
+    }
+    return image;
+}
+}
+
+class PixelKernelsTest : public QObject {
+    Q_OBJECT
+
+private slots:
+    void extractAlphaMatchesScalar();
+    void mergeAlphaMatchesScalar();
+    void resizeMatchesReference_data();
+    void resizeMatchesReference();
+    void resizeIdentityIsExact();
+
+    void benchmarkExtractAlpha_data();
+    void benchmarkExtractAlpha();
+    void benchmarkMergeAlpha_data();
+    void benchmarkMergeAlpha();
+    void benchmarkResize_data();
+    void benchmarkResize();
+};
+
+void PixelKernelsTest::extractAlphaMatchesScalar()
+{
+    const std::vector<uint8_t> rgba = randomBytes(C_MAX_LENGTH * 4, 1);
+
+    for (int length = 0; length <= C_MAX_LENGTH; ++length) {
+        std::vector<uint8_t> expected(length + 16, C_GUARD);
+        std::vector<uint8_t> actual(length + 16, C_GUARD);
+        extractAlphaScalar(rgba.data(), expected.data(), length);
+        PixelKernels::extractAlpha(rgba.data(), actual.data(), length);
+        QVERIFY2(actual == expected, qPrintable(QString("length %1").arg(length)));
+    }
+}
+
+void PixelKernelsTest::mergeAlphaMatchesScalar()
+{
+    const std::vector<uint8_t> alpha = randomBytes(C_MAX_LENGTH, 2);
+    const std::vector<uint8_t> rgba = randomBytes(C_MAX_LENGTH * 4, 3);
+
+    for (int length = 0; length <= C_MAX_LENGTH; ++length) {
+        //хвостовые пиксели за length должны остаться как были
+        std::vector<uint8_t> expected(rgba);
+        expected.resize(rgba.size() + 64, C_GUARD);
+        std::vector<uint8_t> actual(expected);
+        mergeAlphaScalar(expected.data(), alpha.data(), length);
+        PixelKernels::mergeAlpha(actual.data(), alpha.data(), length);
+        QVERIFY2(actual == expected, qPrintable(QString("length %1").arg(length)));
+    }
+}
+
+void PixelKernelsTest::resizeMatchesReference_data()
+{
+    QTest::addColumn<QSize>("source");
+    QTest::addColumn<QSize>("target");
+
+    QTest::newRow("x4 upscale") << QSize(17, 13) << QSize(68, 52);
+    QTest::newRow("x2 upscale") << QSize(32, 32) << QSize(64, 64);
+    QTest::newRow("non-integer") << QSize(23, 19) << QSize(57, 41);
+    QTest::newRow("downscale") << QSize(64, 48) << QSize(20, 15);
+    QTest::newRow("single pixel") << QSize(1, 1) << QSize(4, 4);
+    QTest::newRow("single row") << QSize(37, 1) << QSize(148, 4);
+    QTest::newRow("single column") << QSize(1, 29) << QSize(4, 116);
+    QTest::newRow("mixed") << QSize(40, 10) << QSize(20, 40);
+}
+
+void PixelKernelsTest::resizeMatchesReference()
+{
+    QFETCH(QSize, source);
+    QFETCH(QSize, target);
+
+    //строка источника длиннее ширины: ядро должно идти по stride, а не по ширине
+    const int srcStride = source.width() + 7;
+    const std::vector<uint8_t> packed = randomBytes(source.width() * source.height(), 4);
+    std::vector<uint8_t> src(size_t(srcStride) * source.height(), C_GUARD);
+    for (int y = 0; y < source.height(); ++y) {
+        std::copy_n(packed.begin() + size_t(y) * source.width(), source.width(), src.begin() + size_t(y) * srcStride);
+    }
+
+    const int dstStride = target.width() + 5;
+    std::vector<uint8_t> dst(size_t(dstStride) * target.height(), C_GUARD);
+    PixelKernels::resizePlaneBilinear(src.data(), source.width(), source.height(), srcStride,
+                                      dst.data(), target.width(), target.height(), dstStride);
+
+    //веса в ядре 8-битные, поэтому допускаем расхождение на пару единиц
+    const std::vector<uint8_t> expected = resizeReference(packed, source.width(), source.height(), target.width(), target.height());
+    int maxError = 0;
+    for (int y = 0; y < target.height(); ++y) {
+        for (int x = 0; x < target.width(); ++x) {
+            maxError = std::max(maxError, std::abs(int(dst[size_t(y) * dstStride + x]) - int(expected[size_t(y) * target.width() + x])));
+        }
+        for (int x = target.width(); x < dstStride; ++x) {
+            QCOMPARE(dst[size_t(y) * dstStride + x], C_GUARD);
+        }
+    }
+    QVERIFY2(maxError <= 2, qPrintable(QString("max error %1").arg(maxError)));
+}
+
+void PixelKernelsTest::resizeIdentityIsExact()
+{
+    const QImage source = randomPlane(33, 21, 5);
+    QImage result(source.size(), QImage::Format_Grayscale8);
+    PixelKernels::resizePlaneBilinear(source.constBits(), source.width(), source.height(), int(source.bytesPerLine()),
+                                      result.bits(), result.width(), result.height(), int(result.bytesPerLine()));
+    QCOMPARE(result, source);
+}
+
+void PixelKernelsTest::benchmarkExtractAlpha_data()
+{
+    QTest::addColumn<bool>("vectorized");
+    QTest::newRow("scalar loop") << false;
+    QTest::newRow("PixelKernels") << true;
+}
+
+void PixelKernelsTest::benchmarkExtractAlpha()
+{
+    QFETCH(bool, vectorized);
+    const int count = C_BENCH_SIDE * C_BENCH_SIDE * C_BENCH_SCALE;
+    const std::vector<uint8_t> rgba = randomBytes(count * 4, 6);
+    std::vector<uint8_t> alpha(count);
+
+    QBENCHMARK {
+        if (vectorized) {
+            PixelKernels::extractAlpha(rgba.data(), alpha.data(), count);
+        } else {
+            extractAlphaScalar(rgba.data(), alpha.data(), count);
+        }
+    }
+}
+
+void PixelKernelsTest::benchmarkMergeAlpha_data()
+{
+    benchmarkExtractAlpha_data();
+}
+
+void PixelKernelsTest::benchmarkMergeAlpha()
+{
+    QFETCH(bool, vectorized);
+    const int count = C_BENCH_SIDE * C_BENCH_SIDE * C_BENCH_SCALE;
+    std::vector<uint8_t> rgba = randomBytes(count * 4, 7);
+    const std::vector<uint8_t> alpha = randomBytes(count, 8);
+
+    QBENCHMARK {
+        if (vectorized) {
+            PixelKernels::mergeAlpha(rgba.data(), alpha.data(), count);
+        } else {
+            mergeAlphaScalar(rgba.data(), alpha.data(), count);
+        }
+    }
+}
+
+void PixelKernelsTest::benchmarkResize_data()
+{
+    QTest::addColumn<bool>("vectorized");
+    QTest::newRow("QImage::scaled smooth") << false;
+    QTest::newRow("PixelKernels") << true;
+}
+
+void PixelKernelsTest::benchmarkResize()
+{
+    QFETCH(bool, vectorized);
+    const QImage source = randomPlane(C_BENCH_SIDE / 2, C_BENCH_SIDE / 2, 9);
+    const QSize target = source.size() * C_BENCH_SCALE;
+    QImage result(target, QImage::Format_Grayscale8);
+
+    QBENCHMARK {
+        if (vectorized) {
+            PixelKernels::resizePlaneBilinear(source.constBits(), source.width(), source.height(), int(source.bytesPerLine()),
+                                              result.bits(), result.width(), result.height(), int(result.bytesPerLine()));
+        } else {
+            result = source.scaled(target, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+        }
+    }
+
+    //насколько результат расходится с Qt — для отчета, а не для проверки: у Qt свои правила на краях
+    if (vectorized) {
+        const QImage qt = source.scaled(target, Qt::IgnoreAspectRatio, Qt::SmoothTransformation).convertToFormat(QImage::Format_Grayscale8);
+        int maxDiff = 0;
+        for (int y = 0; y < target.height(); ++y) {
+            const uchar *a = result.constScanLine(y);
+            const uchar *b = qt.constScanLine(y);
+            for (int x = 0; x < target.width(); ++x) maxDiff = std::max(maxDiff, std::abs(int(a[x]) - int(b[x])));
+        }
+        qInfo("Max difference from QImage::scaled: %d", maxDiff);
+    }
+}
+
+IMAGOREF_TEST(PixelKernelsTest)
+#include "PixelKernelsTest.moc"
@@ -0,0 +1,216 @@
+//SyncDeltaTest — дельта-синхронизация доски с локальным HTTP-сервером: сколько байт уходит на одну правку
+//и передается ли курсор since_version при загрузке изменений
+
+#include <QTest>
+#include <QSignalSpy>
+#include <QJsonDocument>
+#include <QJsonArray>
+#include <QUrlQuery>
+#include <QUuid>
+#include <memory>
+
+#include "TestRegistry.h"
+#include "MockHttpServer.h"
+#include "BoardController.h"
+#include "StorageController.h"
+#include "NetworkController.h"
+
+namespace {
+constexpr int C_ITEM_COUNT = 50;
+constexpr int C_TIMEOUT_MS = 5000;
+}
+
+class SyncDeltaTest : public QObject {
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void init();
+    void cleanup();
+
+    void pushSendsOnlyChangedFields();
+    void pullSendsSinceVersionCursor();
+
+private:
+    MockHttpServer::Response handle(const MockHttpServer::Request &request);
+    bool sync();
+    MockHttpServer::Request lastRequest(const QByteArray &method, const QByteArray &pathPart) const;
+
+    MockHttpServer m_server;
+    std::unique_ptr<BoardController> m_board;
+    QString m_boardId;
+    qint64 m_serverVersion = 0;
+};
+
+void SyncDeltaTest::initTestCase()
+{
+    QVERIFY(m_server.listen());
+    m_server.setHandler([this](const MockHttpServer::Request &request) { return handle(request); });
+
+    //NetworkController читает адреса при создании; WebSocket ведет на закрытый порт — сокет здесь не нужен
+    qputenv("IMAGOREF_API_URL", m_server.url("/api").toEncoded());
+    qputenv("IMAGOREF_WS_URL", "ws://127.0.0.1:1/ws");
+
+    StorageController::initDatabase();
+}
+
+void SyncDeltaTest::init()
+{
+    m_serverVersion = 0;
+    m_boardId = QUuid::createUuid().toString(QUuid::WithoutBraces);
+    StorageController::createLocalBoard(m_boardId, "Sync test");
+
+    m_board = std::make_unique<BoardController>();
+    m_board->openCloudBoard(m_boardId);
+    m_server.clearRequests();
+}
+
+void SyncDeltaTest::cleanup()
+{
+    m_board->getNetworkController()->disconnectFromBoard();
+    m_board->getModel()->clear();
+    m_board.reset();
+    StorageController::deleteLocalBoard(m_boardId);
+}
+
+MockHttpServer::Response SyncDeltaTest::handle(const MockHttpServer::Request &request)
+{
+    if (request.path.contains("/sync_hashes")) {
+        return MockHttpServer::json(R"({"urls": {}})");
+    }
+
+    //сервер присваивает каждому принятому элементу новую версию
+    if (request.method == "PUT" && request.path.endsWith("/sync")) {
+        const QJsonArray items = QJsonDocument::fromJson(request.body).object()["updated_items"].toArray();
+        QJsonObject versions;
+        ++m_serverVersion;
+        for (const QJsonValue &item : items) {
+            versions[item.toObject()["id"].toString()] = m_serverVersion;
+        }
+        return MockHttpServer::json(QJsonDocument(QJsonObject{{"versions", versions}}).toJson(QJsonDocument::Compact));
+    }
+
+    //без курсора клиент ждет полный снимок доски — здесь он не нужен, ошибка просто пропускается
+    if (request.path.contains("/metadata")) {
+        const QUrlQuery query(QUrl::fromEncoded(request.path).query());
+        if (!query.hasQueryItem("since_version")) return MockHttpServer::status(500);
+
+        QJsonObject item;
+        item["id"] = "remote-item";
+        item["board_id"] = m_boardId;
+        item["type"] = "image";
+        item["x"] = 10;
+        item["y"] = 20;
+        item["width"] = 100;
+        item["height"] = 50;
+        item["z_index"] = 0;
+        item["version"] = m_serverVersion;
+        item["payload"] = QJsonObject{{"rotation", 0}, {"label", "Remote"}, {"opacity", 1}};
+
+        QJsonObject data;
+        data["since_version"] = query.queryItemValue("since_version").toLongLong();
+        data["version"] = m_serverVersion;
+        data["items"] = QJsonArray{item};
+        data["deleted_ids"] = QJsonArray();
+        return MockHttpServer::json(QJsonDocument(QJsonObject{{"data", data}}).toJson(QJsonDocument::Compact));
+    }
+
+    return MockHttpServer::status(404);
+}
+
+bool SyncDeltaTest::sync()
+{
+    QSignalSpy finished(m_board->getNetworkController(), &NetworkController::syncFinished);
+    m_board->getNetworkController()->syncBoardToServer();
+    if (finished.isEmpty() && !finished.wait(C_TIMEOUT_MS)) return false;
+    return finished.first().first().toBool();
+}
+
+MockHttpServer::Request SyncDeltaTest::lastRequest(const QByteArray &method, const QByteArray &pathPart) const
+{
+    const QVector<MockHttpServer::Request> &requests = m_server.requests();
+    for (auto it = requests.rbegin(); it != requests.rend(); ++it) {
+        if (it->method == method && it->path.contains(pathPart)) return *it;
+    }
+    return MockHttpServer::Request();
+}
+
+void SyncDeltaTest::pushSendsOnlyChangedFields()
+{
+    ImagoImageModel *model = m_board->getModel();
+    for (int i = 0; i < C_ITEM_COUNT; ++i) {
+        ImagoImageData item;
+        item.x = i * 120;
+        item.y = 0;
+        item.width = 100;
+        item.height = 80;
+        item.label = QString("Image %1").arg(i);
+        model->addImage(item);
+    }
+
+    //первая отправка: элементов еще нет на сервере, уходят целиком
+    QVERIFY(sync());
+    const QByteArray fullPush = lastRequest("PUT", "/sync").body;
+    QCOMPARE(QJsonDocument::fromJson(fullPush).object()["updated_items"].toArray().size(), C_ITEM_COUNT);
+
+    //перемещение одного элемента — только x и y этого элемента
+    m_server.clearRequests();
+    model->setPosition(3, 500, 600);
+    QVERIFY(sync());
+
+    const QByteArray movePush = lastRequest("PUT", "/sync").body;
+    const QJsonArray moved = QJsonDocument::fromJson(movePush).object()["updated_items"].toArray();
+    QCOMPARE(moved.size(), 1);
+    const QJsonObject movedItem = moved.first().toObject();
+    QCOMPARE(movedItem["id"].toString(), model->getItemId(3));
+    QCOMPARE(movedItem["fields"].toInt(), int(SyncPosition));
+    QCOMPARE(movedItem["x"].toDouble(), 500.0);
+    QCOMPARE(movedItem["y"].toDouble(), 600.0);
+    QVERIFY(!movedItem.contains("width"));
+    QVERIFY(!movedItem.contains("payload"));
+
+    //поворот — только payload.rotation
+    m_server.clearRequests();
+    model->setRotation(5, 30);
+    QVERIFY(sync());
+
+    const QByteArray rotatePush = lastRequest("PUT", "/sync").body;
+    const QJsonObject rotatedItem = QJsonDocument::fromJson(rotatePush).object()["updated_items"].toArray().first().toObject();
+    QCOMPARE(rotatedItem["fields"].toInt(), int(SyncRotation));
+    QCOMPARE(rotatedItem["payload"].toObject().keys(), QStringList{"rotation"});
+    QVERIFY(!rotatedItem.contains("x"));
+
+    qInfo("Bytes per edit: move %lld, rotate %lld; first push of %d items: %lld",
+          qint64(movePush.size()), qint64(rotatePush.size()), C_ITEM_COUNT, qint64(fullPush.size()));
+    QVERIFY(movePush.size() * 10 < fullPush.size());
+
+    //без изменений запрос на сервер не уходит
+    m_server.clearRequests();
+    QVERIFY(sync());
+    QVERIFY(lastRequest("PUT", "/sync").method.isEmpty());
+}
+
+void SyncDeltaTest::pullSendsSinceVersionCursor()
+{
+    StorageController *storage = m_board->getStorageController();
+    NetworkController *network = m_board->getNetworkController();
+    storage->setBoardServerVersion(m_boardId, 7);
+    m_serverVersion = 9;
+
+    QSignalSpy applied(network, &NetworkController::remoteChangesApplied);
+    network->disconnectFromBoard();
+    network->connectToBoard(m_boardId);
+    QVERIFY(applied.wait(C_TIMEOUT_MS));
+
+    const MockHttpServer::Request metadata = lastRequest("GET", "/metadata");
+    QCOMPARE(QUrlQuery(QUrl::fromEncoded(metadata.path).query()).queryItemValue("since_version"), QString("7"));
+    qInfo("Delta pull: %lld bytes for 1 changed item", qint64(m_server.bytesSent()));
+
+    //курсор сдвинулся, а новый элемент попал в модель без перезагрузки доски
+    QCOMPARE(storage->getBoardServerVersion(m_boardId), qint64(9));
+    QCOMPARE(applied.first().first().toStringList(), QStringList{"remote-item"});
+    QVERIFY(m_board->getModel()->getIndexById("remote-item") >= 0);
+}
+
+IMAGOREF_TEST(SyncDeltaTest)
+#include "SyncDeltaTest.moc"
@@ -0,0 +1,36 @@
+//TestMain.cpp - запуск тестов и бенчмарков ImagoRefTests. Без аргументов выполняются все зарегистрированные классы,
+//иначе только перечисленные: ImagoRefTests [Класс ...] [-- аргументы QtTest, например -o result.xml,xml]
+
+#include <QGuiApplication>
+#include <QStandardPaths>
+#include <QTest>
+#include <memory>
+
+#include "TestRegistry.h"
+
+int main(int argc, char *argv[])
+{
+    //тесты работают без дисплея, а база, кэш картинок и модели лежат в тестовых каталогах, а не в профиле пользователя
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    QStandardPaths::setTestModeEnabled(true);
+
+    QGuiApplication app(argc, argv);
+    QCoreApplication::setApplicationName("ImagoRefTests"); //отдельный файл QSettings
+
+    const QStringList args = QCoreApplication::arguments().mid(1);
+    const int separator = args.indexOf("--");
+    const QStringList selected = separator < 0 ? args : args.mid(0, separator);
+    QStringList testArgs = {QCoreApplication::arguments().first()};
+    if (separator >= 0) testArgs += args.mid(separator + 1);
+
+    int failed = 0;
+    for (const TestRegistry::Entry &entry : TestRegistry::entries()) {
+        if (!selected.isEmpty() && !selected.contains(QLatin1String(entry.name))) continue;
+
+        std::unique_ptr<QObject> test(entry.create());
+        failed += QTest::qExec(test.get(), testArgs);
+    }
+    return failed;
+}
@@ -0,0 +1,30 @@
+//TestRegistry — список тестовых классов ImagoRefTests. Каждый файл теста регистрирует свой класс макросом IMAGOREF_TEST,
+//TestMain запускает их по очереди через QTest::qExec
+
+#pragma once
+
+#include <QObject>
+#include <vector>
+
+namespace TestRegistry {
+
+struct Entry {
+    const char *name;
+    QObject *(*create)();
+};
+
+//регистрация идет из статических объектов разных файлов, поэтому список создается при первом обращении
+inline std::vector<Entry>& entries()
+{
+    static std::vector<Entry> list;
+    return list;
+}
+
+struct Registrar {
+    Registrar(const char *name, QObject *(*create)()) { entries().push_back({name, create}); }
+};
+
+}
+
+#define IMAGOREF_TEST(TestClass) \
+    static const TestRegistry::Registrar s_register##TestClass(#TestClass, []() -> QObject * { return new TestClass; });
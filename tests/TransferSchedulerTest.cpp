@@ -0,0 +1,298 @@
+//TransferSchedulerTest — очередь передач против локального HTTP-сервера: ограничение параллельности, потоковая выгрузка,
+//повторы, докачка через Range, повторная постановка того же ключа и общий прогресс
+
+#include <QTest>
+#include <QSignalSpy>
+#include <QTemporaryDir>
+#include <QNetworkAccessManager>
+#include <QFile>
+
+#include "TestRegistry.h"
+#include "MockHttpServer.h"
+#include "TransferScheduler.h"
+
+namespace {
+constexpr int C_PAYLOAD_SIZE = 256 * 1024;
+constexpr int C_TIMEOUT_MS = 10000; //с запасом на паузу перед повтором
+
+QByteArray makePayload()
+{
+    QByteArray payload(C_PAYLOAD_SIZE, Qt::Uninitialized);
+    for (int i = 0; i < payload.size(); ++i) {
+        payload[i] = char((i * 31 + i / 251) & 0xFF);
+    }
+    return payload;
+}
+
+QByteArray readFile(const QString &path)
+{
+    QFile file(path);
+    return file.open(QIODevice::ReadOnly) ? file.readAll() : QByteArray();
+}
+
+bool writeFile(const QString &path, const QByteArray &data)
+{
+    QFile file(path);
+    return file.open(QIODevice::WriteOnly) && file.write(data) == data.size();
+}
+}
+
+class TransferSchedulerTest : public QObject {
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void init();
+
+    void uploadStreamsFileBody();
+    void concurrencyIsCapped();
+    void retriesServerErrors();
+    void doesNotRetryAccessErrors();
+    void resumesTruncatedDownload();
+    void restartsWhenServerIgnoresRange();
+    void restartsAfter416();
+    void duplicateKeyIsIgnored();
+    void progressCoversAllTransfers();
+
+private:
+    bool waitIdle(QSignalSpy &finished);
+
+    MockHttpServer m_server;
+    QNetworkAccessManager m_network;
+    QTemporaryDir m_dir;
+    QByteArray m_payload;
+};
+
+void TransferSchedulerTest::initTestCase()
+{
+    QVERIFY(m_server.listen());
+    QVERIFY(m_dir.isValid());
+    m_payload = makePayload();
+}
+
+void TransferSchedulerTest::init()
+{
+    m_server.setHandler([this](const MockHttpServer::Request &request) { return MockHttpServer::file(request, m_payload); });
+    m_server.clearRequests();
+}
+
+bool TransferSchedulerTest::waitIdle(QSignalSpy &finished)
+{
+    return !finished.isEmpty() || finished.wait(C_TIMEOUT_MS);
+}
+
+void TransferSchedulerTest::uploadStreamsFileBody()
+{
+    const QString path = m_dir.filePath("upload.bin");
+    QVERIFY(writeFile(path, m_payload));
+    m_server.setHandler([](const MockHttpServer::Request &) { return MockHttpServer::status(200); });
+
+    TransferScheduler scheduler(&m_network);
+    QSignalSpy uploaded(&scheduler, &TransferScheduler::uploadFinished);
+    QSignalSpy finished(&scheduler, &TransferScheduler::allFinished);
+    scheduler.enqueueUpload("upload", m_server.url("/bucket/upload.bin"), path, "image/png");
+    QVERIFY(waitIdle(finished));
+
+    QCOMPARE(uploaded.size(), 1);
+    QCOMPARE(uploaded.first().at(1).toBool(), true);
+    QCOMPARE(m_server.requests().size(), 1);
+
+    const MockHttpServer::Request &request = m_server.requests().first();
+    QCOMPARE(request.method, QByteArray("PUT"));
+    QCOMPARE(request.headers.value("content-type"), QByteArray("image/png"));
+    QCOMPARE(request.body, m_payload);
+}
+
+void TransferSchedulerTest::concurrencyIsCapped()
+{
+    constexpr int transfers = 10;
+    constexpr int cap = 3;
+    m_server.setHandler([this](const MockHttpServer::Request &request) {
+        MockHttpServer::Response response = MockHttpServer::file(request, m_payload);
+        response.delayMs = 100;
+        return response;
+    });
+
+    TransferScheduler scheduler(&m_network);
+    scheduler.setMaxConcurrent(cap);
+    QSignalSpy downloaded(&scheduler, &TransferScheduler::downloadFinished);
+    QSignalSpy finished(&scheduler, &TransferScheduler::allFinished);
+    for (int i = 0; i < transfers; ++i) {
+        scheduler.enqueueDownload(QString::number(i), m_server.url("/file"), m_dir.filePath(QString("parallel-%1.bin").arg(i)));
+    }
+    QVERIFY(waitIdle(finished));
+
+    QCOMPARE(finished.first().first().toBool(), true);
+    QCOMPARE(downloaded.size(), transfers);
+    QCOMPARE(m_server.requests().size(), transfers);
+    QVERIFY(m_server.maxConcurrentRequests() <= cap);
+    QVERIFY(m_server.maxConcurrentRequests() > 1);
+}
+
+void TransferSchedulerTest::retriesServerErrors()
+{
+    int calls = 0;
+    m_server.setHandler([this, &calls](const MockHttpServer::Request &request) {
+        return ++calls == 1 ? MockHttpServer::status(503) : MockHttpServer::file(request, m_payload);
+    });
+
+    const QString path = m_dir.filePath("retry.bin");
+    TransferScheduler scheduler(&m_network);
+    QSignalSpy finished(&scheduler, &TransferScheduler::allFinished);
+    scheduler.enqueueDownload("retry", m_server.url("/file"), path);
+    QVERIFY(waitIdle(finished));
+
+    QCOMPARE(finished.first().first().toBool(), true);
+    QCOMPARE(calls, 2);
+    QCOMPARE(readFile(path), m_payload);
+}
+
+void TransferSchedulerTest::doesNotRetryAccessErrors()
+{
+    //истекший presigned URL повторять бессмысленно
+    m_server.setHandler([](const MockHttpServer::Request &) { return MockHttpServer::status(403); });
+
+    TransferScheduler scheduler(&m_network);
+    QSignalSpy downloaded(&scheduler, &TransferScheduler::downloadFinished);
+    QSignalSpy finished(&scheduler, &TransferScheduler::allFinished);
+    scheduler.enqueueDownload("forbidden", m_server.url("/file"), m_dir.filePath("forbidden.bin"));
+    QVERIFY(waitIdle(finished));
+
+    QCOMPARE(finished.first().first().toBool(), false);
+    QCOMPARE(downloaded.first().at(1).toBool(), false);
+    QCOMPARE(m_server.requests().size(), 1);
+}
+
+void TransferSchedulerTest::resumesTruncatedDownload()
+{
+    constexpr qint64 dropAt = 100000;
+    m_server.setHandler([this](const MockHttpServer::Request &request) {
+        MockHttpServer::Response response = MockHttpServer::file(request, m_payload);
+        if (m_server.requests().size() == 1) response.dropAfter = dropAt;
+        return response;
+    });
+
+    const QString path = m_dir.filePath("resume.bin");
+    TransferScheduler scheduler(&m_network);
+    QSignalSpy finished(&scheduler, &TransferScheduler::allFinished);
+    scheduler.enqueueDownload("resume", m_server.url("/file"), path);
+    QVERIFY(waitIdle(finished));
+
+    QCOMPARE(finished.first().first().toBool(), true);
+    QCOMPARE(m_server.requests().size(), 2);
+    QVERIFY(!m_server.requests().at(0).headers.contains("range"));
+    QCOMPARE(m_server.requests().at(1).headers.value("range"), "bytes=" + QByteArray::number(dropAt) + "-");
+
+    //второй запрос докачал только хвост, а файл собран целиком и без временного куска
+    QCOMPARE(readFile(path), m_payload);
+    QVERIFY(!QFile::exists(path + ".part"));
+    QCOMPARE(m_server.bytesSent(), qint64(m_payload.size()));
+}
+
+void TransferSchedulerTest::restartsWhenServerIgnoresRange()
+{
+    const QString path = m_dir.filePath("ignored-range.bin");
+    QVERIFY(writeFile(path + ".part", QByteArray(1000, 'x')));
+    m_server.setHandler([this](const MockHttpServer::Request &) {
+        MockHttpServer::Response response;
+        response.body = m_payload;
+        return response;
+    });
+
+    TransferScheduler scheduler(&m_network);
+    QSignalSpy finished(&scheduler, &TransferScheduler::allFinished);
+    scheduler.enqueueDownload("ignored-range", m_server.url("/file"), path);
+    QVERIFY(waitIdle(finished));
+
+    QCOMPARE(finished.first().first().toBool(), true);
+    QCOMPARE(m_server.requests().first().headers.value("range"), QByteArray("bytes=1000-"));
+    QCOMPARE(readFile(path), m_payload);
+}
+
+void TransferSchedulerTest::restartsAfter416()
+{
+    //сохраненный кусок длиннее файла на сервере — его нужно выбросить и скачать заново
+    const QString path = m_dir.filePath("stale.bin");
+    QVERIFY(writeFile(path + ".part", QByteArray(C_PAYLOAD_SIZE + 10, 'x')));
+
+    TransferScheduler scheduler(&m_network);
+    QSignalSpy finished(&scheduler, &TransferScheduler::allFinished);
+    scheduler.enqueueDownload("stale", m_server.url("/file"), path);
+    QVERIFY(waitIdle(finished));
+
+    QCOMPARE(finished.first().first().toBool(), true);
+    QCOMPARE(m_server.requests().size(), 2);
+    QVERIFY(m_server.requests().at(0).headers.contains("range"));
+    QVERIFY(!m_server.requests().at(1).headers.contains("range"));
+    QCOMPARE(readFile(path), m_payload);
+}
+
+void TransferSchedulerTest::duplicateKeyIsIgnored()
+{
+    //тот же хэш из /metadata и из дельты: одна передача, один .part, без перемешанных байт
+    m_server.setHandler([this](const MockHttpServer::Request &request) {
+        MockHttpServer::Response response = MockHttpServer::file(request, m_payload);
+        response.delayMs = 100;
+        return response;
+    });
+
+    const QString activePath = m_dir.filePath("duplicate-active.bin");
+    const QString queuedPath = m_dir.filePath("duplicate-queued.bin");
+    TransferScheduler scheduler(&m_network);
+    scheduler.setMaxConcurrent(1);
+    QSignalSpy downloaded(&scheduler, &TransferScheduler::downloadFinished);
+    QSignalSpy progress(&scheduler, &TransferScheduler::progressChanged);
+    QSignalSpy finished(&scheduler, &TransferScheduler::allFinished);
+    scheduler.enqueueDownload("active", m_server.url("/file"), activePath);
+    scheduler.enqueueDownload("queued", m_server.url("/file"), queuedPath);
+    scheduler.enqueueDownload("active", m_server.url("/file"), activePath); //уже в работе
+    scheduler.enqueueDownload("queued", m_server.url("/file"), queuedPath); //еще в очереди
+    QVERIFY(waitIdle(finished));
+
+    QCOMPARE(finished.first().first().toBool(), true);
+    QCOMPARE(downloaded.size(), 2);
+    QCOMPARE(m_server.requests().size(), 2);
+    QCOMPARE(readFile(activePath), m_payload);
+    QCOMPARE(readFile(queuedPath), m_payload);
+    QCOMPARE(progress.last().at(1).toLongLong(), qint64(2) * C_PAYLOAD_SIZE);
+
+    //после завершения ключ снова можно поставить
+    finished.clear();
+    scheduler.enqueueDownload("active", m_server.url("/file"), activePath);
+    QVERIFY(waitIdle(finished));
+    QCOMPARE(downloaded.size(), 3);
+    QCOMPARE(m_server.requests().size(), 3);
+}
+
+void TransferSchedulerTest::progressCoversAllTransfers()
+{
+    const QString uploadPath = m_dir.filePath("progress-upload.bin");
+    QVERIFY(writeFile(uploadPath, m_payload));
+    m_server.setHandler([this](const MockHttpServer::Request &request) {
+        return request.method == "PUT" ? MockHttpServer::status(200) : MockHttpServer::file(request, m_payload);
+    });
+
+    TransferScheduler scheduler(&m_network);
+    QSignalSpy progress(&scheduler, &TransferScheduler::progressChanged);
+    QSignalSpy finished(&scheduler, &TransferScheduler::allFinished);
+    scheduler.enqueueUpload("progress-upload", m_server.url("/bucket/progress"), uploadPath, "image/png");
+    scheduler.enqueueDownload("progress-a", m_server.url("/file"), m_dir.filePath("progress-a.bin"));
+    scheduler.enqueueDownload("progress-b", m_server.url("/file"), m_dir.filePath("progress-b.bin"));
+    QVERIFY(waitIdle(finished));
+
+    QCOMPARE(finished.first().first().toBool(), true);
+    QVERIFY(!progress.isEmpty());
+
+    //прогресс не убывает, а в конце покрывает все три передачи
+    qint64 previous = 0;
+    for (const QList<QVariant> &args : std::as_const(progress)) {
+        QVERIFY(args.at(0).toLongLong() >= previous);
+        previous = args.at(0).toLongLong();
+    }
+    const QList<QVariant> last = progress.last();
+    QCOMPARE(last.at(1).toLongLong(), qint64(3) * C_PAYLOAD_SIZE);
+    QCOMPARE(last.at(0).toLongLong(), last.at(1).toLongLong());
+}
+
+IMAGOREF_TEST(TransferSchedulerTest)
+#include "TransferSchedulerTest.moc"
@@ -0,0 +1,321 @@
+//UndoFuzzTest — тысячи случайных команд (добавление, удаление, перемещение, размер, вращение, обрезка, подпись, апскейл)
+//вперемешку со случайными undo/redo на ImagoImageModel и UndoHistory. После каждого шага состояние модели сравнивается
+//со снимком, который тест запомнил для этой позиции стека. Плюс обрезка истории по бюджету байт
+
+#include <QTest>
+#include <QPainter>
+#include <QRandomGenerator>
+
+#include "TestRegistry.h"
+#include "StackController.h"
+#include "CacheManager.h"
+#include "ImageModel.h"
+
+namespace {
+constexpr int C_STEPS = 4000;
+constexpr int C_MAX_ITEMS = 40;
+constexpr int C_POOL_SIZE = 8; //картинки для элементов и результатов апскейла, у каждой свой размер и хэш
+
+QString poolHash(int n)
+{
+    return QString("undo-fuzz-%1").arg(n);
+}
+
+QPixmap poolPixmap(int n)
+{
+    const int side = 8 + n * 4;
+    QImage image(side, side, QImage::Format_ARGB32);
+    image.fill(QColor::fromHsv(n * 45, 200, 220));
+    QPainter painter(&image);
+    painter.drawLine(0, 0, side, side);
+    return QPixmap::fromImage(image);
+}
+
+//все, что команды меняют в элементе; выделение и zValue команды не трогают
+struct ItemState {
+    QString id;
+    qreal x, y, width, height, rotation, opacity;
+    QRectF crop;
+    QString label;
+    QString imageHash;
+    QSize pixmapSize;
+
+    bool operator==(const ItemState &other) const
+    {
+        return id == other.id && x == other.x && y == other.y && width == other.width && height == other.height
+            && rotation == other.rotation && opacity == other.opacity && crop == other.crop && label == other.label
+            && imageHash == other.imageHash && pixmapSize == other.pixmapSize;
+    }
+
+    QString describe() const
+    {
+        return QString("%1 pos %2,%3 size %4x%5 rot %6 crop %7,%8 %9x%10 label '%11' hash %12 pixmap %13x%14")
+            .arg(id).arg(x).arg(y).arg(width).arg(height).arg(rotation)
+            .arg(crop.x()).arg(crop.y()).arg(crop.width()).arg(crop.height())
+            .arg(label, imageHash).arg(pixmapSize.width()).arg(pixmapSize.height());
+    }
+};
+
+//строки в порядке модели: отмена удаления должна вернуть элементы на свои места
+QVector<ItemState> capture(const ImagoImageModel &model)
+{
+    QVector<ItemState> state;
+    state.reserve(model.getCount());
+    for (int i = 0; i < model.getCount(); ++i) {
+        const ImagoImageData item = model.getItem(i);
+        state.append({item.id, item.x, item.y, item.width, item.height, item.rotation, item.opacity,
+                      QRectF(item.cropX, item.cropY, item.cropWidth, item.cropHeight), item.label,
+                      item.imageHash, item.pixmap.size()});
+    }
+    return state;
+}
+
+QString compareStates(const QVector<ItemState> &actual, const QVector<ItemState> &expected)
+{
+    if (actual.size() != expected.size()) {
+        return QString("item count %1, expected %2").arg(actual.size()).arg(expected.size());
+    }
+    for (int i = 0; i < actual.size(); ++i) {
+        if (!(actual[i] == expected[i])) {
+            return QString("row %1: %2\nexpected: %3").arg(i).arg(actual[i].describe(), expected[i].describe());
+        }
+    }
+    return QString();
+}
+}
+
+class UndoFuzzTest : public QObject {
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+
+    void randomCommands_data();
+    void randomCommands();
+    void trimDropsOldestCommands();
+    void trimForgetsLostCleanState();
+
+private:
+    void addItem(ImagoImageModel &model, UndoHistory &history, QRandomGenerator &random);
+    void pushRandomCommand(ImagoImageModel &model, UndoHistory &history, QRandomGenerator &random);
+};
+
+void UndoFuzzTest::initTestCase()
+{
+    //пиксели апскейла команды берут из кэша по хэшу, поэтому все картинки пула кладем туда заранее
+    for (int n = 0; n < C_POOL_SIZE; ++n) {
+        CacheManager::instance().retainPixmap(poolHash(n), poolPixmap(n));
+    }
+}
+
+void UndoFuzzTest::addItem(ImagoImageModel &model, UndoHistory &history, QRandomGenerator &random)
+{
+    const int n = random.bounded(C_POOL_SIZE);
+    ImagoImageData data;
+    data.pixmap = CacheManager::instance().loadPixmap(poolHash(n));
+    data.imageHash = poolHash(n);
+    data.x = random.bounded(1000);
+    data.y = random.bounded(1000);
+    data.width = data.pixmap.width();
+    data.height = data.pixmap.height();
+    model.addImage(data);
+
+    //как в ClipboardController: элемент уже в модели, команда только запоминает его
+    const ImagoImageData added = model.getItem(model.getCount() - 1);
+    history.push(new AddImageCommand(&model, added.id, QUrl(), added.x, added.y, added.width, added.height));
+}
+
+void UndoFuzzTest::pushRandomCommand(ImagoImageModel &model, UndoHistory &history, QRandomGenerator &random)
+{
+    if (model.getCount() == 0 || (model.getCount() < C_MAX_ITEMS && random.bounded(8) == 0)) {
+        addItem(model, history, random);
+        return;
+    }
+
+    const int index = random.bounded(model.getCount());
+    const ImagoImageData item = model.getItem(index);
+    const QPointF pos(item.x, item.y);
+
+    switch (random.bounded(8)) {
+    case 0: {
+        QList<int> indices = {index};
+        if (model.getCount() > 1 && random.bounded(2)) {
+            const int other = random.bounded(model.getCount());
+            if (other != index) indices.append(other);
+        }
+        history.push(new RemoveImageCommand(&model, indices));
+        break;
+    }
+    case 1:
+    case 2: {
+        //перемещения одного элемента подряд склеиваются в одну команду
+        const QPointF newPos = pos + QPointF(random.bounded(41) - 20, random.bounded(41) - 20);
+        history.push(new MoveImageCommand(&model, index, pos, newPos));
+        break;
+    }
+    case 3: {
+        const QRectF newRect(0, 0, 10 + random.bounded(300), 10 + random.bounded(300));
+        const QPointF newPos = pos - QPointF(random.bounded(20), random.bounded(20));
+        history.push(new ResizeImageCommand(&model, index, QRectF(0, 0, item.width, item.height), pos, newRect, newPos));
+        break;
+    }
+    case 4: {
+        //вращение нескольких элементов — одна команда с дочерними, как в ToolController; углы кратны 15,
+        //чтобы сумма и разность в double были точными
+        const qreal delta = 15 * (random.bounded(11) - 5);
+        QUndoCommand *command = new QUndoCommand("Вращение");
+        new RotateImageCommand(&model, index, delta, command);
+        if (model.getCount() > 1) {
+            new RotateImageCommand(&model, (index + 1) % model.getCount(), delta, command);
+        }
+        history.push(command);
+        break;
+    }
+    case 5: {
+        const QRectF oldCrop(item.cropX, item.cropY, item.cropWidth, item.cropHeight);
+        const QRectF newCrop(random.bounded(4), random.bounded(4), 2 + random.bounded(4), 2 + random.bounded(4));
+        const QSizeF newSize(5 + random.bounded(100), 5 + random.bounded(100));
+        history.push(new CropImageCommand(&model, index, pos, QSizeF(item.width, item.height), oldCrop,
+                                          pos + QPointF(3, 3), newSize, newCrop));
+        break;
+    }
+    case 6: {
+        const QString label = random.bounded(4) == 0 ? QString() : QString("label %1").arg(random.bounded(100));
+        history.push(new SetLabelCommand(&model, index, item.label, label));
+        break;
+    }
+    case 7: {
+        //апскейл заменяет картинку другой картинкой из кэша и сбрасывает обрезку
+        const int current = item.imageHash.section('-', -1).toInt();
+        const QString newHash = poolHash((current + 1 + random.bounded(C_POOL_SIZE - 1)) % C_POOL_SIZE);
+        history.push(new UpscaleImageCommand(&model, index, QRectF(item.cropX, item.cropY, item.cropWidth, item.cropHeight),
+                                             item.imageHash, QRectF(), newHash));
+        break;
+    }
+    }
+}
+
+void UndoFuzzTest::randomCommands_data()
+{
+    QTest::addColumn<quint32>("seed");
+    QTest::newRow("seed 1") << quint32(1);
+    QTest::newRow("seed 2") << quint32(2);
+    QTest::newRow("seed 3") << quint32(3);
+}
+
+void UndoFuzzTest::randomCommands()
+{
+    QFETCH(quint32, seed);
+    QRandomGenerator random(seed);
+
+    ImagoImageModel model;
+    UndoHistory history;
+    //snapshots[i] — состояние модели, когда индекс стека равен i
+    QVector<QVector<ItemState>> snapshots = {capture(model)};
+    int undos = 0;
+    int redos = 0;
+
+    for (int step = 0; step < C_STEPS; ++step) {
+        const int action = random.bounded(10);
+        if (action < 3 && history.canUndo()) {
+            history.undo();
+            ++undos;
+        } else if (action < 5 && history.canRedo()) {
+            history.redo();
+            ++redos;
+        } else {
+            const int before = history.index();
+            pushRandomCommand(model, history, random);
+            //бюджет по умолчанию здесь не достигается: индекс либо вырос на один, либо команда склеилась с вершиной
+            QVERIFY(history.index() == before + 1 || history.index() == before);
+            snapshots.resize(history.index());
+            snapshots.append(capture(model));
+        }
+
+        QCOMPARE(snapshots.size(), history.count() + 1);
+        const QString mismatch = compareStates(capture(model), snapshots.at(history.index()));
+        QVERIFY2(mismatch.isEmpty(), qPrintable(QString("step %1, index %2: %3").arg(step).arg(history.index()).arg(mismatch)));
+    }
+
+    //в конце откатываем все до пустой доски и проходим историю заново
+    while (history.canUndo()) history.undo();
+    QVERIFY(capture(model).isEmpty());
+    while (history.canRedo()) {
+        history.redo();
+        const QString mismatch = compareStates(capture(model), snapshots.at(history.index()));
+        QVERIFY2(mismatch.isEmpty(), qPrintable(QString("replay, index %1: %2").arg(history.index()).arg(mismatch)));
+    }
+    qInfo("Seed %u: %d commands in history, %d undo, %d redo", seed, history.count(), undos, redos);
+}
+
+void UndoFuzzTest::trimDropsOldestCommands()
+{
+    QRandomGenerator random(7);
+    ImagoImageModel model;
+    UndoHistory history;
+    for (int i = 0; i < 4; ++i) addItem(model, history, random);
+
+    QVector<QVector<ItemState>> snapshots;
+    for (int i = 0; i < 30; ++i) {
+        history.push(new RotateImageCommand(&model, i % model.getCount(), 15));
+        snapshots.append(capture(model));
+    }
+    QCOMPARE(history.count(), 34);
+
+    //бюджет на десять команд: стек выбрасывает старые с запасом до трех четвертей бюджета
+    const qint64 perCommand = history.retainedBytes() / history.count();
+    history.setByteBudget(perCommand * 10);
+    QVERIFY(history.retainedBytes() <= history.byteBudget());
+    QVERIFY(history.count() < 10);
+    QCOMPARE(history.index(), history.count());
+    QCOMPARE(compareStates(capture(model), snapshots.last()), QString());
+
+    //пересборка не выполняет команды повторно, а оставшиеся откатываются до своего начала
+    const int kept = history.count();
+    while (history.canUndo()) history.undo();
+    QCOMPARE(compareStates(capture(model), snapshots.at(snapshots.size() - 1 - kept)), QString());
+    while (history.canRedo()) history.redo();
+    QCOMPARE(compareStates(capture(model), snapshots.last()), QString());
+
+    //новые команды после обрезки по-прежнему склеиваются с вершиной
+    const QPointF pos = model.getItemRect(0).topLeft();
+    history.push(new MoveImageCommand(&model, 0, pos, pos + QPointF(5, 0)));
+    const int afterMove = history.count();
+    history.push(new MoveImageCommand(&model, 0, pos + QPointF(5, 0), pos + QPointF(9, 0)));
+    QCOMPARE(history.count(), afterMove);
+    QCOMPARE(model.getItemRect(0).topLeft(), pos + QPointF(9, 0));
+}
+
+void UndoFuzzTest::trimForgetsLostCleanState()
+{
+    QRandomGenerator random(8);
+    ImagoImageModel model;
+    UndoHistory history;
+    addItem(model, history, random);
+
+    //чистое состояние внутри оставшейся части истории переживает пересборку
+    for (int i = 0; i < 10; ++i) history.push(new RotateImageCommand(&model, 0, 15));
+    history.undo();
+    history.undo();
+    history.setClean();
+    history.redo();
+    history.redo();
+    const qint64 perCommand = history.retainedBytes() / history.count();
+    history.setByteBudget(perCommand * 8);
+    QVERIFY(history.count() > 2);
+    QCOMPARE(history.cleanIndex(), history.count() - 2);
+
+    //а ушедшее вместе со старыми командами больше недостижимо
+    while (history.index() > 1) history.undo();
+    history.setClean();
+    while (history.canRedo()) history.redo();
+    history.setByteBudget(perCommand * 2);
+    QCOMPARE(history.count(), 1);
+    QCOMPARE(history.cleanIndex(), -1);
+    QVERIFY(!history.isClean());
+    history.undo();
+    QVERIFY(!history.isClean());
+}
+
+IMAGOREF_TEST(UndoFuzzTest)
+#include "UndoFuzzTest.moc"
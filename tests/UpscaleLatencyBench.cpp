@@ -0,0 +1,88 @@
+//UpscaleLatencyBench — задержка апскейла 20 изображений подряд через UpscaleController: первое задание загружает сеть,
+//остальные берут ее из общего пула. Нужна скачанная модель в каталоге моделей тестового профиля, иначе тест пропускается
+
+#include <QTest>
+#include <QSignalSpy>
+#include <QElapsedTimer>
+#include <QPainter>
+#include <QUuid>
+#include <algorithm>
+
+#include "TestRegistry.h"
+#include "UpscaleController.h"
+#include "StackController.h"
+#include "ModelsManager.h"
+#include "ImageModel.h"
+
+namespace {
+constexpr int C_IMAGE_COUNT = 20;
+constexpr int C_IMAGE_SIDE = 128;
+constexpr int C_TIMEOUT_MS = 120000;
+
+//у каждого изображения свои пиксели и свой хэш, чтобы кэш результатов апскейла не срабатывал
+QPixmap makeImage(int seed)
+{
+    QImage image(C_IMAGE_SIDE, C_IMAGE_SIDE, QImage::Format_RGB32);
+    image.fill(QColor::fromHsv((seed * 37) % 360, 160, 200));
+    QPainter painter(&image);
+    painter.setPen(Qt::black);
+    for (int i = 0; i < 8; ++i) {
+        painter.drawLine(0, i * 16 + seed % 16, C_IMAGE_SIDE, i * 16);
+    }
+    painter.drawText(image.rect(), Qt::AlignCenter, QString::number(seed));
+    return QPixmap::fromImage(image);
+}
+}
+
+class UpscaleLatencyBench : public QObject {
+    Q_OBJECT
+
+private slots:
+    void sequentialLatency();
+};
+
+void UpscaleLatencyBench::sequentialLatency()
+{
+    ModelsManager &models = ModelsManager::instance();
+    if (!models.isModelDownloaded()) {
+        QSKIP(qPrintable("No upscale model in " + models.getModelFilePath(QString())));
+    }
+
+    ImagoImageModel model;
+    UndoHistory undoStack;
+    UpscaleController controller(&model, &models, &undoStack);
+
+    for (int i = 0; i < C_IMAGE_COUNT; ++i) {
+        ImagoImageData item;
+        item.width = C_IMAGE_SIDE;
+        item.height = C_IMAGE_SIDE;
+        item.pixmap = makeImage(i);
+        item.imageHash = QUuid::createUuid().toString(QUuid::WithoutBraces);
+        model.addImage(item);
+    }
+
+    QSignalSpy finished(&controller, &UpscaleController::upscaleFinished);
+    QSignalSpy failed(&controller, &UpscaleController::upscaleFailed);
+
+    //задания по одному: время каждого — полная задержка от постановки в очередь до результата в модели
+    QVector<qint64> latencies;
+    QElapsedTimer total;
+    total.start();
+    for (int i = 0; i < C_IMAGE_COUNT; ++i) {
+        QElapsedTimer timer;
+        timer.start();
+        controller.upscaleImage(i, 0, "quality");
+        QTRY_COMPARE_WITH_TIMEOUT(finished.size() + failed.size(), i + 1, C_TIMEOUT_MS);
+        latencies.append(timer.elapsed());
+    }
+    QVERIFY2(failed.isEmpty(), "An upscale job failed");
+
+    const qint64 cold = latencies.first();
+    QVector<qint64> warm = latencies.mid(1);
+    std::sort(warm.begin(), warm.end());
+    qInfo("Upscale %dx%d x%d: first (loads the net) %lld ms, warm median %lld ms, warm max %lld ms, total %lld ms",
+          C_IMAGE_SIDE, C_IMAGE_SIDE, C_IMAGE_COUNT, cold, warm.at(warm.size() / 2), warm.last(), total.elapsed());
+}
+
+IMAGOREF_TEST(UpscaleLatencyBench)
+#include "UpscaleLatencyBench.moc"